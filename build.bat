@@ -17,6 +17,34 @@ set FILE=./src/main.cpp
 
 rem "[Build]: Building executables."
 cl.exe %COMPILEROPTION% %INCLUDES% %FILE% /link %LINKOPTION% %LIBPATH% %LINKS% 
+
+rem "[Build]: Building benchmarks."
+cl.exe /O2 /W1 /arch:AVX2 /Fo"./dist/" /Fd"./dist/" ./src/bench.cpp /link /INCREMENTAL:NO /out:"./dist/bench.exe"
+
+rem "[Build]: Building headless combat."
+cl.exe /O2 /W1 /arch:AVX2 /Fo"./dist/" /Fd"./dist/" ./src/combat_sim.cpp /link /INCREMENTAL:NO /out:"./dist/combat_sim.exe"
+
+rem "[Build]: Checking every batch kernel against combat_run."
+cl.exe /O2 /W1 /arch:AVX /Fo"./dist/" /Fd"./dist/" ./src/combat_sim.cpp /link /INCREMENTAL:NO /out:"./dist/combat_sim_sse41.exe"
+cl.exe /O2 /W1 /Fo"./dist/" /Fd"./dist/" ./src/combat_sim.cpp /link /INCREMENTAL:NO /out:"./dist/combat_sim_scalar.exe"
+for %%s in (combat_sim combat_sim_sse41 combat_sim_scalar) do (
+    .\dist\%%s.exe --verify
+    if errorlevel 1 (
+        echo "[Build]: %%s --verify FAILED: the batch kernel doesn't match combat_run."
+        exit /b 1
+    )
+)
+
+rem "[Build]: Building steady-state allocation check."
+cl.exe /O2 /W1 /Fo"./dist/" /Fd"./dist/" ./src/alloc_check.cpp /link /INCREMENTAL:NO /out:"./dist/alloc_check.exe"
+.\dist\alloc_check.exe
+if errorlevel 1 (
+    echo "[Build]: alloc_check FAILED: heap allocations in steady state."
+    exit /b 1
+)
+
+rem "[Build]: Building plan solver."
+cl.exe /O2 /W1 /arch:AVX2 /Fo"./dist/" /Fd"./dist/" ./src/plan_solver.cpp /link /INCREMENTAL:NO /out:"./dist/plan_solver.exe"
 endlocal
 
 
@@ -8,6 +8,32 @@ echo "[Build]: Building executables."
 FILE='src/main.cpp'
 clang -g -Wall -fsanitize=address -o dist/compiled $FILE -lm -lGL -lGLEW -lglfw -lraylib -fno-caret-diagnostics
 
+echo "[Build]: Building benchmarks."
+clang -O2 -g -Wall -march=native -o dist/bench src/bench.cpp -lm -lpthread -fno-caret-diagnostics
+
+echo "[Build]: Building headless combat."
+clang -O2 -g -Wall -march=native -o dist/combat_sim src/combat_sim.cpp -lm -lpthread -fno-caret-diagnostics
+
+echo "[Build]: Checking every batch kernel against combat_run."
+clang -O2 -g -Wall -msse4.1 -o dist/combat_sim_sse41 src/combat_sim.cpp -lm -lpthread -fno-caret-diagnostics
+clang -O2 -g -Wall -o dist/combat_sim_scalar src/combat_sim.cpp -lm -lpthread -fno-caret-diagnostics
+for sim in dist/combat_sim dist/combat_sim_sse41 dist/combat_sim_scalar; do
+    if ! $sim --verify; then
+        echo "[Build]: $sim --verify FAILED: the batch kernel doesn't match combat_run."
+        exit 1
+    fi
+done
+
+echo "[Build]: Building steady-state allocation check."
+clang -O2 -g -Wall -o dist/alloc_check src/alloc_check.cpp -lm -lpthread -fno-caret-diagnostics
+if ! dist/alloc_check; then
+    echo "[Build]: alloc_check FAILED: heap allocations in steady state."
+    exit 1
+fi
+
+echo "[Build]: Building plan solver."
+clang -O2 -g -Wall -march=native -o dist/plan_solver src/plan_solver.cpp -lm -lpthread -fno-caret-diagnostics
+
 if [ -d "assets" ]; then
     if [ -d "dist/assets" ]; then
         echo "[Build]: Clearing Assets inside dist directory."
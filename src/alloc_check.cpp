@@ -0,0 +1,160 @@
+/*
+ * Headless steady-state allocation check: sets memory up the way main.cpp does, then plays stage one frame by frame,
+ * over and over, with the allocation guard fatal. past STEADY_STATE_WARMUP_FRAMES any heap allocation is a failure.
+ * per frame it runs the game's own raylib-free code: frame arena temp block, tracker frames, the turn and effect
+ * intervals, combat_resolve_turn, the effect slab and its draw order (frame.h), fz_tprintf labels through the label cache.
+ * only the raylib calls (textures, sounds, MeasureTextEx) are left out.
+ * build: see build.sh / build.bat (dist/alloc_check).
+ * usage: alloc_check [plays]   exit code 1 on any steady-state heap allocation.
+ */
+
+#define fz_TRACK_ALLOCATIONS /* violations name their call site. */
+#define FUZZY_MY_H_IMPL
+#include "my.h"
+
+#define FUZZY_COMBAT_H_IMPL
+#include "combat.h"
+
+#define FUZZY_FRAME_H_IMPL
+#include "frame.h"
+
+#define STEADY_STATE_WARMUP_FRAMES 120 /* same as main.cpp. */
+#define EFFECT_MEMORY (16 * fz_KB)   /* same as main.cpp. */
+#define FRAME_DT      (1.0f / 60.0f)
+#define EFFECT_LIFE   5              /* frames in an effect sprite, main gets it from the texture width. */
+
+static fz_Arena   frame_arena;
+static fz_Tracker heap_tracker;
+static fz_Tracker frame_tracker;
+
+static Label_Cache labels;
+
+static uint32_t rng_state = 0x12345678;
+static uint32_t rng_next() {
+    uint32_t x = rng_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return rng_state = x;
+}
+
+/* MeasureTextEx without a font: the interning and cache lookups are what matter here. */
+static Frame_Size measure_text(const char *label, float font_size) {
+    return { (float)strlen(label) * font_size * 0.5f, font_size };
+}
+
+/* a new plan and a fresh stage, as after load_stage_one and the player's planning. */
+static void start_play(Combat *combat) {
+    combat_load_stage_one(combat);
+    combat->player.health = combat->player.max_health = 12;
+    combat->player.action_count = 1 + (int)(rng_next() % ACTION_CAPACITY);
+    for (int i = 0; i < combat->player.action_count; ++i) {
+        combat->player.actions[i].type = ACTION_SLASH + (int)(rng_next() % (ACTION_COUNT - ACTION_SLASH));
+    }
+}
+
+/* one turn_tick / combat failsafe step. returns 0 once the play is over. */
+static int combat_step(Combat *combat, fz_Slab *effects) {
+    switch (combat_status(combat)) {
+        case COMBAT_ONGOING:
+        {
+            /* what present_cue spawns, minus the texture lookup. */
+            Frame_Rect target = { 0, 0, 160, 160 };
+            Turn_Result turn = combat_resolve_turn(combat);
+            if (turn.outcome.player_cue) effects_add(effects, turn.outcome.player_cue, EFFECT_LIFE, target);
+            if (turn.outcome.enemy_cue)  effects_add(effects, turn.outcome.enemy_cue,  EFFECT_LIFE, target);
+        } return 1;
+
+        case COMBAT_ENEMY_DEAD:
+        {
+            Enemy_Chain *chain = &combat->enemies[combat->chain_index];
+            if ((combat->enemy_index + 1) < chain->enemy_count) combat_next_enemy(combat);
+            else                                                 combat_next_chain(combat);
+        } return 1;
+
+        case COMBAT_CHAIN_COMPLETE:
+        {
+            combat_next_chain(combat);
+        } return 1;
+
+        default: return 0;
+    }
+}
+
+int main(int argc, char **argv) {
+    int plays = argc > 1 ? atoi(argv[1]) : 100;
+
+    /* memory, same as main(). */
+    fz_arena_init_virtual(&frame_arena, 64 * fz_MB, 256 * fz_KB);
+
+    fz_tracker_init(&heap_tracker,  fz_heap_allocator(),             "heap");
+    fz_tracker_init(&frame_tracker, fz_arena_allocator(&frame_arena), "frame arena");
+    fz_set_allocator(fz_tracker_allocator(&heap_tracker));
+    fz_set_temp_allocator(fz_tracker_allocator(&frame_tracker));
+
+    label_cache_init(&labels, measure_text);
+
+    Combat combat = {};
+    combat.enemies = VecCreate(Enemy_Chain, 10);
+
+    fz_Slab effects;
+    void *effect_memory = fz_alloc(EFFECT_MEMORY);
+    fz_slab_init(&effects, effect_memory, EFFECT_MEMORY, sizeof(Effect));
+
+    /* main's intervals. */
+    Interval turn_interval   = { 0.5f,  0 };
+    Interval effect_interval = { 0.10f, 0 };
+
+    fz_alloc_guard_begin(STEADY_STATE_WARMUP_FRAMES, 1);
+
+    uint64_t frames = 0, turns = 0;
+    for (int play = 0; play < plays; ++play) {
+        start_play(&combat);
+
+        for (int playing = 1; playing; ++frames) {
+            fz_alloc_guard_frame();
+            fz_Temp_Memory t = fz_begin_temp(&frame_arena);
+            fz_tracker_next_frame(&heap_tracker);
+            fz_tracker_next_frame(&frame_tracker);
+
+            if (interval_tick(&turn_interval, FRAME_DT)) {
+                playing = combat_step(&combat, &effects);
+                turns += (uint64_t)playing;
+            }
+            if (interval_tick(&effect_interval, FRAME_DT)) effects_advance(&effects);
+
+            /* the HUD's per-frame strings. */
+            label_cache_measure(&labels, fz_tprintf("Reset (%d)", combat.infinite_loop_counter % 3), 40);
+            label_cache_measure(&labels, fz_tprintf("%d / %d", combat.player.action_count, ACTION_CAPACITY), 18);
+            label_cache_measure(&labels, fz_tprintf("Effect count: %d / %d", effects.count, effects.capacity), 32);
+            effects_draw_order(&effects);
+
+            fz_end_temp(t);
+            fz_tracker_reset_in_use(&frame_tracker);
+        }
+    }
+
+    uint64_t violations = fz_alloc_guard_violations();
+    fz_alloc_guard_end();
+
+    printf("%d plays, %llu frames, %llu turns: %llu steady-state heap allocations, peak heap %zu bytes\n",
+           plays, (unsigned long long)frames, (unsigned long long)turns, (unsigned long long)violations,
+           heap_tracker.high_water);
+
+    VecRelease(combat.enemies);
+    fz_free(effect_memory);
+    label_cache_release(&labels);
+    fz_tracker_release(&frame_tracker);
+    fz_tracker_release(&heap_tracker);
+    fz_arena_release(&frame_arena);
+
+    if (frames <= STEADY_STATE_WARMUP_FRAMES) {
+        printf("FAILED: never got past warm-up, nothing was checked.\n");
+        return 1;
+    }
+    if (violations) {
+        printf("FAILED\n");
+        return 1;
+    }
+    return 0;
+}
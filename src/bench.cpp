@@ -0,0 +1,935 @@
+/*
+ * Benchmarks for my.h, no window and no raylib.
+ * build: see build.sh / build.bat (dist/bench).
+ * usage: bench [name]   runs every benchmark whose name starts with [name], or all of them.
+ *        bench alloc    compares the allocators, no window or audio device needed.
+ */
+
+#define FUZZY_MY_H_IMPL
+#include "my.h"
+
+#define FUZZY_COMBAT_H_IMPL
+#include "combat.h"
+
+#if defined(fz_OS_WINDOWS)
+#if !defined(fz_NO_WINDOWS_H)
+#include <windows.h>
+#endif
+#include <psapi.h>
+#else
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#endif
+
+/*
+ * ==================================================
+ * Harness.
+ * ==================================================
+ * */
+
+static uint64_t time_now_ns() {
+#if defined(fz_OS_WINDOWS)
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (uint64_t)((double)counter.QuadPart * 1e9 / (double)frequency.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+// keeps the optimizer from throwing away results.
+static volatile uint64_t bench_sink;
+
+static uint32_t rng_state = 0x12345678;
+static uint32_t rng_next() {
+    uint32_t x = rng_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return rng_state = x;
+}
+
+// runs body (which processes `items` elements) repeatedly for ~200ms, prints ns per element.
+#define BENCH_MEASURE(label, items, body) do {                                                      \
+        uint64_t bench_total = 0, bench_runs = 0;                                                   \
+        while (bench_total < 200000000ull) {                                                        \
+            uint64_t bench_start = time_now_ns();                                                   \
+            body;                                                                                   \
+            bench_total += time_now_ns() - bench_start;                                             \
+            bench_runs++;                                                                           \
+        }                                                                                           \
+        printf("  %-34s %10.2f ns/elem  (%llu runs)\n", label,                                      \
+               (double)bench_total / (double)(bench_runs * (uint64_t)(items)),                      \
+               (unsigned long long)bench_runs);                                                     \
+    } while(0)
+
+/*
+ * ==================================================
+ * Sorting: qsort (fz_Vec_Sort) vs fz_sort vs fz_radix_sort.
+ * ==================================================
+ * */
+
+// same shape as Effect in main.cpp.
+struct Bench_Effect {
+    int   asset_id;
+    int   elapsed;
+    int   max_life;
+    float rect[4];
+};
+
+static int bench_effect_compare(const void *a, const void *b) {
+    return ((Bench_Effect *)a)->asset_id - ((Bench_Effect *)b)->asset_id;
+}
+
+static void bench_sort() {
+    int sizes[] = { 8, 32, 64, 256, 4096, 100000, 1000000 };
+
+    for (int s = 0; s < (int)fz_COUNTOF(sizes); ++s) {
+        int count = sizes[s];
+        printf("sort %d effects (asset_id in [0, 64)):\n", count);
+
+        Vec(Bench_Effect) source = VecCreate(Bench_Effect, count);
+        Vec(Bench_Effect) work   = VecCreate(Bench_Effect, count);
+        for (int i = 0; i < count; ++i) {
+            Bench_Effect e = {0};
+            e.asset_id = (int)(rng_next() % 64);
+            e.elapsed  = i;
+            VecPush(source, e);
+            VecPush(work, e);
+        }
+
+        BENCH_MEASURE("qsort (fz_Vec_Sort)", count, {
+            memcpy(work, source, sizeof(Bench_Effect) * count);
+            VecSort(work, bench_effect_compare);
+        });
+        for (int i = 1; i < count; ++i) assert(work[i - 1].asset_id <= work[i].asset_id);
+
+        BENCH_MEASURE("fz_sort (introsort)", count, {
+            memcpy(work, source, sizeof(Bench_Effect) * count);
+            VecSortBy(work, [](const Bench_Effect &a, const Bench_Effect &b) { return a.asset_id < b.asset_id; });
+        });
+        for (int i = 1; i < count; ++i) assert(work[i - 1].asset_id <= work[i].asset_id);
+
+        BENCH_MEASURE("fz_radix_sort", count, {
+            memcpy(work, source, sizeof(Bench_Effect) * count);
+            VecRadixSort(work, [](const Bench_Effect &e) { return e.asset_id; });
+        });
+        for (int i = 1; i < count; ++i) {
+            assert(work[i - 1].asset_id <= work[i].asset_id);
+            assert(work[i - 1].asset_id != work[i].asset_id || work[i - 1].elapsed < work[i].elapsed); // stable.
+        }
+
+        bench_sink += work[0].asset_id;
+        VecRelease(source);
+        VecRelease(work);
+    }
+}
+
+/*
+ * ==================================================
+ * Huge pages: random reads over a big buffer, normal vs huge page backing.
+ * ==================================================
+ * */
+
+static void bench_random_reads(const char *label, uint64_t *words, size_t word_count) {
+    // touch everything first so page faults don't end up in the numbers.
+    for (size_t i = 0; i < word_count; ++i) words[i] = i;
+
+    const int reads = 1 << 24;
+    size_t mask = word_count - 1;
+    BENCH_MEASURE(label, reads, {
+        uint64_t sum = 0;
+        uint64_t x   = 0x9E3779B97F4A7C15ull;
+        for (int i = 0; i < reads; ++i) {
+            x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+            sum += words[x & mask];
+        }
+        bench_sink += sum;
+    });
+}
+
+static void bench_huge_pages() {
+    const size_t size = 512 * fz_MB; // power of two, so indices can be masked.
+    const char *kinds[] = { "normal", "transparent huge", "explicit huge" };
+
+    {
+        uint8_t *memory = (uint8_t *)fz_platform_reserve(size);
+        fz_platform_commit(memory, size);
+#if defined(MADV_NOHUGEPAGE)
+        madvise(memory, size, MADV_NOHUGEPAGE); // THP set to "always" would hand out huge pages anyway.
+#endif
+        bench_random_reads("4KB pages", (uint64_t *)memory, size / sizeof(uint64_t));
+
+        size_t resident = fz_platform_huge_resident(memory, size);
+        if (resident != (size_t)-1) printf("  on huge pages: %zu MB\n", resident / fz_MB);
+        fz_platform_release(memory, size);
+    }
+
+    {
+        fz_Huge_Memory huge = fz_platform_alloc_huge(size + fz_PUSH_ALIGNMENT); // rounds up to the next huge page.
+        printf("  fz_platform_alloc_huge granted: %s pages\n", kinds[huge.kind]);
+
+        // an arena on top, the way a solver would use it.
+        fz_Arena arena;
+        fz_arena_init(&arena, huge.memory, huge.size);
+        uint64_t *words = (uint64_t *)fz_alloc_ex(fz_arena_allocator(&arena), size);
+        bench_random_reads("fz_platform_alloc_huge", words, size / sizeof(uint64_t));
+
+        size_t resident = fz_platform_huge_resident(huge.memory, huge.size);
+        if (resident != (size_t)-1) printf("  on huge pages: %zu MB\n", resident / fz_MB);
+        fz_platform_free_huge(huge);
+    }
+}
+
+/*
+ * ==================================================
+ * Allocators: every allocator in my.h through the same allocation patterns.
+ * each (pattern, allocator) pair runs in its own process on unix, so peak RSS belongs to that pair alone.
+ * span is the address range the allocator touched, frag = 1 - peak live bytes / span.
+ * only the first byte of each allocation gets written, so RSS shows what the allocator itself touches.
+ * ==================================================
+ * */
+
+enum Bench_Alloc_Kind {
+    BENCH_HEAP,
+    BENCH_ARENA,
+    BENCH_STACK,
+    BENCH_POOL,
+    BENCH_FREELIST,
+    BENCH_TLSF,
+    BENCH_RING,
+    BENCH_BUDDY,
+    BENCH_ALLOC_KIND_COUNT,
+};
+
+static const char *bench_alloc_names[] = { "heap", "arena", "stack", "pool", "freelist", "tlsf", "ring", "buddy" };
+
+#define BENCH_BACKING_SIZE (512 * fz_MB)
+
+struct Bench_Alloc {
+    int          kind;
+    fz_Allocator allocator;
+    uint8_t     *backing;
+
+    fz_Arena      arena;
+    fz_StackAlloc stack;
+    fz_Pool       pool;
+    fz_Freelist   freelist;
+    fz_Tlsf       tlsf;
+    fz_Ring       ring;
+    fz_Buddy      buddy;
+
+    // what the pattern did.
+    uint64_t ops;
+    uint8_t *lowest;
+    uint8_t *highest;
+    size_t   live;
+    size_t   peak_live;
+};
+
+static void bench_alloc_setup(Bench_Alloc *b, int kind, size_t pool_element_size) {
+    memset(b, 0, sizeof(*b));
+    b->kind = kind;
+
+    if (kind != BENCH_HEAP) {
+        // committed up front but untouched, so RSS only grows with what the allocator writes to.
+        b->backing = (uint8_t *)fz_platform_reserve(BENCH_BACKING_SIZE);
+        fz_platform_commit(b->backing, BENCH_BACKING_SIZE);
+    }
+
+    switch (kind) {
+        case BENCH_HEAP:     b->allocator = fz_heap_allocator(); break;
+        case BENCH_ARENA:    fz_arena_init(&b->arena, b->backing, BENCH_BACKING_SIZE);       b->allocator = fz_arena_allocator(&b->arena); break;
+        case BENCH_STACK:    fz_stack_init(&b->stack, b->backing, BENCH_BACKING_SIZE);       b->allocator = fz_stack_allocator(&b->stack); break;
+        case BENCH_FREELIST: fz_freelist_init(&b->freelist, b->backing, BENCH_BACKING_SIZE); b->allocator = fz_freelist_allocator(&b->freelist); break;
+        case BENCH_TLSF:     fz_tlsf_init(&b->tlsf, b->backing, BENCH_BACKING_SIZE);         b->allocator = fz_tlsf_allocator(&b->tlsf); break;
+        case BENCH_RING:     fz_ring_init(&b->ring, b->backing, BENCH_BACKING_SIZE);         b->allocator = fz_ring_allocator(&b->ring); break;
+        case BENCH_BUDDY:    fz_buddy_init(&b->buddy, b->backing, BENCH_BACKING_SIZE, 4 * fz_KB); b->allocator = fz_buddy_allocator(&b->buddy); break;
+        case BENCH_POOL:
+            fz_pool_init_ex(&b->pool, b->backing, BENCH_BACKING_SIZE, pool_element_size, fz_POOL_LAZY | fz_POOL_NO_ZERO);
+            b->allocator = fz_pool_allocator(&b->pool);
+            break;
+    }
+}
+
+static inline void *bench_alloc(Bench_Alloc *b, size_t size) {
+    // the pool only hands out its element size.
+    uint8_t *ptr = (uint8_t *)fz_alloc_ex(b->allocator, b->kind == BENCH_POOL ? b->pool.element_size : size);
+    assert(ptr);
+    ptr[0] = 1; // touch it, like real code would.
+
+    b->ops++;
+    b->live += size;
+    if (b->live > b->peak_live) b->peak_live = b->live;
+    if (!b->lowest  || ptr < b->lowest)         b->lowest  = ptr;
+    if (ptr + size > b->highest)                b->highest = ptr + size;
+    return ptr;
+}
+
+static inline void bench_free(Bench_Alloc *b, void *ptr, size_t size) {
+    fz_free_ex(b->allocator, ptr);
+    b->ops++;
+    b->live -= size;
+}
+
+static inline void *bench_realloc(Bench_Alloc *b, void *ptr, size_t old_size, size_t size) {
+    uint8_t *result = (uint8_t *)fz_realloc_ex(b->allocator, ptr, old_size, size);
+    assert(result);
+
+    b->ops++;
+    b->live += size - old_size;
+    if (b->live > b->peak_live) b->peak_live = b->live;
+    if (!b->lowest  || result < b->lowest)      b->lowest  = result;
+    if (result + size > b->highest)             b->highest = result + size;
+    return result;
+}
+
+static size_t bench_random_size(size_t min_size, size_t max_size) {
+    // skewed towards small sizes, like most real workloads.
+    size_t range = max_size - min_size + 1;
+    size_t a = rng_next() % range, c = rng_next() % range;
+    return min_size + (a < c ? a : c);
+}
+
+// 600 frames, each doing 1000 allocations of 16..512 bytes that all die at the end of the frame.
+static void pattern_frame_bursts(Bench_Alloc *b) {
+    static void  *ptrs[1000];
+    static size_t sizes[1000];
+
+    for (uint64_t frame = 1; frame <= 600; ++frame) {
+        fz_Temp_Memory temp = {0};
+        if (b->kind == BENCH_ARENA) temp = fz_begin_temp(&b->arena);
+        if (b->kind == BENCH_RING)  fz_ring_begin_frame(&b->ring, frame);
+
+        for (int i = 0; i < 1000; ++i) {
+            sizes[i] = bench_random_size(16, 512);
+            ptrs[i]  = bench_alloc(b, sizes[i]);
+        }
+
+        switch (b->kind) {
+            case BENCH_ARENA: fz_end_temp(temp); b->live = 0; break;
+            case BENCH_RING:  fz_ring_retire(&b->ring, frame); b->live = 0; break;
+            default:
+                // stack needs reverse order; it's as good as any for the rest.
+                for (int i = 999; i >= 0; --i) bench_free(b, ptrs[i], sizes[i]);
+        }
+    }
+}
+
+// nested scopes: push up to 64 deep, pop back in reverse, repeat.
+static void pattern_lifo(Bench_Alloc *b) {
+    static void  *ptrs[64];
+    static size_t sizes[64];
+    int depth = 0;
+
+    for (int i = 0; i < 500000; ++i) {
+        int push = depth == 0 || (depth < 64 && (rng_next() & 1));
+        if (push) {
+            sizes[depth] = bench_random_size(16, 4096);
+            ptrs[depth]  = bench_alloc(b, sizes[depth]);
+            depth++;
+        } else {
+            depth--;
+            bench_free(b, ptrs[depth], sizes[depth]);
+        }
+    }
+    while (depth > 0) { depth--; bench_free(b, ptrs[depth], sizes[depth]); }
+}
+
+// 4096 live 64 byte objects, one random object replaced per step.
+static void pattern_fixed_churn(Bench_Alloc *b) {
+    static void *ptrs[4096];
+    for (int i = 0; i < 4096; ++i) ptrs[i] = bench_alloc(b, 64);
+
+    for (int i = 0; i < 1000000; ++i) {
+        int victim = (int)(rng_next() % 4096);
+        bench_free(b, ptrs[victim], 64);
+        ptrs[victim] = bench_alloc(b, 64);
+    }
+    for (int i = 0; i < 4096; ++i) bench_free(b, ptrs[i], 64);
+}
+
+// 8192 live objects of 16B..16KB, random ones replaced with a different size, so holes don't fit exactly.
+static void pattern_mixed_sizes(Bench_Alloc *b) {
+    static void  *ptrs[8192];
+    static size_t sizes[8192];
+    for (int i = 0; i < 8192; ++i) {
+        sizes[i] = bench_random_size(16, 16 * 1024);
+        ptrs[i]  = bench_alloc(b, sizes[i]);
+    }
+
+    for (int i = 0; i < 200000; ++i) {
+        int victim = (int)(rng_next() % 8192);
+        bench_free(b, ptrs[victim], sizes[victim]);
+        sizes[victim] = bench_random_size(16, 16 * 1024);
+        ptrs[victim]  = bench_alloc(b, sizes[victim]);
+    }
+
+    if (b->kind == BENCH_FREELIST) {
+        fz_Freelist_Stats stats = fz_freelist_stats(&b->freelist);
+        printf("    freelist: %zu free blocks, largest %zu KB, own fragmentation %.1f%%\n",
+               stats.free_blocks, stats.largest_free / fz_KB, stats.fragmentation * 100.0f);
+    }
+    for (int i = 0; i < 8192; ++i) bench_free(b, ptrs[i], sizes[i]);
+}
+
+// asset-like blocks: 48 live textures / audio buffers of 64KB..8MB, random ones reloaded with a new size.
+static void pattern_large_blocks(Bench_Alloc *b) {
+    static void  *ptrs[48];
+    static size_t sizes[48];
+    for (int i = 0; i < 48; ++i) {
+        sizes[i] = bench_random_size(64 * fz_KB, 2 * fz_MB);
+        ptrs[i]  = bench_alloc(b, sizes[i]);
+    }
+
+    for (int i = 0; i < 20000; ++i) {
+        int victim = (int)(rng_next() % 48);
+        bench_free(b, ptrs[victim], sizes[victim]);
+        sizes[victim] = bench_random_size(64 * fz_KB, 8 * fz_MB) & ~(size_t)4095; // decoders hand out page multiples.
+        ptrs[victim]  = bench_alloc(b, sizes[victim]);
+    }
+
+    if (b->kind == BENCH_BUDDY) {
+        printf("    buddy: %zu MB free, largest free block %zu MB\n", b->buddy.free_bytes / fz_MB, fz_buddy_largest_free(&b->buddy) / fz_MB);
+    }
+    for (int i = 0; i < 48; ++i) bench_free(b, ptrs[i], sizes[i]);
+}
+
+// 64 vectors growing side by side, one push at a time, up to 16K ints each. ops are pushes.
+static void bench_vector_push(Bench_Alloc *b, Vec(int) *vector, int value) {
+    if (VecLen(*vector) == VecCap(*vector)) {
+        fz_Array_Header_Type *header = VecHeader(*vector);
+        size_t old_size = sizeof(fz_Array_Header_Type) + header->caps * sizeof(int);
+        size_t new_size = sizeof(fz_Array_Header_Type) + header->caps * 2 * sizeof(int);
+        header = (fz_Array_Header_Type *)bench_realloc(b, header, old_size, new_size);
+        header->caps *= 2;
+        *vector = (int *)(header + 1);
+    }
+    VecPush(*vector, value);
+    b->ops++;
+}
+
+static void pattern_vector_growth(Bench_Alloc *b) {
+    const int vector_count = 64;
+    const int push_count   = 16 * 1024;
+    Vec(int) vectors[vector_count];
+
+    if (b->kind == BENCH_STACK) {
+        // the stack can only grow its top allocation, so it builds one vector after the other.
+        for (int v = 0; v < vector_count; ++v) {
+            vectors[v] = VecCreateEx(int, 4, b->allocator);
+            for (int i = 0; i < push_count; ++i) bench_vector_push(b, &vectors[v], i);
+        }
+    } else {
+        for (int v = 0; v < vector_count; ++v) vectors[v] = VecCreateEx(int, 4, b->allocator);
+        for (int i = 0; i < push_count; ++i) {
+            for (int v = 0; v < vector_count; ++v) bench_vector_push(b, &vectors[v], i);
+        }
+    }
+
+    for (int v = vector_count - 1; v >= 0; --v) VecRelease(vectors[v]);
+}
+
+struct Bench_Pattern {
+    const char *name;
+    void      (*func)(Bench_Alloc *b);
+    size_t      pool_element_size; // 0 if the pool can't run it.
+    int         kinds;             // bit per Bench_Alloc_Kind.
+};
+
+#define BENCH_KIND(k) (1 << (k))
+
+static Bench_Pattern bench_patterns[] = {
+    { "frame-temp bursts (16..512B)", pattern_frame_bursts, 512,
+      BENCH_KIND(BENCH_HEAP) | BENCH_KIND(BENCH_ARENA) | BENCH_KIND(BENCH_STACK) | BENCH_KIND(BENCH_POOL) |
+      BENCH_KIND(BENCH_FREELIST) | BENCH_KIND(BENCH_TLSF) | BENCH_KIND(BENCH_RING) },
+    { "LIFO (16..4KB, 64 deep)", pattern_lifo, 4096,
+      BENCH_KIND(BENCH_HEAP) | BENCH_KIND(BENCH_STACK) | BENCH_KIND(BENCH_POOL) | BENCH_KIND(BENCH_FREELIST) | BENCH_KIND(BENCH_TLSF) },
+    { "fixed-size churn (64B)", pattern_fixed_churn, 64,
+      BENCH_KIND(BENCH_HEAP) | BENCH_KIND(BENCH_POOL) | BENCH_KIND(BENCH_FREELIST) | BENCH_KIND(BENCH_TLSF) },
+    { "mixed sizes (16B..16KB)", pattern_mixed_sizes, 0,
+      BENCH_KIND(BENCH_HEAP) | BENCH_KIND(BENCH_FREELIST) | BENCH_KIND(BENCH_TLSF) },
+    { "large blocks (64KB..8MB)", pattern_large_blocks, 0,
+      BENCH_KIND(BENCH_HEAP) | BENCH_KIND(BENCH_FREELIST) | BENCH_KIND(BENCH_TLSF) | BENCH_KIND(BENCH_BUDDY) },
+    { "vector growth (64 x 16K ints)", pattern_vector_growth, 0,
+      BENCH_KIND(BENCH_HEAP) | BENCH_KIND(BENCH_ARENA) | BENCH_KIND(BENCH_STACK) | BENCH_KIND(BENCH_FREELIST) | BENCH_KIND(BENCH_TLSF) },
+};
+
+static size_t bench_peak_rss() {
+#if defined(fz_OS_WINDOWS)
+    PROCESS_MEMORY_COUNTERS counters;
+    K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    return counters.PeakWorkingSetSize;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (size_t)usage.ru_maxrss * fz_KB; // linux reports KB.
+#endif
+}
+
+static void bench_alloc_run(Bench_Pattern *pattern, int kind) {
+    Bench_Alloc *b = (Bench_Alloc *)malloc(sizeof(Bench_Alloc));
+    bench_alloc_setup(b, kind, pattern->pool_element_size);
+    rng_state = 0x12345678; // every allocator sees the same sequence.
+
+    uint64_t start = time_now_ns();
+    pattern->func(b);
+    uint64_t elapsed = time_now_ns() - start;
+
+    printf("  %-9s %8.1f ns/op  peak RSS %7.1f MB  peak live %7.1f MB",
+           bench_alloc_names[kind], (double)elapsed / (double)b->ops,
+           (double)bench_peak_rss() / fz_MB, (double)b->peak_live / fz_MB);
+    if (kind != BENCH_HEAP && b->highest) {
+        size_t span = (size_t)(b->highest - b->lowest);
+        printf("  span %7.1f MB  frag %5.1f%%", (double)span / fz_MB, 100.0 * (1.0 - (double)b->peak_live / (double)span));
+    }
+    printf("\n");
+
+    if (b->backing) fz_platform_release(b->backing, BENCH_BACKING_SIZE);
+    free(b);
+}
+
+static void bench_allocators() {
+    for (int p = 0; p < (int)fz_COUNTOF(bench_patterns); ++p) {
+        Bench_Pattern *pattern = &bench_patterns[p];
+        printf("%s:\n", pattern->name);
+
+        for (int kind = 0; kind < BENCH_ALLOC_KIND_COUNT; ++kind) {
+            if (!(pattern->kinds & BENCH_KIND(kind))) continue;
+#if defined(fz_OS_WINDOWS)
+            // NOTE(fuzzy): no fork here, peak RSS is for the whole run so far.
+            bench_alloc_run(pattern, kind);
+#else
+            fflush(stdout);
+            pid_t child = fork();
+            if (child == 0) {
+                bench_alloc_run(pattern, kind);
+                fflush(stdout);
+                _exit(0);
+            }
+            int status;
+            waitpid(child, &status, 0);
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                printf("  %-9s crashed.\n", bench_alloc_names[kind]);
+            }
+#endif
+        }
+    }
+}
+
+/*
+ * ==================================================
+ * Ring buffers: items per second through each fz_RingBuf flavour.
+ * ==================================================
+ * */
+
+#define RING_ITEMS (4 * 1000 * 1000)
+
+static fz_RingBuf<uint64_t, 1024, fz_RING_SINGLE> ring_single;
+static fz_RingBuf<uint64_t, 1024, fz_RING_SPSC>   ring_spsc;
+static fz_RingBuf<uint64_t, 1024, fz_RING_MPMC>   ring_mpmc;
+
+struct Ring_Worker {
+    int      count; // items this worker pushes or pops.
+    uint64_t sum;
+};
+
+// spin a little before giving the core away, so it also works with fewer cores than threads.
+static inline void ring_backoff(int *spins) {
+    if (++(*spins) < 64) fz_atomic_spin_pause();
+    else { fz_thread_yield(); *spins = 0; }
+}
+
+static void ring_spsc_producer(void *user_data) {
+    Ring_Worker *worker = (Ring_Worker *)user_data;
+    int spins = 0;
+    for (int i = 1; i <= worker->count; ++i) {
+        while (!ring_spsc.push((uint64_t)i)) ring_backoff(&spins);
+    }
+}
+
+static void ring_mpmc_producer(void *user_data) {
+    Ring_Worker *worker = (Ring_Worker *)user_data;
+    int spins = 0;
+    for (int i = 1; i <= worker->count; ++i) {
+        while (!ring_mpmc.push((uint64_t)i)) ring_backoff(&spins);
+    }
+}
+
+static void ring_mpmc_consumer(void *user_data) {
+    Ring_Worker *worker = (Ring_Worker *)user_data;
+    int spins = 0;
+    uint64_t item;
+    for (int i = 0; i < worker->count; ++i) {
+        while (!ring_mpmc.pop(&item)) ring_backoff(&spins);
+        worker->sum += item;
+    }
+}
+
+static void ring_report(const char *label, uint64_t elapsed) {
+    printf("  %-28s %8.1f M items/s  %6.2f ns/item\n", label,
+           (double)RING_ITEMS / ((double)elapsed / 1e9) / 1e6, (double)elapsed / RING_ITEMS);
+}
+
+static void bench_ring_buffers() {
+    printf("%d hardware threads.\n", fz_thread_hardware_count());
+
+    {
+        uint64_t sum = 0, item = 0;
+        uint64_t start = time_now_ns();
+        for (int i = 0; i < RING_ITEMS; i += 64) {
+            for (int j = 0; j < 64; ++j) ring_single.push((uint64_t)j);
+            for (int j = 0; j < 64; ++j) { ring_single.pop(&item); sum += item; }
+        }
+        ring_report("single thread", time_now_ns() - start);
+        bench_sink += sum;
+    }
+
+    {
+        Ring_Worker producer = { RING_ITEMS, 0 };
+        uint64_t start = time_now_ns();
+        fz_Thread thread = fz_thread_create(ring_spsc_producer, &producer);
+
+        uint64_t expected = 1, item;
+        int spins = 0;
+        while (expected <= RING_ITEMS) {
+            if (ring_spsc.pop(&item)) { assert(item == expected); expected++; }
+            else ring_backoff(&spins);
+        }
+        fz_thread_join(thread);
+        ring_report("SPSC (1 -> 1)", time_now_ns() - start);
+    }
+
+    int pairs[] = { 1, 2, 4 };
+    for (int p = 0; p < (int)fz_COUNTOF(pairs); ++p) {
+        int n = pairs[p];
+        Ring_Worker producers[4], consumers[4];
+        fz_Thread threads[8];
+
+        uint64_t start = time_now_ns();
+        for (int i = 0; i < n; ++i) {
+            producers[i].count = RING_ITEMS / n; producers[i].sum = 0;
+            consumers[i].count = RING_ITEMS / n; consumers[i].sum = 0;
+            threads[i]     = fz_thread_create(ring_mpmc_producer, &producers[i]);
+            threads[n + i] = fz_thread_create(ring_mpmc_consumer, &consumers[i]);
+        }
+        for (int i = 0; i < 2 * n; ++i) fz_thread_join(threads[i]);
+        uint64_t elapsed = time_now_ns() - start;
+
+        uint64_t sum = 0;
+        for (int i = 0; i < n; ++i) sum += consumers[i].sum;
+        uint64_t per = RING_ITEMS / n;
+        assert(sum == (uint64_t)n * per * (per + 1) / 2);
+
+        char label[64];
+        snprintf(label, sizeof(label), "MPMC (%d -> %d)", n, n);
+        ring_report(label, elapsed);
+    }
+}
+
+/*
+ * ==================================================
+ * Jobs: per-job overhead and parallel_for scaling over the worker count.
+ * ==================================================
+ * */
+
+#define JOBS_ITEMS (1 << 20)
+
+static volatile uint32_t jobs_sum;
+
+// a few hundred cycles of busy work per item, stands in for simulating one fight.
+static void jobs_work(void *user_data, int begin, int end) {
+    fz_UNUSED(user_data);
+    uint32_t sum = 0;
+    for (int i = begin; i < end; ++i) {
+        uint32_t x = (uint32_t)i + 1;
+        for (int j = 0; j < 64; ++j) {
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+        }
+        sum += x;
+    }
+    fz_atomic_add32(&jobs_sum, sum);
+}
+
+static void jobs_empty(fz_Job *job, void *user_data) {
+    fz_UNUSED(job);
+    fz_UNUSED(user_data);
+}
+
+static void bench_jobs() {
+    int hardware = fz_thread_hardware_count();
+    printf("%d hardware threads.\n", hardware);
+
+    // through a pointer, so the serial run gets the same code the jobs get instead of an inlined copy.
+    fz_Job_Range_Func volatile serial = jobs_work;
+    BENCH_MEASURE("serial", JOBS_ITEMS, serial(0, 0, JOBS_ITEMS));
+
+    for (int workers = 1; workers <= hardware && workers <= fz_JOB_MAX_WORKERS; workers *= 2) {
+        fz_Job_System system;
+        fz_jobs_init(&system, workers - 1, fz_heap_allocator());
+
+        char label[64];
+        snprintf(label, sizeof(label), "parallel_for, %d workers", system.worker_count);
+        BENCH_MEASURE(label, JOBS_ITEMS, fz_jobs_parallel_for(JOBS_ITEMS, 1024, jobs_work, 0));
+
+        snprintf(label, sizeof(label), "empty jobs, %d workers", system.worker_count);
+        BENCH_MEASURE(label, 1024, {
+            fz_Job *root = fz_job_create(0, 0, 0);
+            for (int i = 0; i < 1024; ++i) fz_job_run(fz_job_create(jobs_empty, 0, root));
+            fz_job_run(root);
+            fz_job_wait(root);
+        });
+
+        fz_jobs_shutdown(&system);
+    }
+}
+
+/*
+ * ==================================================
+ * Turns: the old nested switch in turn_tick vs one load from turn_outcomes.
+ * random action pairs, so the switch can't lean on the branch predictor.
+ * ==================================================
+ * */
+
+#define TURN_PAIRS (1 << 16)
+
+static uint8_t turn_player_actions[TURN_PAIRS];
+static uint8_t turn_enemy_actions[TURN_PAIRS];
+
+// damage each side takes, the way turn_tick used to work it out.
+static inline void turn_resolve_switch(int player_action, int enemy_action, int *enemy_damage, int *player_damage) {
+    switch(player_action) {
+        case ACTION_SLASH: switch(enemy_action) {
+            case ACTION_PARRY: break;
+            default: *enemy_damage += 1; break;
+        } break;
+
+        case ACTION_TACKLE: switch(enemy_action) {
+            case ACTION_EVADE: break;
+            default: *enemy_damage += 1; break;
+        } break;
+
+        default: break;
+    }
+
+    switch(enemy_action) {
+        case ACTION_SLASH: switch(player_action) {
+            case ACTION_PARRY: break;
+            default: *player_damage += 1; break;
+        } break;
+
+        case ACTION_TACKLE: switch(player_action) {
+            case ACTION_EVADE: break;
+            default: *player_damage += 1; break;
+        } break;
+
+        default: break;
+    }
+}
+
+// shared by both loops, so the only difference between them is how damage is worked out.
+static inline void turns_count_quiet(int damage, int *quiet, int *longest_quiet) {
+    if (damage == 0) *quiet += 1;
+    else             *quiet = 0;
+    if (*quiet > *longest_quiet) *longest_quiet = *quiet;
+}
+
+// both return something that depends on every turn, so neither loop gets thrown away.
+static int turns_run_switch() {
+    int enemy_health = 0, player_health = 0, quiet = 0, longest_quiet = 0;
+    for (int i = 0; i < TURN_PAIRS; ++i) {
+        int enemy_damage = 0, player_damage = 0;
+        turn_resolve_switch(turn_player_actions[i], turn_enemy_actions[i], &enemy_damage, &player_damage);
+        enemy_health  -= enemy_damage;
+        player_health -= player_damage;
+
+        turns_count_quiet(enemy_damage | player_damage, &quiet, &longest_quiet);
+    }
+    return enemy_health + player_health + longest_quiet;
+}
+
+static int turns_run_table() {
+    int enemy_health = 0, player_health = 0, quiet = 0, longest_quiet = 0;
+    for (int i = 0; i < TURN_PAIRS; ++i) {
+        Turn_Outcome outcome = turn_outcomes.at[turn_player_actions[i]][turn_enemy_actions[i]];
+        enemy_health  -= outcome.damage_to_enemy;
+        player_health -= outcome.damage_to_player;
+
+        turns_count_quiet(outcome.damage_to_enemy | outcome.damage_to_player, &quiet, &longest_quiet);
+    }
+    return enemy_health + player_health + longest_quiet;
+}
+
+static void turns_load_stage(Combat *combat) {
+    combat_load_stage_one(combat);
+    combat->player.action_count = 3;
+    combat->player.actions[0].type = ACTION_SLASH;
+    combat->player.actions[1].type = ACTION_PARRY;
+    combat->player.actions[2].type = ACTION_TACKLE;
+}
+
+#define BATCH_PLANS 4096
+
+static uint32_t batch_plans[BATCH_PLANS];
+static int32_t  batch_counts[BATCH_PLANS];
+static int32_t  batch_status[BATCH_PLANS];
+static int32_t  batch_turns[BATCH_PLANS];
+static Action   batch_actions[BATCH_PLANS][ACTION_CAPACITY];
+
+// every plan through stage one, one combat_run each.
+static uint64_t turns_batch_run_single(Combat *stage) {
+    uint64_t total = 0;
+    Combat combat = {};
+    combat.enemies = VecCreate(Enemy_Chain, VecLen(stage->enemies));
+    for (int i = 0; i < VecLen(stage->enemies); ++i) VecPush(combat.enemies, stage->enemies[i]);
+    for (int i = 0; i < BATCH_PLANS; ++i) {
+        memcpy(combat.enemies, stage->enemies, sizeof(Enemy_Chain) * VecLen(stage->enemies));
+        combat.chain_index = combat.enemy_index = combat.infinite_loop_counter = 0;
+        combat.player.health = combat.player.max_health = 5;
+        combat.player.action_index = 0;
+        combat.player.action_count = batch_counts[i];
+        memcpy(combat.player.actions, batch_actions[i], sizeof(Action) * batch_counts[i]);
+
+        uint64_t turns = 0;
+        batch_status[i] = combat_run(&combat, &turns);
+        total += turns;
+    }
+    VecRelease(combat.enemies);
+    return total;
+}
+
+static uint64_t turns_batch_run_lanes(Combat *stage) {
+    combat_simulate_batch(stage, batch_plans, batch_counts, BATCH_PLANS, batch_status, batch_turns, 0);
+    uint64_t total = 0;
+    for (int i = 0; i < BATCH_PLANS; ++i) total += (uint64_t)batch_turns[i];
+    return total;
+}
+
+// combat_run as it was before combat_resolve_enemy: every turn resolved.
+static Combat_Status turns_run_stepped(Combat *combat, uint64_t *turns) {
+    for (;;) {
+        Combat_Status status = combat_status(combat);
+        switch (status) {
+            case COMBAT_ONGOING:        combat_resolve_turn(combat); (*turns)++; break;
+            case COMBAT_CHAIN_COMPLETE: combat_next_chain(combat); break;
+            case COMBAT_ENEMY_DEAD:
+            {
+                if ((combat->enemy_index + 1) < combat->enemies[combat->chain_index].enemy_count) combat_next_enemy(combat);
+                else                                                                                combat_next_chain(combat);
+            } break;
+            default: return status;
+        }
+    }
+}
+
+// stage one with everyone at 100x health, so fights last many periods.
+static void turns_load_long_stage(Combat *combat) {
+    turns_load_stage(combat);
+    combat->player.health *= 100;
+    for (int c = 0; c < VecLen(combat->enemies); ++c) {
+        for (int e = 0; e < combat->enemies[c].enemy_count; ++e) combat->enemies[c].enemies[e].health *= 100;
+    }
+}
+
+static void turns_long_stepped(Combat *combat, uint64_t *turns) {
+    turns_load_long_stage(combat);
+    turns_run_stepped(combat, turns);
+}
+
+static void turns_long_skipping(Combat *combat, uint64_t *turns) {
+    turns_load_long_stage(combat);
+    combat_run(combat, turns);
+}
+
+static void bench_turns() {
+    for (int i = 0; i < TURN_PAIRS; ++i) {
+        turn_player_actions[i] = (uint8_t)(ACTION_SLASH + rng_next() % (ACTION_COUNT - ACTION_SLASH));
+        turn_enemy_actions[i]  = (uint8_t)(ACTION_SLASH + rng_next() % (ACTION_COUNT - ACTION_SLASH));
+    }
+    assert(turns_run_switch() == turns_run_table());
+
+    BENCH_MEASURE("nested switch",       TURN_PAIRS, bench_sink += (uint64_t)turns_run_switch());
+    BENCH_MEASURE("turn_outcomes table", TURN_PAIRS, bench_sink += (uint64_t)turns_run_table());
+
+    // the same in context: whole stage one runs through combat_run.
+    Combat combat = {};
+    turns_load_stage(&combat);
+
+    uint64_t turns = 0;
+    combat_run(&combat, &turns);
+    uint64_t turns_per_run = turns;
+
+    BENCH_MEASURE("stage one load + combat_run, per turn", turns_per_run, {
+        turns_load_stage(&combat);
+        combat_run(&combat, &turns);
+    });
+    bench_sink += turns;
+
+    // long fights, per turn: every turn resolved vs whole periods skipped.
+    uint64_t stepped_turns = 0, skipped_turns = 0;
+    turns_long_stepped(&combat, &stepped_turns);
+    turns_long_skipping(&combat, &skipped_turns);
+    assert(stepped_turns == skipped_turns);
+
+    BENCH_MEASURE("100x health, turn by turn", stepped_turns, turns_long_stepped(&combat, &turns));
+    BENCH_MEASURE("100x health, combat_run", stepped_turns, turns_long_skipping(&combat, &turns));
+    bench_sink += turns;
+
+    // many plans through stage one, per turn: combat_run one plan at a time vs combat_simulate_batch.
+    for (int i = 0; i < BATCH_PLANS; ++i) {
+        batch_counts[i] = 1 + (int32_t)(rng_next() % ACTION_CAPACITY);
+        for (int j = 0; j < batch_counts[i]; ++j) {
+            batch_actions[i][j].type = ACTION_SLASH + (int)(rng_next() % (ACTION_COUNT - ACTION_SLASH));
+        }
+        batch_plans[i] = combat_pack_plan(batch_actions[i], batch_counts[i]);
+    }
+    combat_load_stage_one(&combat);
+    uint64_t batch_turn_count = turns_batch_run_single(&combat);
+    assert(batch_turn_count == turns_batch_run_lanes(&combat));
+
+    BENCH_MEASURE("combat_run per plan", batch_turn_count, bench_sink += turns_batch_run_single(&combat));
+    char label[64];
+    snprintf(label, sizeof(label), "combat_simulate_batch (%s)", combat_batch_kernel_name());
+    BENCH_MEASURE(label, batch_turn_count, bench_sink += turns_batch_run_lanes(&combat));
+
+    VecRelease(combat.enemies);
+}
+
+/*
+ * ==================================================
+ * Entry.
+ * ==================================================
+ * */
+
+struct Bench_Entry {
+    const char *name;
+    void      (*func)();
+};
+
+static Bench_Entry benchmarks[] = {
+    { "sort",      bench_sort },
+    { "hugepages", bench_huge_pages },
+    { "alloc",     bench_allocators },
+    { "ring",      bench_ring_buffers },
+    { "jobs",      bench_jobs },
+    { "turns",     bench_turns },
+};
+
+int main(int argc, char **argv) {
+    const char *filter = argc > 1 ? argv[1] : "";
+
+    for (int i = 0; i < (int)fz_COUNTOF(benchmarks); ++i) {
+        if (strncmp(benchmarks[i].name, filter, strlen(filter)) != 0) continue;
+        printf("==== %s ====\n", benchmarks[i].name);
+        benchmarks[i].func();
+    }
+
+    return 0;
+}
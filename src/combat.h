@@ -0,0 +1,893 @@
+/* ============================================================
+ *  Combat core.
+ *  turn resolution rules without raylib: no window, no audio device, no GL context.
+ *  the slash / parry / tackle / evade rules are data: action_rules, expanded at compile time into turn_outcomes.
+ *  the game layer turns Turn_Result into sounds / effects / camera shake,
+ *  headless users (combat_sim, bots, balancing) call combat_run, which skips through fights a period at a time.
+ *
+ *  #define FUZZY_COMBAT_H_IMPL in exactly one translation unit, same as my.h.
+ */
+
+#ifndef FUZZY_COMBAT_H
+#define FUZZY_COMBAT_H
+
+#include "my.h"
+
+#define ACTION_CAPACITY 10
+#define ENEMY_CAPACITY  5
+
+/* Turns in a row without anyone taking damage before the fight is called off. */
+#define INFINITE_LOOP_FORCEQUIT 50
+
+enum
+{
+    ACTION_NONE = 0,
+    /* Volatile: order must match with asset enum */
+    ACTION_SLASH,
+    ACTION_EVADE,
+    ACTION_PARRY,
+    ACTION_TACKLE,
+    ACTION_COUNT,
+};
+
+struct Action {
+    int type;
+};
+
+struct Actor {
+    int health;
+    int max_health;
+    int action_index;
+    int action_count;
+    Action actions[ACTION_CAPACITY];
+};
+
+struct Enemy_Chain {
+    int   enemy_count;
+    Actor enemies[ENEMY_CAPACITY];
+};
+
+struct Combat {
+    Actor player;
+
+    Vec(Enemy_Chain) enemies;
+    int chain_index;
+    int enemy_index;
+
+    int infinite_loop_counter; /* turns since anyone took damage. */
+};
+
+enum Combat_Status
+{
+    COMBAT_ONGOING,
+    COMBAT_FORCEQUIT,      /* INFINITE_LOOP_FORCEQUIT turns without damage. */
+    COMBAT_PLAYER_DEAD,
+    COMBAT_STAGE_COMPLETE, /* every chain is done. */
+    COMBAT_CHAIN_COMPLETE, /* every enemy of the current chain is done. */
+    COMBAT_ENEMY_DEAD,
+};
+
+enum /* What one side's action looked / sounded like. */
+{
+    CUE_NONE,       /* didn't attack. */
+    CUE_PARRIED,
+    CUE_EVADED,
+    CUE_SLASH_HIT,
+    CUE_TACKLE_HIT,
+    CUE_COUNT,
+};
+
+/* One row per action. a new action type is a new row here (and its icon / sound), nothing else. */
+struct Action_Rule {
+    int8_t  damage;      /* dealt when it lands. 0: not an attack. */
+    int8_t  blocked_by;  /* action that stops it. */
+    uint8_t hit_cue;
+    uint8_t blocked_cue;
+};
+
+constexpr Action_Rule action_rules[ACTION_COUNT] = {
+    /* ACTION_NONE   */ { 0, ACTION_NONE,  CUE_NONE,       CUE_NONE    },
+    /* ACTION_SLASH  */ { 1, ACTION_PARRY, CUE_SLASH_HIT,  CUE_PARRIED },
+    /* ACTION_EVADE  */ { 0, ACTION_NONE,  CUE_NONE,       CUE_NONE    },
+    /* ACTION_PARRY  */ { 0, ACTION_NONE,  CUE_NONE,       CUE_NONE    },
+    /* ACTION_TACKLE */ { 1, ACTION_EVADE, CUE_TACKLE_HIT, CUE_EVADED  },
+};
+
+/* Both sides of one turn. 4 bytes, so resolving a turn is one load. */
+struct Turn_Outcome {
+    int8_t  damage_to_enemy;
+    int8_t  damage_to_player;
+    uint8_t player_cue; /* player's action on the enemy. */
+    uint8_t enemy_cue;  /* enemy's action on the player. */
+};
+
+constexpr Turn_Outcome make_turn_outcome(int player_action, int enemy_action) {
+    Action_Rule player = action_rules[player_action];
+    Action_Rule enemy  = action_rules[enemy_action];
+
+    int player_lands = player.damage && player.blocked_by != enemy_action;
+    int enemy_lands  = enemy.damage  && enemy.blocked_by  != player_action;
+
+    Turn_Outcome outcome = {
+        (int8_t)(player_lands ? player.damage : 0),
+        (int8_t)(enemy_lands  ? enemy.damage  : 0),
+        (uint8_t)(player.damage ? (player_lands ? player.hit_cue : player.blocked_cue) : CUE_NONE),
+        (uint8_t)(enemy.damage  ? (enemy_lands  ? enemy.hit_cue  : enemy.blocked_cue)  : CUE_NONE),
+    };
+    return outcome;
+}
+
+struct Turn_Outcome_Table {
+    Turn_Outcome at[ACTION_COUNT][ACTION_COUNT]; /* [player action][enemy action] */
+};
+
+constexpr Turn_Outcome_Table make_turn_outcome_table() {
+    Turn_Outcome_Table table = {};
+    for (int p = 0; p < ACTION_COUNT; ++p) {
+        for (int e = 0; e < ACTION_COUNT; ++e) {
+            table.at[p][e] = make_turn_outcome(p, e);
+        }
+    }
+    return table;
+}
+
+constexpr Turn_Outcome_Table turn_outcomes = make_turn_outcome_table();
+
+static_assert(sizeof(Turn_Outcome) == 4, "Turn_Outcome should stay one 32-bit load.");
+static_assert(turn_outcomes.at[ACTION_SLASH][ACTION_PARRY].damage_to_enemy   == 0, "Parry blocks Slash.");
+static_assert(turn_outcomes.at[ACTION_TACKLE][ACTION_EVADE].damage_to_enemy  == 0, "Evade blocks Tackle.");
+static_assert(turn_outcomes.at[ACTION_TACKLE][ACTION_SLASH].damage_to_player == 1, "Both attacks land.");
+
+struct Turn_Result {
+    int          player_action;
+    int          enemy_action;
+    Turn_Outcome outcome;
+};
+
+Action get_next_action_for(Actor *actor);
+
+/* Checked in this order: forcequit, player, stage, chain, enemy. */
+Combat_Status combat_status(Combat *combat);
+
+/* Both sides take their next action; damage and the infinite loop counter are applied. */
+Turn_Result combat_resolve_turn(Combat *combat);
+
+/* Fights the current enemy until it or the player dies or the loop counter hits INFINITE_LOOP_FORCEQUIT, and leaves
+ * combat exactly where combat_resolve_turn in a loop would. both sides replay their buffers, so the fight repeats every
+ * lcm(player, enemy action_count) turns: one period is played (two when a period is long enough to hold a quiet streak
+ * of INFINITE_LOOP_FORCEQUIT), after that a quiet period is a stalemate and otherwise whole periods are skipped up to
+ * the one where someone dies. returns the turns fought. */
+uint64_t combat_resolve_enemy(Combat *combat);
+
+/* After COMBAT_ENEMY_DEAD / COMBAT_CHAIN_COMPLETE. both give the player a fresh loop counter. */
+void combat_next_enemy(Combat *combat);
+void combat_next_chain(Combat *combat);
+
+/* Runs turns and moves through enemies / chains with the player's current plan, until the player
+ * dies, the stage is complete or the fight is called off. returns that status, turns get added to turns_out. */
+Combat_Status combat_run(Combat *combat, uint64_t *turns_out);
+
+void combat_reset(Combat *combat);
+void combat_load_stage_one(Combat *combat);
+
+/* ============================================================
+ *  Batch simulation.
+ *  scores lots of player plans against the rest of a stage: one fight per SIMD lane (AVX2: 8, SSE4.1: 4,
+ *  otherwise one at a time), COMBAT_BATCH_UNROLL vectors in flight so independent fights hide each other's latency.
+ *  same rules and same order of checks as combat_run. chains only reset the loop counter, so the enemies left
+ *  in the stage are played as one list.
+ *  which kernel is used is decided at compile time, see fz_HAS_AVX2 / fz_HAS_SSE41 in my.h.
+ */
+
+#ifndef COMBAT_BATCH_UNROLL
+#define COMBAT_BATCH_UNROLL 4
+#endif
+
+#define COMBAT_PLAN_BITS 3 /* per action in a packed plan; action i sits at bit i * COMBAT_PLAN_BITS. */
+
+static_assert(ACTION_COUNT <= (1 << COMBAT_PLAN_BITS), "Action types don't fit a packed plan anymore.");
+static_assert(ACTION_CAPACITY * COMBAT_PLAN_BITS <= 32, "A packed plan is one 32-bit lane.");
+
+#define COMBAT_BATCH_MAX_ENEMIES 16 /* left in the stage, over all chains. more than that goes through combat_run. */
+
+uint32_t combat_pack_plan(const Action *actions, int count);
+
+/* plans[i] (combat_pack_plan) has plan_counts[i] actions, 1 to ACTION_CAPACITY. every fight starts where stage is:
+ * its chain / enemy / loop counter, the enemies' health and action_index and the player's health; plans from their first action.
+ * status_out[i]: COMBAT_STAGE_COMPLETE (won), COMBAT_PLAYER_DEAD or COMBAT_FORCEQUIT. turns_out[i]: turns fought.
+ * health_out[i]: player health at the end, may be null.
+ * a stage with more than COMBAT_BATCH_MAX_ENEMIES enemies left is played one plan at a time with combat_run. */
+void combat_simulate_batch(const Combat *stage, const uint32_t *plans, const int32_t *plan_counts, int count,
+                           int32_t *status_out, int32_t *turns_out, int32_t *health_out);
+
+/* "AVX2", "SSE4.1" or "scalar". */
+const char *combat_batch_kernel_name(void);
+
+#endif // FUZZY_COMBAT_H
+
+/* ============================================================
+ *  Implementation.
+ */
+
+#if defined(FUZZY_COMBAT_H_IMPL) && !defined(FUZZY_COMBAT_H_IMPLEMENTED)
+#define FUZZY_COMBAT_H_IMPLEMENTED 1
+
+Action get_next_action_for(Actor *actor) {
+    Action action = actor->actions[actor->action_index];
+    actor->action_index = (actor->action_index + 1) % actor->action_count;
+
+    return action;
+}
+
+Combat_Status combat_status(Combat *combat) {
+    if (combat->infinite_loop_counter == INFINITE_LOOP_FORCEQUIT) return COMBAT_FORCEQUIT;
+    if (combat->player.health <= 0)                                return COMBAT_PLAYER_DEAD;
+    if (combat->chain_index == VecLen(combat->enemies))           return COMBAT_STAGE_COMPLETE;
+
+    Enemy_Chain *chain = &combat->enemies[combat->chain_index];
+    if (combat->enemy_index == chain->enemy_count)                 return COMBAT_CHAIN_COMPLETE;
+    if (chain->enemies[combat->enemy_index].health <= 0)           return COMBAT_ENEMY_DEAD;
+
+    return COMBAT_ONGOING;
+}
+
+Turn_Result combat_resolve_turn(Combat *combat) {
+    Actor *player = &combat->player;
+    Actor *enemy  = &combat->enemies[combat->chain_index].enemies[combat->enemy_index];
+
+    Turn_Result result;
+    result.player_action = get_next_action_for(player).type;
+    result.enemy_action  = get_next_action_for(enemy).type;
+    result.outcome = turn_outcomes.at[result.player_action][result.enemy_action];
+
+    enemy->health  -= result.outcome.damage_to_enemy;
+    player->health -= result.outcome.damage_to_player;
+
+    /* nobody got hurt: one more quiet turn, otherwise start over. */
+    int quiet = (result.outcome.damage_to_enemy | result.outcome.damage_to_player) == 0;
+    combat->infinite_loop_counter = (combat->infinite_loop_counter + 1) * quiet;
+    return result;
+}
+
+static int combat__fight_over(Combat *combat) {
+    Actor *enemy = &combat->enemies[combat->chain_index].enemies[combat->enemy_index];
+    return combat->infinite_loop_counter == INFINITE_LOOP_FORCEQUIT || combat->player.health <= 0 || enemy->health <= 0;
+}
+
+uint64_t combat_resolve_enemy(Combat *combat) {
+    Actor *player = &combat->player;
+    Actor *enemy  = &combat->enemies[combat->chain_index].enemies[combat->enemy_index];
+    assert(player->action_count > 0 && enemy->action_count > 0);
+
+    int a = player->action_count, b = enemy->action_count;
+    while (b) { int r = a % b; a = b; b = r; }
+    int period = player->action_count / a * enemy->action_count;
+
+    /* past the first period the loop counter starts every period at the same value, so a second one shows every
+     * quiet streak there is. a period shorter than INFINITE_LOOP_FORCEQUIT can't hold one unless it is all quiet. */
+    int played = (period >= INFINITE_LOOP_FORCEQUIT) ? 2 : 1;
+
+    uint64_t turns = 0;
+    int player_health = 0, enemy_health = 0;
+    for (int p = 0; p < played; ++p) {
+        player_health = player->health;
+        enemy_health  = enemy->health;
+        for (int t = 0; t < period; ++t) {
+            if (combat__fight_over(combat)) return turns;
+            combat_resolve_turn(combat);
+            turns++;
+        }
+    }
+    if (combat__fight_over(combat)) return turns;
+
+    int player_loss = player_health - player->health;
+    int enemy_loss  = enemy_health  - enemy->health;
+
+    if (!player_loss && !enemy_loss) {
+        /* stalemate: every turn from here on is quiet, the counter just runs up. */
+        int skipped = INFINITE_LOOP_FORCEQUIT - combat->infinite_loop_counter;
+        assert(skipped > 0);
+        player->action_index = (player->action_index + skipped) % player->action_count;
+        enemy->action_index  = (enemy->action_index  + skipped) % enemy->action_count;
+        combat->infinite_loop_counter = INFINITE_LOOP_FORCEQUIT;
+        return turns + (uint64_t)skipped;
+    }
+
+    /* whole periods that leave both alive; buffers end up where they started, so does the loop counter. */
+    int periods = INT32_MAX;
+    if (player_loss && (player->health - 1) / player_loss < periods) periods = (player->health - 1) / player_loss;
+    if (enemy_loss  && (enemy->health  - 1) / enemy_loss  < periods) periods = (enemy->health  - 1) / enemy_loss;
+    player->health -= periods * player_loss;
+    enemy->health  -= periods * enemy_loss;
+    turns += (uint64_t)periods * (uint64_t)period;
+
+    while (!combat__fight_over(combat)) {
+        combat_resolve_turn(combat);
+        turns++;
+    }
+    return turns;
+}
+
+void combat_next_enemy(Combat *combat) {
+    combat->enemy_index++;
+    combat->infinite_loop_counter = 0;
+}
+
+void combat_next_chain(Combat *combat) {
+    if (combat->chain_index < VecLen(combat->enemies)) {
+        combat->chain_index++;
+        combat->enemy_index = 0;
+    }
+    combat->infinite_loop_counter = 0;
+}
+
+Combat_Status combat_run(Combat *combat, uint64_t *turns_out) {
+    assert(combat->player.action_count > 0);
+
+    uint64_t turns = 0;
+    for (;;) {
+        Combat_Status status = combat_status(combat);
+        switch(status) {
+            case COMBAT_ONGOING:
+            {
+                turns += combat_resolve_enemy(combat);
+            } break;
+
+            case COMBAT_ENEMY_DEAD:
+            {
+                /* same as the game: the last enemy of a chain moves on to the next chain. */
+                Enemy_Chain *chain = &combat->enemies[combat->chain_index];
+                if ((combat->enemy_index + 1) < chain->enemy_count) combat_next_enemy(combat);
+                else                                                 combat_next_chain(combat);
+            } break;
+
+            case COMBAT_CHAIN_COMPLETE:
+            {
+                combat_next_chain(combat);
+            } break;
+
+            default:
+            {
+                if (turns_out) *turns_out += turns;
+                return status;
+            }
+        }
+    }
+}
+
+void combat_reset(Combat *combat) {
+    combat->enemy_index = 0;
+    combat->chain_index = 0;
+    combat->infinite_loop_counter = 0;
+    combat->player.health = combat->player.max_health = 5;
+    combat->player.action_count = 0;
+    combat->player.action_index = 0;
+    VecClear(combat->enemies);
+}
+
+void combat_load_stage_one(Combat *combat) {
+    combat_reset(combat);
+
+    /* chains are built in place, copying one is 5 actors worth of actions. */
+    fz_Vector<Enemy_Chain> enemies(combat->enemies);
+    {
+        Enemy_Chain &chain = enemies.emplace();
+
+        /* First wave */
+        chain.enemies[0].health = chain.enemies[0].max_health = 3;
+        chain.enemies[0].actions[chain.enemies[0].action_count++].type = ACTION_SLASH;
+        chain.enemies[0].actions[chain.enemies[0].action_count++].type = ACTION_PARRY;
+
+        chain.enemy_count++;
+        chain.enemies[1].health = chain.enemies[1].max_health = 3;
+        chain.enemies[1].actions[chain.enemies[1].action_count++].type = ACTION_SLASH;
+        chain.enemies[1].actions[chain.enemies[1].action_count++].type = ACTION_EVADE;
+
+        chain.enemy_count++;
+        chain.enemies[2].health = chain.enemies[2].max_health = 3;
+        chain.enemies[2].actions[chain.enemies[2].action_count++].type = ACTION_SLASH;
+        chain.enemies[2].actions[chain.enemies[2].action_count++].type = ACTION_PARRY;
+        chain.enemies[2].actions[chain.enemies[2].action_count++].type = ACTION_SLASH;
+        chain.enemies[2].actions[chain.enemies[2].action_count++].type = ACTION_EVADE;
+    }
+
+    {
+        Enemy_Chain &chain = enemies.emplace();
+
+        /* Second wave */
+        chain.enemies[0].health = chain.enemies[0].max_health = 3;
+        chain.enemies[0].actions[chain.enemies[0].action_count++].type = ACTION_SLASH;
+        chain.enemies[0].actions[chain.enemies[0].action_count++].type = ACTION_PARRY;
+        chain.enemies[0].actions[chain.enemies[0].action_count++].type = ACTION_TACKLE;
+        chain.enemies[0].actions[chain.enemies[0].action_count++].type = ACTION_PARRY;
+
+        chain.enemy_count++;
+        chain.enemies[1].health = chain.enemies[1].max_health = 3;
+        chain.enemies[1].actions[chain.enemies[1].action_count++].type = ACTION_EVADE;
+        chain.enemies[1].actions[chain.enemies[1].action_count++].type = ACTION_SLASH;
+        chain.enemies[1].actions[chain.enemies[1].action_count++].type = ACTION_PARRY;
+        chain.enemies[1].actions[chain.enemies[1].action_count++].type = ACTION_PARRY;
+
+        chain.enemy_count++;
+        chain.enemies[2].health = chain.enemies[2].max_health = 3;
+        chain.enemies[2].actions[chain.enemies[2].action_count++].type = ACTION_TACKLE;
+        chain.enemies[2].actions[chain.enemies[2].action_count++].type = ACTION_SLASH;
+        chain.enemies[2].actions[chain.enemies[2].action_count++].type = ACTION_EVADE;
+        chain.enemies[2].actions[chain.enemies[2].action_count++].type = ACTION_EVADE;
+
+        chain.enemy_count++;
+        chain.enemies[3].health = chain.enemies[3].max_health = 3;
+        chain.enemies[3].actions[chain.enemies[3].action_count++].type = ACTION_EVADE;
+        chain.enemies[3].actions[chain.enemies[3].action_count++].type = ACTION_PARRY;
+        chain.enemies[3].actions[chain.enemies[3].action_count++].type = ACTION_TACKLE;
+        chain.enemies[3].actions[chain.enemies[3].action_count++].type = ACTION_TACKLE;
+    }
+
+    {
+        Enemy_Chain &chain = enemies.emplace();
+
+        /* Second wave */
+        chain.enemies[0].health = chain.enemies[0].max_health = 3;
+        chain.enemies[0].actions[chain.enemies[0].action_count++].type = ACTION_PARRY;
+        chain.enemies[0].actions[chain.enemies[0].action_count++].type = ACTION_PARRY;
+        chain.enemies[0].actions[chain.enemies[0].action_count++].type = ACTION_TACKLE;
+        chain.enemies[0].actions[chain.enemies[0].action_count++].type = ACTION_EVADE;
+        chain.enemies[0].actions[chain.enemies[0].action_count++].type = ACTION_EVADE;
+
+        chain.enemy_count++;
+        chain.enemies[1].health = chain.enemies[1].max_health = 3;
+        chain.enemies[1].actions[chain.enemies[1].action_count++].type = ACTION_EVADE;
+        chain.enemies[1].actions[chain.enemies[1].action_count++].type = ACTION_EVADE;
+        chain.enemies[1].actions[chain.enemies[1].action_count++].type = ACTION_SLASH;
+        chain.enemies[1].actions[chain.enemies[1].action_count++].type = ACTION_PARRY;
+        chain.enemies[1].actions[chain.enemies[1].action_count++].type = ACTION_PARRY;
+
+        chain.enemy_count++;
+        chain.enemies[2].health = chain.enemies[2].max_health = 3;
+        chain.enemies[2].actions[chain.enemies[2].action_count++].type = ACTION_TACKLE;
+        chain.enemies[2].actions[chain.enemies[2].action_count++].type = ACTION_SLASH;
+        chain.enemies[2].actions[chain.enemies[2].action_count++].type = ACTION_EVADE;
+        chain.enemies[2].actions[chain.enemies[2].action_count++].type = ACTION_SLASH;
+        chain.enemies[2].actions[chain.enemies[2].action_count++].type = ACTION_EVADE;
+        chain.enemies[2].actions[chain.enemies[2].action_count++].type = ACTION_PARRY;
+
+        chain.enemy_count++;
+        chain.enemies[3].health = chain.enemies[3].max_health = 3;
+        chain.enemies[3].actions[chain.enemies[3].action_count++].type = ACTION_EVADE;
+        chain.enemies[3].actions[chain.enemies[3].action_count++].type = ACTION_PARRY;
+        chain.enemies[3].actions[chain.enemies[3].action_count++].type = ACTION_TACKLE;
+        chain.enemies[3].actions[chain.enemies[3].action_count++].type = ACTION_EVADE;
+        chain.enemies[3].actions[chain.enemies[3].action_count++].type = ACTION_SLASH;
+        chain.enemies[3].actions[chain.enemies[3].action_count++].type = ACTION_PARRY;
+        chain.enemies[3].actions[chain.enemies[3].action_count++].type = ACTION_SLASH;
+        chain.enemies[3].actions[chain.enemies[3].action_count++].type = ACTION_EVADE;
+    }
+
+    combat->enemies = enemies.data;
+}
+
+/* ============================================================
+ *  Batch simulation.
+ */
+
+/* turn_outcomes, one bit per (player action, enemy action) pair: bit (p * ACTION_COUNT + e) of plane b is bit b of the damage. */
+struct Combat__Damage_Bits {
+    uint32_t to_enemy[2];
+    uint32_t to_player[2];
+};
+
+constexpr Combat__Damage_Bits make_damage_bits() {
+    Combat__Damage_Bits bits = {};
+    for (int p = 0; p < ACTION_COUNT; ++p) {
+        for (int e = 0; e < ACTION_COUNT; ++e) {
+            int pair = p * ACTION_COUNT + e;
+            Turn_Outcome outcome = turn_outcomes.at[p][e];
+            for (int b = 0; b < 2; ++b) {
+                bits.to_enemy[b]  |= (uint32_t)((outcome.damage_to_enemy  >> b) & 1) << pair;
+                bits.to_player[b] |= (uint32_t)((outcome.damage_to_player >> b) & 1) << pair;
+            }
+        }
+    }
+    return bits;
+}
+
+constexpr int max_action_damage() {
+    int result = 0;
+    for (int i = 0; i < ACTION_COUNT; ++i) result = action_rules[i].damage > result ? action_rules[i].damage : result;
+    return result;
+}
+
+static_assert(ACTION_COUNT * ACTION_COUNT <= 32, "Damage bits are one 32-bit mask per plane.");
+static_assert(max_action_damage() <= 3, "Batch simulation carries damage in two bit planes.");
+
+constexpr Combat__Damage_Bits combat__damage_bits = make_damage_bits();
+
+/* Per enemy left in the stage, in the order combat_run meets them. */
+struct Combat__Stage_Tables {
+    int32_t plan[COMBAT_BATCH_MAX_ENEMIES];        /* packed, full rotation. */
+    int32_t count[COMBAT_BATCH_MAX_ENEMIES];
+    int32_t start_state[COMBAT_BATCH_MAX_ENEMIES]; /* packed, from the enemy's current action_index on. */
+    int32_t start_left[COMBAT_BATCH_MAX_ENEMIES];
+    int32_t health[COMBAT_BATCH_MAX_ENEMIES];
+    int32_t enemy_count;
+    int32_t quiet;                                 /* loop counter the stage is at. */
+    int32_t player_health;
+};
+
+/*
+ * Lane operations. masks are all ones / all zeros per lane, same as the SIMD compares.
+ */
+
+struct Combat__Lanes_Scalar {
+    typedef int32_t V;
+    enum { WIDTH = 1 };
+
+    static V    set1(int32_t x)              { return x; }
+    static V    load(const int32_t *p)       { return *p; }
+    static void store(int32_t *p, V v)       { *p = v; }
+    static V    add(V a, V b)                { return (V)((uint32_t)a + (uint32_t)b); }
+    static V    sub(V a, V b)                { return (V)((uint32_t)a - (uint32_t)b); }
+    static V    and_(V a, V b)               { return a & b; }
+    static V    or_(V a, V b)                { return a | b; }
+    static V    andnot(V mask, V b)          { return ~mask & b; }
+    static V    cmpeq(V a, V b)              { return -(V)(a == b); }
+    static V    cmpgt(V a, V b)              { return -(V)(a > b); }
+    static V    blend(V a, V b, V mask)      { return (a & ~mask) | (b & mask); }
+    static V    next_action(V plan)          { return (V)((uint32_t)plan >> COMBAT_PLAN_BITS); }
+    static V    pair_index(V p, V e)         { return p * ACTION_COUNT + e; }
+    static V    bit(uint32_t mask, V index)  { return (V)((mask >> index) & 1); }
+    static V    lookup(const int32_t *table, V index) { return table[index]; }
+    static int  any(V mask)                  { return mask != 0; }
+};
+
+#if defined(fz_HAS_SSE41)
+struct Combat__Lanes_Sse41 {
+    typedef __m128i V;
+    enum { WIDTH = 4 };
+
+    static V    set1(int32_t x)              { return _mm_set1_epi32(x); }
+    static V    load(const int32_t *p)       { return _mm_loadu_si128((const __m128i *)p); }
+    static void store(int32_t *p, V v)       { _mm_storeu_si128((__m128i *)p, v); }
+    static V    add(V a, V b)                { return _mm_add_epi32(a, b); }
+    static V    sub(V a, V b)                { return _mm_sub_epi32(a, b); }
+    static V    and_(V a, V b)               { return _mm_and_si128(a, b); }
+    static V    or_(V a, V b)                { return _mm_or_si128(a, b); }
+    static V    andnot(V mask, V b)          { return _mm_andnot_si128(mask, b); }
+    static V    cmpeq(V a, V b)              { return _mm_cmpeq_epi32(a, b); }
+    static V    cmpgt(V a, V b)              { return _mm_cmpgt_epi32(a, b); }
+    static V    blend(V a, V b, V mask)      { return _mm_blendv_epi8(a, b, mask); }
+    static V    next_action(V plan)          { return _mm_srli_epi32(plan, COMBAT_PLAN_BITS); }
+    static V    pair_index(V p, V e)         { return _mm_add_epi32(_mm_mullo_epi32(p, _mm_set1_epi32(ACTION_COUNT)), e); }
+
+    /* no variable shifts before AVX2: 1 << index comes from the float 2^index. pair indices stay under
+     * ACTION_COUNT * ACTION_COUNT (25); exact up to 31 anyway, 2^31 converts to 0x80000000. */
+    static V bit(uint32_t mask, V index) {
+        V pow2 = _mm_cvttps_epi32(_mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(index, _mm_set1_epi32(127)), 23)));
+        V hit  = _mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32((int32_t)mask), pow2), pow2);
+        return _mm_srli_epi32(hit, 31);
+    }
+
+    static V lookup(const int32_t *table, V index) {
+        V result = _mm_set1_epi32(table[0]);
+        for (int i = 1; i < COMBAT_BATCH_MAX_ENEMIES; ++i) {
+            result = _mm_blendv_epi8(result, _mm_set1_epi32(table[i]), _mm_cmpeq_epi32(index, _mm_set1_epi32(i)));
+        }
+        return result;
+    }
+
+    static int any(V mask) { return _mm_movemask_epi8(mask) != 0; }
+};
+#endif
+
+#if defined(fz_HAS_AVX2)
+struct Combat__Lanes_Avx2 {
+    typedef __m256i V;
+    enum { WIDTH = 8 };
+
+    static V    set1(int32_t x)              { return _mm256_set1_epi32(x); }
+    static V    load(const int32_t *p)       { return _mm256_loadu_si256((const __m256i *)p); }
+    static void store(int32_t *p, V v)       { _mm256_storeu_si256((__m256i *)p, v); }
+    static V    add(V a, V b)                { return _mm256_add_epi32(a, b); }
+    static V    sub(V a, V b)                { return _mm256_sub_epi32(a, b); }
+    static V    and_(V a, V b)               { return _mm256_and_si256(a, b); }
+    static V    or_(V a, V b)                { return _mm256_or_si256(a, b); }
+    static V    andnot(V mask, V b)          { return _mm256_andnot_si256(mask, b); }
+    static V    cmpeq(V a, V b)              { return _mm256_cmpeq_epi32(a, b); }
+    static V    cmpgt(V a, V b)              { return _mm256_cmpgt_epi32(a, b); }
+    static V    blend(V a, V b, V mask)      { return _mm256_blendv_epi8(a, b, mask); }
+    static V    next_action(V plan)          { return _mm256_srli_epi32(plan, COMBAT_PLAN_BITS); }
+    static V    pair_index(V p, V e)         { return _mm256_add_epi32(_mm256_mullo_epi32(p, _mm256_set1_epi32(ACTION_COUNT)), e); }
+    static V    bit(uint32_t mask, V index)  { return _mm256_and_si256(_mm256_srlv_epi32(_mm256_set1_epi32((int32_t)mask), index), _mm256_set1_epi32(1)); }
+    static V    lookup(const int32_t *table, V index) {
+        V low  = _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i *)table),       index);
+        V high = _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i *)(table + 8)), index);
+        return _mm256_blendv_epi8(low, high, _mm256_cmpgt_epi32(index, _mm256_set1_epi32(7)));
+    }
+    static int  any(V mask)                  { return _mm256_movemask_epi8(mask) != 0; }
+};
+#endif
+
+/* One vector of fights, a field per register. */
+template<typename L>
+struct Combat__Fights {
+    typedef typename L::V V;
+    V plan, plan_count, plan_state, plan_left, health;
+    V enemy, enemy_health, enemy_plan, enemy_count, enemy_state, enemy_left;
+    V quiet, turns, status;
+};
+
+/* The same, spilled to memory so single lanes can be swapped out. */
+struct Combat__Fights_Spill {
+    int32_t plan[8], plan_count[8], plan_state[8], plan_left[8], health[8];
+    int32_t enemy[8], enemy_health[8], enemy_plan[8], enemy_count[8], enemy_state[8], enemy_left[8];
+    int32_t quiet[8], turns[8], status[8];
+};
+
+struct Combat__Batch {
+    const Combat__Stage_Tables *stage;
+    const uint32_t *plans;
+    const int32_t  *plan_counts;
+    int             count;
+    int             next;    /* next plan to hand to a free lane. */
+    int             running; /* lanes with a fight in them. */
+    int32_t        *status_out;
+    int32_t        *turns_out;
+    int32_t        *health_out;
+};
+
+/* Writes out the lanes whose fight ended and gives them the next plan, or parks them. */
+template<typename L>
+static void combat__swap_fights(Combat__Batch *batch, Combat__Fights<L> *f, int32_t *fight_ids) {
+    Combat__Fights_Spill m;
+    L::store(m.plan, f->plan);                 L::store(m.plan_count, f->plan_count);
+    L::store(m.plan_state, f->plan_state);     L::store(m.plan_left, f->plan_left);
+    L::store(m.health, f->health);             L::store(m.enemy, f->enemy);
+    L::store(m.enemy_health, f->enemy_health); L::store(m.enemy_state, f->enemy_state);
+    L::store(m.enemy_plan, f->enemy_plan);     L::store(m.enemy_count, f->enemy_count);
+    L::store(m.enemy_left, f->enemy_left);     L::store(m.quiet, f->quiet);
+    L::store(m.turns, f->turns);               L::store(m.status, f->status);
+
+    const Combat__Stage_Tables *stage = batch->stage;
+    for (int i = 0; i < L::WIDTH; ++i) {
+        if (m.status[i] == COMBAT_ONGOING) continue;
+
+        if (fight_ids[i] >= 0) {
+            batch->status_out[fight_ids[i]] = m.status[i];
+            batch->turns_out[fight_ids[i]]  = m.turns[i];
+            if (batch->health_out) batch->health_out[fight_ids[i]] = m.health[i];
+            fight_ids[i] = -1;
+            batch->running--;
+        }
+        if (batch->next == batch->count) continue; /* parked: not ongoing, no fight id. */
+
+        int id = fight_ids[i] = batch->next++;
+        batch->running++;
+        assert(batch->plan_counts[id] > 0 && batch->plan_counts[id] <= ACTION_CAPACITY);
+
+        m.plan[i]         = m.plan_state[i] = (int32_t)batch->plans[id];
+        m.plan_count[i]   = m.plan_left[i]  = batch->plan_counts[id];
+        m.health[i]       = stage->player_health;
+        m.enemy[i]        = 0;
+        m.enemy_health[i] = stage->health[0];
+        m.enemy_plan[i]   = stage->plan[0];
+        m.enemy_count[i]  = stage->count[0];
+        m.enemy_state[i]  = stage->start_state[0];
+        m.enemy_left[i]   = stage->start_left[0];
+        m.quiet[i]        = stage->quiet;
+        m.turns[i]        = 0;
+        m.status[i]       = COMBAT_ONGOING;
+    }
+
+    f->plan         = L::load(m.plan);         f->plan_count  = L::load(m.plan_count);
+    f->plan_state   = L::load(m.plan_state);   f->plan_left   = L::load(m.plan_left);
+    f->health       = L::load(m.health);       f->enemy       = L::load(m.enemy);
+    f->enemy_health = L::load(m.enemy_health); f->enemy_state = L::load(m.enemy_state);
+    f->enemy_plan   = L::load(m.enemy_plan);   f->enemy_count = L::load(m.enemy_count);
+    f->enemy_left   = L::load(m.enemy_left);   f->quiet       = L::load(m.quiet);
+    f->turns        = L::load(m.turns);        f->status      = L::load(m.status);
+}
+
+/* Runs every plan of the batch, L::WIDTH * COMBAT_BATCH_UNROLL at a time. one step is one combat_run iteration
+ * for every lane: a status check, then either the end of the fight, the next enemy, or a turn.
+ * a lane whose fight ended picks up the next plan right away, so short fights don't wait on long ones. */
+template<typename L>
+static void combat__simulate_lanes(Combat__Batch *batch) {
+    typedef typename L::V V;
+    const Combat__Stage_Tables *stage = batch->stage;
+
+    const V zero       = L::set1(0);
+    const V one        = L::set1(1);
+    const V action     = L::set1((1 << COMBAT_PLAN_BITS) - 1);
+    const V last_enemy = L::set1(stage->enemy_count - 1);
+    const V forcequit  = L::set1(INFINITE_LOOP_FORCEQUIT);
+
+    Combat__Fights<L> fights[COMBAT_BATCH_UNROLL];
+    int32_t fight_ids[COMBAT_BATCH_UNROLL][L::WIDTH];
+    memset(fights, 0, sizeof(fights));
+    for (int u = 0; u < COMBAT_BATCH_UNROLL; ++u) {
+        fights[u].status = L::set1(COMBAT_FORCEQUIT); /* empty, all lanes take a plan. */
+        for (int i = 0; i < L::WIDTH; ++i) fight_ids[u][i] = -1;
+        combat__swap_fights<L>(batch, &fights[u], fight_ids[u]);
+    }
+
+    while (batch->running > 0) {
+        for (int u = 0; u < COMBAT_BATCH_UNROLL; ++u) {
+            Combat__Fights<L> *f = &fights[u];
+
+            /* combat_status, in its order. */
+            V active     = L::cmpeq(f->status, L::set1(COMBAT_ONGOING));
+            V looped     = L::and_(active, L::cmpeq(f->quiet, forcequit));
+            V fighting   = L::andnot(looped, active);
+            V dead       = L::and_(fighting, L::cmpgt(one, f->health));
+            fighting     = L::andnot(dead, fighting);
+            V enemy_dead = L::and_(fighting, L::cmpgt(one, f->enemy_health));
+            fighting     = L::andnot(enemy_dead, fighting);
+
+            V is_last = L::cmpeq(f->enemy, last_enemy);
+            V won     = L::and_(enemy_dead, is_last);
+            V advance = L::andnot(is_last, enemy_dead);
+
+            f->status = L::blend(f->status, L::set1(COMBAT_FORCEQUIT),      looped);
+            f->status = L::blend(f->status, L::set1(COMBAT_PLAYER_DEAD),    dead);
+            f->status = L::blend(f->status, L::set1(COMBAT_STAGE_COMPLETE), won);
+
+            /* combat_next_enemy / combat_next_chain. masks are -1, so subtracting one counts up. */
+            if (L::any(advance)) {
+                f->enemy        = L::sub(f->enemy, advance);
+                f->enemy_health = L::blend(f->enemy_health, L::lookup(stage->health,      f->enemy), advance);
+                f->enemy_plan   = L::blend(f->enemy_plan,   L::lookup(stage->plan,        f->enemy), advance);
+                f->enemy_count  = L::blend(f->enemy_count,  L::lookup(stage->count,       f->enemy), advance);
+                f->enemy_state  = L::blend(f->enemy_state,  L::lookup(stage->start_state, f->enemy), advance);
+                f->enemy_left   = L::blend(f->enemy_left,   L::lookup(stage->start_left,  f->enemy), advance);
+                f->quiet        = L::andnot(advance, f->quiet);
+            }
+
+            /* combat_resolve_turn. */
+            V pair = L::pair_index(L::and_(f->plan_state, action), L::and_(f->enemy_state, action));
+
+            V to_enemy  = L::bit(combat__damage_bits.to_enemy[0],  pair);
+            V to_player = L::bit(combat__damage_bits.to_player[0], pair);
+            if (combat__damage_bits.to_enemy[1])  to_enemy  = L::add(to_enemy,  L::add(L::bit(combat__damage_bits.to_enemy[1],  pair), L::bit(combat__damage_bits.to_enemy[1],  pair)));
+            if (combat__damage_bits.to_player[1]) to_player = L::add(to_player, L::add(L::bit(combat__damage_bits.to_player[1], pair), L::bit(combat__damage_bits.to_player[1], pair)));
+            to_enemy  = L::and_(to_enemy,  fighting);
+            to_player = L::and_(to_player, fighting);
+
+            f->enemy_health = L::sub(f->enemy_health, to_enemy);
+            f->health       = L::sub(f->health,       to_player);
+
+            V hurt   = L::cmpgt(L::or_(to_enemy, to_player), zero);
+            f->quiet = L::blend(f->quiet, L::andnot(hurt, L::add(f->quiet, one)), fighting);
+            f->turns = L::sub(f->turns, fighting);
+
+            /* get_next_action_for on both sides: shift the next action down, start over when the plan runs out. */
+            f->plan_state = L::blend(f->plan_state, L::next_action(f->plan_state), fighting);
+            f->plan_left  = L::add(f->plan_left, fighting);
+            V plan_over   = L::cmpeq(f->plan_left, zero);
+            f->plan_state = L::blend(f->plan_state, f->plan,       plan_over);
+            f->plan_left  = L::blend(f->plan_left,  f->plan_count, plan_over);
+
+            f->enemy_state = L::blend(f->enemy_state, L::next_action(f->enemy_state), fighting);
+            f->enemy_left  = L::add(f->enemy_left, fighting);
+            V enemy_over   = L::cmpeq(f->enemy_left, zero);
+            f->enemy_state = L::blend(f->enemy_state, f->enemy_plan,  enemy_over);
+            f->enemy_left  = L::blend(f->enemy_left,  f->enemy_count, enemy_over);
+
+            if (L::any(L::or_(looped, L::or_(dead, won)))) combat__swap_fights<L>(batch, f, fight_ids[u]);
+        }
+    }
+}
+
+#if defined(fz_HAS_AVX2)
+typedef Combat__Lanes_Avx2   Combat__Lanes;
+#elif defined(fz_HAS_SSE41)
+typedef Combat__Lanes_Sse41  Combat__Lanes;
+#else
+typedef Combat__Lanes_Scalar Combat__Lanes;
+#endif
+
+const char *combat_batch_kernel_name(void) {
+#if defined(fz_HAS_AVX2)
+    return "AVX2";
+#elif defined(fz_HAS_SSE41)
+    return "SSE4.1";
+#else
+    return "scalar";
+#endif
+}
+
+uint32_t combat_pack_plan(const Action *actions, int count) {
+    uint32_t packed = 0;
+    for (int i = count - 1; i >= 0; --i) {
+        packed = (packed << COMBAT_PLAN_BITS) | (uint32_t)actions[i].type;
+    }
+    return packed;
+}
+
+/* combat_simulate_batch for stages too big for the tables. allocates a copy of the enemies. */
+static void combat__simulate_each(const Combat *stage, const uint32_t *plans, const int32_t *plan_counts, int count,
+                                  int32_t *status_out, int32_t *turns_out, int32_t *health_out)
+{
+    Combat combat = *stage;
+    combat.enemies = VecCreate(Enemy_Chain, VecLen(stage->enemies));
+    for (int c = 0; c < VecLen(stage->enemies); ++c) VecPush(combat.enemies, stage->enemies[c]);
+
+    for (int i = 0; i < count; ++i) {
+        assert(1 <= plan_counts[i] && plan_counts[i] <= ACTION_CAPACITY);
+        memcpy(combat.enemies, stage->enemies, sizeof(Enemy_Chain) * VecLen(stage->enemies));
+        combat.chain_index           = stage->chain_index;
+        combat.enemy_index           = stage->enemy_index;
+        combat.infinite_loop_counter = stage->infinite_loop_counter;
+        combat.player                = stage->player;
+        combat.player.action_count   = plan_counts[i];
+        combat.player.action_index   = 0;
+        for (int a = 0; a < plan_counts[i]; ++a) {
+            combat.player.actions[a].type = (int)((plans[i] >> (a * COMBAT_PLAN_BITS)) & ((1 << COMBAT_PLAN_BITS) - 1));
+        }
+
+        uint64_t turns = 0;
+        status_out[i] = combat_run(&combat, &turns);
+        turns_out[i]  = (int32_t)turns;
+        if (health_out) health_out[i] = combat.player.health;
+    }
+
+    VecRelease(combat.enemies);
+}
+
+void combat_simulate_batch(const Combat *stage, const uint32_t *plans, const int32_t *plan_counts, int count,
+                           int32_t *status_out, int32_t *turns_out, int32_t *health_out)
+{
+    int enemies_left = 0;
+    for (int c = stage->chain_index; c < VecLen(stage->enemies); ++c) {
+        int first = (c == stage->chain_index) ? stage->enemy_index : 0;
+        if (first < stage->enemies[c].enemy_count) enemies_left += stage->enemies[c].enemy_count - first;
+    }
+    if (enemies_left > COMBAT_BATCH_MAX_ENEMIES) {
+        combat__simulate_each(stage, plans, plan_counts, count, status_out, turns_out, health_out);
+        return;
+    }
+
+    Combat__Stage_Tables tables = {};
+    tables.quiet         = stage->infinite_loop_counter;
+    tables.player_health = stage->player.health;
+
+    for (int c = stage->chain_index; c < VecLen(stage->enemies); ++c) {
+        const Enemy_Chain *chain = &stage->enemies[c];
+        int first = (c == stage->chain_index) ? stage->enemy_index : 0;
+        assert(first <= chain->enemy_count);
+
+        if (tables.enemy_count == 0 && first == chain->enemy_count && tables.quiet != INFINITE_LOOP_FORCEQUIT) {
+            tables.quiet = 0; /* COMBAT_CHAIN_COMPLETE on the way to the first enemy. */
+        }
+
+        for (int i = first; i < chain->enemy_count; ++i) {
+            const Actor *enemy = &chain->enemies[i];
+            assert(tables.enemy_count < COMBAT_BATCH_MAX_ENEMIES);
+            assert(enemy->action_count > 0 && enemy->action_index < enemy->action_count);
+
+            int e = tables.enemy_count++;
+            tables.plan[e]        = (int32_t)combat_pack_plan(enemy->actions, enemy->action_count);
+            tables.count[e]       = enemy->action_count;
+            tables.start_state[e] = (int32_t)((uint32_t)tables.plan[e] >> (enemy->action_index * COMBAT_PLAN_BITS));
+            tables.start_left[e]  = enemy->action_count - enemy->action_index;
+            tables.health[e]      = enemy->health;
+        }
+    }
+
+    if (tables.enemy_count == 0) {
+        /* nothing left to fight: one already dead enemy, so the status checks still run in combat_run's order. */
+        tables.count[0] = tables.start_left[0] = 1;
+        tables.enemy_count = 1;
+    }
+
+    Combat__Batch batch = {};
+    batch.stage       = &tables;
+    batch.plans       = plans;
+    batch.plan_counts = plan_counts;
+    batch.count       = count;
+    batch.status_out  = status_out;
+    batch.turns_out   = turns_out;
+    batch.health_out  = health_out;
+    combat__simulate_lanes<Combat__Lanes>(&batch);
+}
+
+#endif // FUZZY_COMBAT_H_IMPL
@@ -0,0 +1,263 @@
+/*
+ * Headless combat: plays stage one with random player plans, no window, no audio, no raylib.
+ * build: see build.sh / build.bat (dist/combat_sim).
+ * usage: combat_sim [runs] [seed]
+ * then the same number of new random plans through combat_simulate_batch.
+ *
+ * usage: combat_sim --verify [plans] [seed]
+ * checks the batch kernel this was built with against combat_run: plans random plans from every enemy of stage one,
+ * status, turns and health must match for each. exit code 1 on any mismatch. build it with -march=native, -msse4.1
+ * and no SIMD flags (/arch:AVX2, /arch:AVX and none) to cover all three kernels.
+ */
+
+#define FUZZY_MY_H_IMPL
+#include "my.h"
+
+#define FUZZY_COMBAT_H_IMPL
+#include "combat.h"
+
+#if defined(fz_OS_WINDOWS)
+#if !defined(fz_NO_WINDOWS_H)
+#include <windows.h>
+#endif
+#else
+#include <time.h>
+#endif
+
+static uint64_t time_now_ns() {
+#if defined(fz_OS_WINDOWS)
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (uint64_t)((double)counter.QuadPart * 1e9 / (double)frequency.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+static uint32_t rng_state = 0x12345678;
+static uint32_t rng_next() {
+    uint32_t x = rng_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return rng_state = x;
+}
+
+static const char *status_to_char[] = {
+    "Ongoing",
+    "Forcequit (infinite loop)",
+    "Player died",
+    "Stage complete",
+    "Chain complete",
+    "Enemy died",
+};
+
+static void unpack_plan(uint32_t plan, int count, Actor *player) {
+    player->action_count = count;
+    player->action_index = 0;
+    for (int i = 0; i < count; ++i) {
+        player->actions[i].type = (int)((plan >> (i * COMBAT_PLAN_BITS)) & ((1 << COMBAT_PLAN_BITS) - 1));
+    }
+}
+
+/* starts at every enemy of the stage (and one past the last of each chain), at a few player healths, with the
+ * enemy part way through its actions and the loop counter already running. returns the mismatches. */
+static int verify_batch(Combat *combat, Vec(Enemy_Chain) stage, int plans_per_start) {
+    static const int player_healths[] = { 1, 5, 12 };
+
+    uint32_t *plans  = (uint32_t *)fz_alloc(sizeof(uint32_t) * (size_t)plans_per_start);
+    int32_t  *counts = (int32_t *)fz_alloc(sizeof(int32_t) * (size_t)plans_per_start);
+    int32_t  *status = (int32_t *)fz_alloc(sizeof(int32_t) * (size_t)plans_per_start);
+    int32_t  *turns  = (int32_t *)fz_alloc(sizeof(int32_t) * (size_t)plans_per_start);
+    int32_t  *health = (int32_t *)fz_alloc(sizeof(int32_t) * (size_t)plans_per_start);
+
+    Combat check = {};
+    check.enemies = VecCreate(Enemy_Chain, VecLen(stage));
+    for (int i = 0; i < VecLen(stage); ++i) VecPush(check.enemies, stage[i]);
+
+    uint64_t checked = 0, won = 0;
+    int mismatches = 0;
+    for (int c = 0; c < VecLen(stage); ++c) {
+        for (int e = 0; e <= stage[c].enemy_count; ++e) {
+            for (int h = 0; h < (int)fz_COUNTOF(player_healths); ++h) {
+                memcpy(combat->enemies, stage, sizeof(Enemy_Chain) * VecLen(stage));
+                combat->chain_index = c;
+                combat->enemy_index = e;
+                combat->infinite_loop_counter = (int)(rng_next() % INFINITE_LOOP_FORCEQUIT);
+                combat->player.health = combat->player.max_health = player_healths[h];
+                if (e < stage[c].enemy_count) {
+                    Actor *enemy = &combat->enemies[c].enemies[e];
+                    enemy->action_index = (int)(rng_next() % (uint32_t)enemy->action_count);
+                    enemy->health       = 1 + (int)(rng_next() % (uint32_t)enemy->max_health);
+                }
+
+                Action actions[ACTION_CAPACITY];
+                for (int i = 0; i < plans_per_start; ++i) {
+                    counts[i] = 1 + (int32_t)(rng_next() % ACTION_CAPACITY);
+                    for (int a = 0; a < counts[i]; ++a) {
+                        actions[a].type = ACTION_SLASH + (int)(rng_next() % (ACTION_COUNT - ACTION_SLASH));
+                    }
+                    plans[i] = combat_pack_plan(actions, counts[i]);
+                }
+
+                combat_simulate_batch(combat, plans, counts, plans_per_start, status, turns, health);
+
+                for (int i = 0; i < plans_per_start; ++i) {
+                    memcpy(check.enemies, combat->enemies, sizeof(Enemy_Chain) * VecLen(stage));
+                    check.chain_index           = combat->chain_index;
+                    check.enemy_index           = combat->enemy_index;
+                    check.infinite_loop_counter = combat->infinite_loop_counter;
+                    check.player                = combat->player;
+                    unpack_plan(plans[i], counts[i], &check.player);
+
+                    uint64_t expected_turns = 0;
+                    Combat_Status expected = combat_run(&check, &expected_turns);
+                    checked++;
+                    won += expected == COMBAT_STAGE_COMPLETE;
+
+                    if (status[i] != expected || turns[i] != (int32_t)expected_turns || health[i] != check.player.health) {
+                        if (mismatches++ < 10) {
+                            printf("  mismatch: chain %d enemy %d, plan %08x (%d actions): batch %d / %d turns / %d health,"
+                                   " combat_run %d / %llu turns / %d health\n", c, e, plans[i], counts[i], status[i], turns[i],
+                                   health[i], expected, (unsigned long long)expected_turns, check.player.health);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    printf("%s kernel: %llu plans checked against combat_run (%llu cleared), %d mismatches\n",
+           combat_batch_kernel_name(), (unsigned long long)checked, (unsigned long long)won, mismatches);
+
+    VecRelease(check.enemies);
+    fz_free(plans);
+    fz_free(counts);
+    fz_free(status);
+    fz_free(turns);
+    fz_free(health);
+    return mismatches;
+}
+
+int main(int argc, char **argv) {
+    int verify = argc > 1 && strcmp(argv[1], "--verify") == 0;
+    if (verify) {
+        argc--;
+        argv++;
+    }
+
+    int runs = argc > 1 ? atoi(argv[1]) : (verify ? 4096 : 1000000);
+    if (argc > 2) rng_state = (uint32_t)strtoul(argv[2], 0, 10) | 1;
+
+    Combat combat = {};
+    combat_load_stage_one(&combat);
+
+    /* every run starts from this; copying it back is cheaper than rebuilding the stage. */
+    Vec(Enemy_Chain) stage = VecCreate(Enemy_Chain, VecLen(combat.enemies));
+    for (int i = 0; i < VecLen(combat.enemies); ++i) VecPush(stage, combat.enemies[i]);
+
+    if (verify) {
+        int mismatches = verify_batch(&combat, stage, runs);
+        VecRelease(stage);
+        VecRelease(combat.enemies);
+        return mismatches ? 1 : 0;
+    }
+
+    uint64_t outcomes[fz_COUNTOF(status_to_char)] = {};
+    uint64_t turns = 0;
+
+    Action best_plan[ACTION_CAPACITY];
+    int      best_count  = 0;
+    uint64_t best_turns  = (uint64_t)-1;
+
+    uint64_t start = time_now_ns();
+    for (int run = 0; run < runs; ++run) {
+        memcpy(combat.enemies, stage, sizeof(Enemy_Chain) * VecLen(stage));
+        combat.chain_index = 0;
+        combat.enemy_index = 0;
+        combat.infinite_loop_counter = 0;
+
+        Actor *player = &combat.player;
+        player->health = player->max_health = 5;
+        player->action_index = 0;
+        player->action_count = 1 + (int)(rng_next() % ACTION_CAPACITY);
+        for (int i = 0; i < player->action_count; ++i) {
+            player->actions[i].type = ACTION_SLASH + (int)(rng_next() % (ACTION_COUNT - ACTION_SLASH));
+        }
+
+        uint64_t run_turns = 0;
+        Combat_Status status = combat_run(&combat, &run_turns);
+        outcomes[status]++;
+        turns += run_turns;
+
+        if (status == COMBAT_STAGE_COMPLETE && run_turns < best_turns) {
+            best_turns = run_turns;
+            best_count = player->action_count;
+            memcpy(best_plan, player->actions, sizeof(Action) * best_count);
+        }
+    }
+    uint64_t elapsed = time_now_ns() - start;
+
+    printf("%d runs, %llu turns in %.3f s: %.1f M turns/s\n", runs, (unsigned long long)turns,
+           (double)elapsed / 1e9, (double)turns / ((double)elapsed / 1e9) / 1e6);
+
+    for (int i = 0; i < (int)fz_COUNTOF(outcomes); ++i) {
+        if (!outcomes[i]) continue;
+        printf("  %-28s %6.2f%%\n", status_to_char[i], 100.0 * (double)outcomes[i] / (double)runs);
+    }
+
+    if (best_count) {
+        static const char action_letter[ACTION_COUNT] = { '-', 'S', 'E', 'P', 'T' };
+        printf("fastest clear: %llu turns with ", (unsigned long long)best_turns);
+        for (int i = 0; i < best_count; ++i) printf("%c", action_letter[best_plan[i].type]);
+        printf(" (Slash, Evade, Parry, Tackle)\n");
+    }
+
+    {
+        uint32_t *plans  = (uint32_t *)fz_alloc(sizeof(uint32_t) * (size_t)runs);
+        int32_t  *counts = (int32_t *)fz_alloc(sizeof(int32_t) * (size_t)runs);
+        int32_t  *status = (int32_t *)fz_alloc(sizeof(int32_t) * (size_t)runs);
+        int32_t  *ran    = (int32_t *)fz_alloc(sizeof(int32_t) * (size_t)runs);
+
+        Action actions[ACTION_CAPACITY];
+        for (int run = 0; run < runs; ++run) {
+            counts[run] = 1 + (int32_t)(rng_next() % ACTION_CAPACITY);
+            for (int i = 0; i < counts[run]; ++i) {
+                actions[i].type = ACTION_SLASH + (int)(rng_next() % (ACTION_COUNT - ACTION_SLASH));
+            }
+            plans[run] = combat_pack_plan(actions, counts[run]);
+        }
+
+        memcpy(combat.enemies, stage, sizeof(Enemy_Chain) * VecLen(stage));
+        combat.chain_index = 0;
+        combat.enemy_index = 0;
+        combat.infinite_loop_counter = 0;
+        combat.player.health = 5;
+
+        uint64_t batch_start = time_now_ns();
+        combat_simulate_batch(&combat, plans, counts, runs, status, ran, 0);
+        uint64_t batch_elapsed = time_now_ns() - batch_start;
+
+        uint64_t batch_turns = 0, won = 0;
+        for (int run = 0; run < runs; ++run) {
+            batch_turns += (uint64_t)ran[run];
+            won += status[run] == COMBAT_STAGE_COMPLETE;
+        }
+
+        printf("%s batch: %llu turns in %.3f s: %.1f M turns/s, %.2f%% cleared\n",
+               combat_batch_kernel_name(), (unsigned long long)batch_turns, (double)batch_elapsed / 1e9,
+               (double)batch_turns / ((double)batch_elapsed / 1e9) / 1e6, 100.0 * (double)won / (double)runs);
+
+        fz_free(plans);
+        fz_free(counts);
+        fz_free(status);
+        fz_free(ran);
+    }
+
+    VecRelease(stage);
+    VecRelease(combat.enemies);
+    return 0;
+}
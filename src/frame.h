@@ -0,0 +1,143 @@
+/* ============================================================
+ *  Frame logic.
+ *  the per-frame bookkeeping of the game that doesn't need raylib: intervals, the effect slab and the order it's
+ *  drawn in, and the label size cache. main.cpp draws from these, alloc_check runs the same code headless with the
+ *  allocation guard fatal, so anything in here that starts hitting the heap mid-game fails that check.
+ *
+ *  #define FUZZY_FRAME_H_IMPL in exactly one translation unit, same as my.h.
+ */
+
+#ifndef FUZZY_FRAME_H
+#define FUZZY_FRAME_H
+
+#include "my.h"
+
+struct Interval {
+    float max;
+    float current;
+};
+
+/* adds dt, returns 1 (once) when max has been passed. */
+int interval_tick(Interval *interval, float dt);
+
+/* same layout as raylib's Rectangle / Vector2. */
+struct Frame_Rect { float x, y, width, height; };
+struct Frame_Size { float x, y; };
+
+struct Effect {
+    int        asset_id;
+    int        elapsed;
+    int        max_life;
+    Frame_Rect rect;
+};
+
+/* The slab never grows, so this can't hit the heap mid-combat. 0 when it's full, the effect is dropped. */
+fz_Handle effects_add(fz_Slab *effects, int asset_id, int max_life, Frame_Rect rect);
+
+/* every effect one sprite frame further, the ones that ran out are removed. */
+void effects_advance(fz_Slab *effects);
+
+/* dense indexes into effects grouped by asset_id, on the temp allocator.
+ * sorts an index list rather than the slab itself, so handles stay put. */
+Vec(int) effects_draw_order(fz_Slab *effects);
+
+/* Labels and tooltips repeat every frame; each distinct (label, font size) gets measured once. */
+typedef Frame_Size (*Label_Measure_Func)(const char *label, float font_size);
+
+struct Label_Cache {
+    fz_Arena           arena; // new labels show up mid-game (e.g. "Reset (2)"); keep them off the heap.
+    fz_Intern          ids;
+    Map(Frame_Size)    sizes; // (interned label, font size) -> measure.
+    Label_Measure_Func measure;
+};
+
+void       label_cache_init(Label_Cache *cache, Label_Measure_Func measure);
+void       label_cache_release(Label_Cache *cache);
+Frame_Size label_cache_measure(Label_Cache *cache, const char *label, float font_size);
+
+#endif // FUZZY_FRAME_H
+
+/* ============================================================
+ *  Implementation.
+ */
+
+#if defined(FUZZY_FRAME_H_IMPL) && !defined(FUZZY_FRAME_H_IMPLEMENTED)
+#define FUZZY_FRAME_H_IMPLEMENTED 1
+
+int interval_tick(Interval *interval, float dt) {
+    interval->current += dt;
+    if (interval->max < interval->current) {
+        interval->current -= interval->max;
+        if(interval->current < 0) interval->current = 0;
+
+        return 1;
+    }
+    return 0;
+}
+
+fz_Handle effects_add(fz_Slab *effects, int asset_id, int max_life, Frame_Rect rect) {
+    Effect *effect;
+    fz_Handle handle = fz_slab_add(effects, (void **)&effect);
+    if (!handle) {
+        printf("Too many effects alive (%d). dropping effect %d.\n", effects->count, asset_id);
+        return 0;
+    }
+
+    effect->asset_id = asset_id;
+    effect->elapsed  = 0;
+    effect->max_life = max_life;
+    effect->rect     = rect;
+
+    return handle;
+}
+
+void effects_advance(fz_Slab *effects) {
+    /*
+     * walking backwards: removing moves the last effect into the hole,
+     * which has been visited already. */
+    for (int i = effects->count - 1; i >= 0; --i) {
+        Effect *e = fz_slab_at(effects, Effect, i);
+        e->elapsed += 1;
+        if (e->elapsed >= e->max_life) {
+            fz_slab_remove(effects, fz_slab_handle_at(effects, i));
+        }
+    }
+}
+
+Vec(int) effects_draw_order(fz_Slab *effects) {
+    /* stable, so effects sharing a texture keep their order. */
+    Effect *all = fz_slab_at(effects, Effect, 0);
+    Vec(int) draw_order = VecCreateEx(int, effects->count, fz_global_temp_allocator);
+    for (int i = 0; i < effects->count; ++i) VecPush(draw_order, i);
+    VecRadixSort(draw_order, [all](int i) { return all[i].asset_id; });
+
+    return draw_order;
+}
+
+void label_cache_init(Label_Cache *cache, Label_Measure_Func measure) {
+    fz_arena_init_virtual(&cache->arena, 16 * fz_MB, 0);
+    fz_intern_init(&cache->ids, fz_arena_allocator(&cache->arena));
+    cache->sizes   = MapCreateEx(Frame_Size, 64, fz_arena_allocator(&cache->arena));
+    cache->measure = measure;
+}
+
+void label_cache_release(Label_Cache *cache) {
+    /* the intern table and the map live in the arena. */
+    fz_arena_release(&cache->arena);
+    *cache = {};
+}
+
+Frame_Size label_cache_measure(Label_Cache *cache, const char *label, float font_size) {
+    uint32_t size_bits;
+    memcpy(&size_bits, &font_size, sizeof(size_bits));
+
+    uint64_t key = ((uint64_t)fz_intern(&cache->ids, fz_str(label)) << 32) | size_bits;
+    ptrdiff_t found = MapFind(cache->sizes, key);
+    if (found >= 0) return cache->sizes[found];
+
+    Frame_Size size = cache->measure(label, font_size);
+    MapSet(cache->sizes, key, size);
+    return size;
+}
+
+#endif // FUZZY_FRAME_H_IMPL
@@ -4,15 +4,23 @@
 
 #define FUZZY_MY_H_IMPL
 #define fz_NO_WINDOWS_H
+#define fz_TRACK_ALLOCATIONS
 #include "my.h"
 
+#define FUZZY_COMBAT_H_IMPL
+#include "combat.h"
+
+#define FUZZY_FRAME_H_IMPL
+#include "frame.h"
+
 /* Constants */
 const float CHARACTER_Y_POSITION_FROM_TOP = 0.525;
 #define TILE 80
 
 fz_STATIC_ASSERT(TILE % 2 == 0);
 
-#define INFINITE_LOOP_FORCEQUIT 50
+#define STEADY_STATE_WARMUP_FRAMES 120
+#define EFFECT_MEMORY (16 * fz_KB)
 
 /* Game globals */
 static Rectangle window_size = { 0, 0, 1280,  720 };
@@ -21,6 +29,14 @@ static Vector2 mouse_pos = {};
 
 static RenderTexture2D render_tex;
 
+/* Memory stats for the debug overlay. */
+static fz_Arena   frame_arena;
+static fz_Tracker heap_tracker;
+static fz_Tracker frame_tracker;
+
+/* Labels and tooltips repeat every frame; each distinct one gets measured once. */
+static Label_Cache labels;
+
 struct Shader_Loc {
     int time_loc;
     int strength_loc;
@@ -113,7 +129,16 @@ int load_tex_to_id(int position, const char *tex) {
         wrapper->is_loaded = 0;
     }
 
-    Texture2D loaded = LoadTexture(tex);
+    // decode straight out of the mapped file, instead of raylib reading it into a malloc'd copy first.
+    fz_Temp_Block scratch(fz_get_scratch(0, 0));
+    fz_File_Map file;
+    if (!fz_file_map(&file, tex, fz_FILE_MAP_SEQUENTIAL, scratch.allocator())) return 0;
+
+    Image image = LoadImageFromMemory(GetFileExtension(tex), file.data, (int)file.size);
+    fz_file_unmap(&file);
+
+    Texture2D loaded = LoadTextureFromImage(image);
+    UnloadImage(image);
     if (loaded.id != 0) {
         wrapper->t = loaded;
         wrapper->is_loaded = 1;
@@ -132,7 +157,15 @@ int load_sound_to_id(int position, const char *asset_name) {
         wrapper->is_loaded = 0;
     }
 
-    Sound sound = LoadSound(asset_name);
+    fz_Temp_Block scratch(fz_get_scratch(0, 0));
+    fz_File_Map file;
+    if (!fz_file_map(&file, asset_name, fz_FILE_MAP_SEQUENTIAL, scratch.allocator())) return 0;
+
+    Wave wave = LoadWaveFromMemory(GetFileExtension(asset_name), file.data, (int)file.size);
+    fz_file_unmap(&file);
+
+    Sound sound = LoadSoundFromWave(wave);
+    UnloadWave(wave);
     if (sound.stream.buffer != 0) {
         wrapper->sound = sound;
         wrapper->is_loaded = 1;
@@ -167,8 +200,6 @@ int get_sound(int position, Sound *write_into) {
     return wrapper->is_loaded;
 }
 
-#define ENEMY_CAPACITY 5
-
 /* ============================================================
  *  Game Data And Core Structure.
  */
@@ -217,17 +248,6 @@ const char *combat_state_to_char[COMBAT_STATE_COUNT] = {
     "Stage Complete",
 };
 
-enum
-{
-    ACTION_NONE = 0,
-    /* Volatile: order must match with asset enum */
-    ACTION_SLASH,
-    ACTION_EVADE,
-    ACTION_PARRY,
-    ACTION_TACKLE,
-    ACTION_COUNT,
-};
-
 const char *action_type_to_name_char[ACTION_COUNT] = {
     "None",
     "Slash",
@@ -244,12 +264,6 @@ const char *action_type_to_description_char[ACTION_COUNT] = {
     "Charges straight towards enemy, dealing 1 damage. blocked by Evade.",
 };
 
-struct Action {
-    int type;
-};
-
-#define ACTION_CAPACITY 10
-
 const Action base_actions[] = {
     { ACTION_SLASH  },
     { ACTION_TACKLE },
@@ -257,31 +271,6 @@ const Action base_actions[] = {
     { ACTION_PARRY  },
 };
 
-struct Actor {
-    int health;
-    int max_health;
-    int action_index;
-    int action_count;
-    Action actions[ACTION_CAPACITY];
-};
-
-struct Enemy_Chain {
-    int   enemy_count;
-    Actor enemies[ENEMY_CAPACITY];
-};
-
-struct Effect {
-    int       asset_id;
-    int       elapsed;
-    int       max_life;
-    Rectangle rect;
-};
-
-struct Interval {
-    float max;
-    float current;
-};
-
 struct State {
     int current;
     int entered;
@@ -299,7 +288,7 @@ struct Game {
     Interval resetter_interval;
 
     int locked_in_index;
-    Actor player;
+    Combat combat; /* player, enemies and where the fight is at. */
 
     int last_player_action;
     int last_enemy_action;
@@ -309,16 +298,11 @@ struct Game {
     float  player_hit_highlight_dt;
     float  enemy_hit_highlight_dt;
 
-    int infinite_loop_counter;
     int reset_count;
 
-    int enemy_index;
-    int chain_index;
-
     int current_music_playing;
 
-    Vec(Enemy_Chain) enemies;
-    Vec(Effect)      effects;
+    fz_Slab          effects; // of Effect. hold on to one with the fz_Handle from spawn_effect.
 
     Camera2D camera;
     float camerashake_shift_distance;
@@ -343,6 +327,11 @@ rectf4(float x, float y, float w, float h) {
     return { x, y, w, h };
 }
 
+inline Rectangle
+rect_of(Frame_Rect r) {
+    return { r.x, r.y, r.width, r.height };
+}
+
 inline Rectangle
 rectv2(Vector2 pos, Vector2 size) {
     return { pos.x, pos.y, size.x, size.y };
@@ -510,151 +499,70 @@ Rectangle get_rowslot_for_nth_tile(Rectangle layout, int index, float scale, int
 
 void reset_combatstate(Game *game) {
     game->locked_in_index = -1;
-    game->enemy_index = 0;
-    game->chain_index = 0;
     game->reset_count = 3;
-    game->player.health = game->player.max_health = 5;
-    game->player.action_count = 0;
-    game->player.action_index = 0;
-    VecClear(game->enemies);
+    combat_reset(&game->combat);
 }
 
 float state_delta(State *state);
 
 void load_stage_one(Game *game) {
     reset_combatstate(game);
-    {
-        Enemy_Chain chain = {0};
-
-        /* First wave */
-        chain.enemies[0].health = chain.enemies[0].max_health = 3;
-        chain.enemies[0].actions[chain.enemies[0].action_count++].type = ACTION_SLASH;
-        chain.enemies[0].actions[chain.enemies[0].action_count++].type = ACTION_PARRY;
-
-        chain.enemy_count++;
-        chain.enemies[1].health = chain.enemies[1].max_health = 3;
-        chain.enemies[1].actions[chain.enemies[1].action_count++].type = ACTION_SLASH;
-        chain.enemies[1].actions[chain.enemies[1].action_count++].type = ACTION_EVADE;
-
-        chain.enemy_count++;
-        chain.enemies[2].health = chain.enemies[2].max_health = 3;
-        chain.enemies[2].actions[chain.enemies[2].action_count++].type = ACTION_SLASH;
-        chain.enemies[2].actions[chain.enemies[2].action_count++].type = ACTION_PARRY;
-        chain.enemies[2].actions[chain.enemies[2].action_count++].type = ACTION_SLASH;
-        chain.enemies[2].actions[chain.enemies[2].action_count++].type = ACTION_EVADE;
-
-        VecPush(game->enemies, chain);
-    }
-
-    {
-        Enemy_Chain chain = {0};
-
-        /* Second wave */
-        chain.enemies[0].health = chain.enemies[0].max_health = 3;
-        chain.enemies[0].actions[chain.enemies[0].action_count++].type = ACTION_SLASH;
-        chain.enemies[0].actions[chain.enemies[0].action_count++].type = ACTION_PARRY;
-        chain.enemies[0].actions[chain.enemies[0].action_count++].type = ACTION_TACKLE;
-        chain.enemies[0].actions[chain.enemies[0].action_count++].type = ACTION_PARRY;
-
-        chain.enemy_count++;
-        chain.enemies[1].health = chain.enemies[1].max_health = 3;
-        chain.enemies[1].actions[chain.enemies[1].action_count++].type = ACTION_EVADE;
-        chain.enemies[1].actions[chain.enemies[1].action_count++].type = ACTION_SLASH;
-        chain.enemies[1].actions[chain.enemies[1].action_count++].type = ACTION_PARRY;
-        chain.enemies[1].actions[chain.enemies[1].action_count++].type = ACTION_PARRY;
-
-        chain.enemy_count++;
-        chain.enemies[2].health = chain.enemies[2].max_health = 3;
-        chain.enemies[2].actions[chain.enemies[2].action_count++].type = ACTION_TACKLE;
-        chain.enemies[2].actions[chain.enemies[2].action_count++].type = ACTION_SLASH;
-        chain.enemies[2].actions[chain.enemies[2].action_count++].type = ACTION_EVADE;
-        chain.enemies[2].actions[chain.enemies[2].action_count++].type = ACTION_EVADE;
-
-        chain.enemy_count++;
-        chain.enemies[3].health = chain.enemies[3].max_health = 3;
-        chain.enemies[3].actions[chain.enemies[3].action_count++].type = ACTION_EVADE;
-        chain.enemies[3].actions[chain.enemies[3].action_count++].type = ACTION_PARRY;
-        chain.enemies[3].actions[chain.enemies[3].action_count++].type = ACTION_TACKLE;
-        chain.enemies[3].actions[chain.enemies[3].action_count++].type = ACTION_TACKLE;
-
-        VecPush(game->enemies, chain);
-    }
-
-    {
-        Enemy_Chain chain = {0};
-
-        /* Second wave */
-        chain.enemies[0].health = chain.enemies[0].max_health = 3;
-        chain.enemies[0].actions[chain.enemies[0].action_count++].type = ACTION_PARRY;
-        chain.enemies[0].actions[chain.enemies[0].action_count++].type = ACTION_PARRY;
-        chain.enemies[0].actions[chain.enemies[0].action_count++].type = ACTION_TACKLE;
-        chain.enemies[0].actions[chain.enemies[0].action_count++].type = ACTION_EVADE;
-        chain.enemies[0].actions[chain.enemies[0].action_count++].type = ACTION_EVADE;
-
-        chain.enemy_count++;
-        chain.enemies[1].health = chain.enemies[1].max_health = 3;
-        chain.enemies[1].actions[chain.enemies[1].action_count++].type = ACTION_EVADE;
-        chain.enemies[1].actions[chain.enemies[1].action_count++].type = ACTION_EVADE;
-        chain.enemies[1].actions[chain.enemies[1].action_count++].type = ACTION_SLASH;
-        chain.enemies[1].actions[chain.enemies[1].action_count++].type = ACTION_PARRY;
-        chain.enemies[1].actions[chain.enemies[1].action_count++].type = ACTION_PARRY;
-
-        chain.enemy_count++;
-        chain.enemies[2].health = chain.enemies[2].max_health = 3;
-        chain.enemies[2].actions[chain.enemies[2].action_count++].type = ACTION_TACKLE;
-        chain.enemies[2].actions[chain.enemies[2].action_count++].type = ACTION_SLASH;
-        chain.enemies[2].actions[chain.enemies[2].action_count++].type = ACTION_EVADE;
-        chain.enemies[2].actions[chain.enemies[2].action_count++].type = ACTION_SLASH;
-        chain.enemies[2].actions[chain.enemies[2].action_count++].type = ACTION_EVADE;
-        chain.enemies[2].actions[chain.enemies[2].action_count++].type = ACTION_PARRY;
-
-        chain.enemy_count++;
-        chain.enemies[3].health = chain.enemies[3].max_health = 3;
-        chain.enemies[3].actions[chain.enemies[3].action_count++].type = ACTION_EVADE;
-        chain.enemies[3].actions[chain.enemies[3].action_count++].type = ACTION_PARRY;
-        chain.enemies[3].actions[chain.enemies[3].action_count++].type = ACTION_TACKLE;
-        chain.enemies[3].actions[chain.enemies[3].action_count++].type = ACTION_EVADE;
-        chain.enemies[3].actions[chain.enemies[3].action_count++].type = ACTION_SLASH;
-        chain.enemies[3].actions[chain.enemies[3].action_count++].type = ACTION_PARRY;
-        chain.enemies[3].actions[chain.enemies[3].action_count++].type = ACTION_SLASH;
-        chain.enemies[3].actions[chain.enemies[3].action_count++].type = ACTION_EVADE;
-
-        VecPush(game->enemies, chain);
-    }
+    combat_load_stage_one(&game->combat);
 }
 
 void draw_debug_information(Game *game) {
     Vector2 pos = { 10, 10 };
-    DrawTextEx(font, TextFormat("MousePos: %2.0f, %2.0f", mouse_pos.x, mouse_pos.y), pos, 32, 0, YELLOW);
+    DrawTextEx(font, fz_tprintf("MousePos: %2.0f, %2.0f", mouse_pos.x, mouse_pos.y), pos, 32, 0, YELLOW);
 
     pos.y += 32;
     DrawTextEx(font, "Game State:", pos, 32, 0, YELLOW);
     pos.y += 32;
-    DrawTextEx(font, TextFormat("  Current: %s", game_state_to_char[game->core_state.current]), pos, 32, 0, YELLOW);
+    DrawTextEx(font, fz_tprintf("  Current: %s", game_state_to_char[game->core_state.current]), pos, 32, 0, YELLOW);
 
     pos.y += 32;
-    DrawTextEx(font, TextFormat("  Transition: %2.2f", state_delta(&game->core_state)), pos, 32, 0, YELLOW);
+    DrawTextEx(font, fz_tprintf("  Transition: %2.2f", state_delta(&game->core_state)), pos, 32, 0, YELLOW);
 
     pos.y += 32;
     DrawTextEx(font, "Combat State:", pos, 32, 0, YELLOW);
 
     pos.y += 32;
-    DrawTextEx(font, TextFormat("  Current: %s", combat_state_to_char[game->combat_state.current]), pos, 32, 0, YELLOW);
+    DrawTextEx(font, fz_tprintf("  Current: %s", combat_state_to_char[game->combat_state.current]), pos, 32, 0, YELLOW);
+
+    pos.y += 32;
+    DrawTextEx(font, fz_tprintf("  Transition: %2.2f", state_delta(&game->combat_state)), pos, 32, 0, YELLOW);
 
     pos.y += 32;
-    DrawTextEx(font, TextFormat("  Transition: %2.2f", state_delta(&game->combat_state)), pos, 32, 0, YELLOW);
+    DrawTextEx(font, fz_tprintf("Effect count: %d / %d", game->effects.count, game->effects.capacity), pos, 32, 0, YELLOW);
 
     pos.y += 32;
-    DrawTextEx(font, TextFormat("Effect count: %d", (int)VecLen(game->effects)), pos, 32, 0, YELLOW);
+    DrawTextEx(font, fz_tprintf("Heap: %d B in use, peak %d B, %d allocs last frame",
+                                (int)heap_tracker.bytes_in_use, (int)heap_tracker.high_water,
+                                (int)heap_tracker.last_frame_alloc_count), pos, 32, 0, YELLOW);
+
+    fz_Tracker_Site *top_sites[3];
+    int top_count = fz_tracker_top_sites(&heap_tracker, top_sites, fz_COUNTOF(top_sites));
+    for (int i = 0; i < top_count; ++i) {
+        pos.y += 32;
+        DrawTextEx(font, fz_tprintf("  %s: %d B (%d live)", top_sites[i]->site,
+                                    (int)top_sites[i]->bytes_in_use, (int)top_sites[i]->live_count), pos, 32, 0, YELLOW);
+    }
+
+    pos.y += 32;
+    DrawTextEx(font, fz_tprintf("Frame arena: %d / %d B committed, peak %d B, %d allocs",
+                                (int)frame_arena.used, (int)frame_arena.capacity,
+                                (int)frame_tracker.high_water, (int)frame_tracker.frame_alloc_count), pos, 32, 0, YELLOW);
+
+    pos.y += 32;
+    DrawTextEx(font, fz_tprintf("Steady state heap allocations: %d", (int)fz_alloc_guard_violations()), pos, 32, 0, YELLOW);
 
     if (game->core_state.current == GAME_IN_PROGRESS) {
         pos.y += 32;
-        DrawTextEx(font, TextFormat("Chain: %d / %d", game->chain_index, (int)VecLen(game->enemies)), pos, 32, 0, YELLOW);
+        DrawTextEx(font, fz_tprintf("Chain: %d / %d", game->combat.chain_index, (int)VecLen(game->combat.enemies)), pos, 32, 0, YELLOW);
 
-        if (game->chain_index < VecLen(game->enemies)) {
+        if (game->combat.chain_index < VecLen(game->combat.enemies)) {
             pos.y += 32;
-            Enemy_Chain *chain = &game->enemies[game->chain_index];
-            DrawTextEx(font, TextFormat("Enemy chain: %d / %d", game->enemy_index, chain->enemy_count), pos, 32, 0, YELLOW);
+            Enemy_Chain *chain = &game->combat.enemies[game->combat.chain_index];
+            DrawTextEx(font, fz_tprintf("Enemy chain: %d / %d", game->combat.enemy_index, chain->enemy_count), pos, 32, 0, YELLOW);
         }
     }
 
@@ -680,8 +588,8 @@ void draw_debug_information(Game *game) {
     Rectangle r = rectf4(tile_x, tile_y, TILE * x_ratio, TILE * y_ratio);
     DrawRectangleLinesEx(r, 1, YELLOW);
 
-    for (int i = 0; i < VecLen(game->effects); ++i) {
-        Rectangle r = game->effects[i].rect;
+    for (int i = 0; i < game->effects.count; ++i) {
+        Rectangle r = rect_of(fz_slab_at(&game->effects, Effect, i)->rect);
         r.x *= x_ratio;
         r.y *= x_ratio;
         r.width *= x_ratio;
@@ -698,26 +606,19 @@ void shake_camera(Game *game, int strength) {
     game->camerashake_shift_distance += strength;
 }
 
-void spawn_effect(Game *game, int effect_id, Rectangle rect) {
+fz_Handle spawn_effect(Game *game, int effect_id, Rectangle rect) {
     assert(ASSET_EFFECT_SPRITE_BEGIN < effect_id && effect_id < ASSET_EFFECT_SPRITE_END);
     Texture2D tex;
 
     if (!get_texture(effect_id, &tex)) {
         printf("Asset %d is not loaded. cannot spawn effects.\n", effect_id);
-        return;
+        return 0;
     }
 
     assert(tex.height == 64 && tex.width % 64 == 0);
     int life = (int)(tex.width / 64);
 
-    Effect effect = {0};
-
-    effect.asset_id = effect_id;
-    effect.elapsed  = 0;
-    effect.max_life = life;
-    effect.rect     = rect;
-
-    VecPush(game->effects, effect);
+    return effects_add(&game->effects, effect_id, life, { rect.x, rect.y, rect.width, rect.height });
 }
 
 enum
@@ -728,6 +629,16 @@ enum
     INTERACT_CLICK_RIGHT = 1 << 2,
 };
 
+Frame_Size measure_text(const char *label, float font_size) {
+    Vector2 size = MeasureTextEx(font, label, font_size, 0);
+    return { size.x, size.y };
+}
+
+Vector2 measure_label(const char *label, float font_size) {
+    Frame_Size size = label_cache_measure(&labels, label, font_size);
+    return { size.x, size.y };
+}
+
 int do_button_esque(uint32_t id, Rectangle rect, const char *label, float label_size, int interact_mask, Color color) {
     int result = INTERACT_NONE;
 
@@ -766,7 +677,7 @@ int do_button_esque(uint32_t id, Rectangle rect, const char *label, float label_
     }
 
     if (label) {
-        Vector2 size = MeasureTextEx(font, label, label_size, 0);
+        Vector2 size = measure_label(label, label_size);
         Vector2 pos  = Vector2Subtract(position_of_pivot(rect, MIDDLE, CENTER), Vector2Scale(size, 0.5));
         DrawTextEx(font, label, pos, label_size, 0, color);
     }
@@ -814,24 +725,6 @@ int state_tick(State *state, float dt) {
     return entered;
 }
 
-int interval_tick(Interval *interval, float dt) {
-    interval->current += dt;
-    if (interval->max < interval->current) {
-        interval->current -= interval->max;
-        if(interval->current < 0) interval->current = 0;
-
-        return 1;
-    }
-    return 0;
-}
-
-Action get_next_action_for(Actor *actor) {
-    Action action = actor->actions[actor->action_index];
-    actor->action_index = (actor->action_index + 1) % actor->action_count;
-
-    return action;
-}
-
 void update_music(Game *game) {
     Music title_music = music_assets[ASSET_MUSIC_TITLE - ASSET_MUSIC_BEGIN];
     Music combat_music = music_assets[ASSET_MUSIC_COMBAT - ASSET_MUSIC_BEGIN];
@@ -878,56 +771,73 @@ void update_music(Game *game) {
 }
 
 int combat_state_failsafe(Game *game) {
-    if(game->infinite_loop_counter == INFINITE_LOOP_FORCEQUIT) {
-        set_next_state(&game->combat_state, COMBAT_STATE_PLAYER_DIED, 4.0);
-        printf("Failsafe Triggered: Infinite Loop\n");
-        return 1;
-    }
+    switch(combat_status(&game->combat)) {
+        case COMBAT_FORCEQUIT:
+        {
+            set_next_state(&game->combat_state, COMBAT_STATE_PLAYER_DIED, 4.0);
+            printf("Failsafe Triggered: Infinite Loop\n");
+        } return 1;
 
-    if (game->player.health <= 0) {
-        set_next_state(&game->combat_state, COMBAT_STATE_PLAYER_DIED, 4.0);
-        printf("Failsafe Triggered: Player is dead\n");
-        return 1;
-    }
+        case COMBAT_PLAYER_DEAD:
+        {
+            set_next_state(&game->combat_state, COMBAT_STATE_PLAYER_DIED, 4.0);
+            printf("Failsafe Triggered: Player is dead\n");
+        } return 1;
 
-    if (game->chain_index == VecLen(game->enemies)) {
-        set_next_state(&game->combat_state, COMBAT_STATE_STAGE_COMPLETE, 4.0);
-        printf("Failsafe Triggered: Chain is empty\n");
-        return 1;
-    }
+        case COMBAT_STAGE_COMPLETE:
+        {
+            set_next_state(&game->combat_state, COMBAT_STATE_STAGE_COMPLETE, 4.0);
+            printf("Failsafe Triggered: Chain is empty\n");
+        } return 1;
 
-    /* Check if player / enemies are allowed to continue fighting. */
-    Enemy_Chain *chain = &game->enemies[game->chain_index];
+        case COMBAT_CHAIN_COMPLETE:
+        {
+            set_next_state(&game->combat_state, COMBAT_STATE_GOING_NEXT_PHASE, 2.0);
+            printf("Failsafe Triggered: No enemy remains\n");
+        } return 1;
 
-    if (game->enemy_index == chain->enemy_count) {
-        set_next_state(&game->combat_state, COMBAT_STATE_GOING_NEXT_PHASE, 2.0);
-        printf("Failsafe Triggered: No enemy remains\n");
-        return 1;
+        case COMBAT_ENEMY_DEAD: // Progress to next enemy then break
+        {
+            set_next_state(&game->combat_state, COMBAT_STATE_ENEMY_DIED, 0.25);
+            printf("Failsafe Triggered: Enemy is 0 health\n");
+        } return 1;
+
+        default: return 0;
     }
+}
 
-    Actor *enemy = &chain->enemies[game->enemy_index];
-    if (enemy->health <= 0) { // Progress to next enemy then break
-        set_next_state(&game->combat_state, COMBAT_STATE_ENEMY_DIED, 0.25);
-        printf("Failsafe Triggered: Enemy is 0 health\n");
-        return 1;
+/* What each CUE_* plays and shows on the side that got attacked. */
+struct Cue_Assets {
+    int sound;
+    int effect; /* 0: nothing landed, no effect or camera shake. */
+};
+
+const Cue_Assets cue_assets[CUE_COUNT] = {
+    /* CUE_NONE       */ { 0,                  0                                   },
+    /* CUE_PARRIED    */ { ASSET_SOUND_PARRY,  0                                   },
+    /* CUE_EVADED     */ { ASSET_SOUND_EVADE,  0                                   },
+    /* CUE_SLASH_HIT  */ { ASSET_SOUND_SLASH,  ASSET_EFFECT_SPRITE_RECEIVED_SLASH  },
+    /* CUE_TACKLE_HIT */ { ASSET_SOUND_TACKLE, ASSET_EFFECT_SPRITE_RECEIVED_TACKLE },
+};
+
+void present_cue(Game *game, int cue, Rectangle target_rect) {
+    if (cue == CUE_NONE) return;
+
+    Sound s;
+    if (get_sound(cue_assets[cue].sound, &s)) {
+        PlaySoundMulti(s);
     }
 
-    return 0;
+    if (cue_assets[cue].effect) {
+        shake_camera(game, 8);
+        spawn_effect(game, cue_assets[cue].effect, target_rect);
+    }
 }
 
 void turn_tick(Game *game, float dt) {
     if (game->core_state.current != GAME_IN_PROGRESS) return;
     if (interval_tick(&game->turn_interval, dt)) {
-        game->last_enemy_action = 0;
-        game->last_player_action = 0;
-        /* Check if player / enemies are allowed to continue fighting. */
-        Enemy_Chain *chain = &game->enemies[game->chain_index];
-
-        Actor *player = &game->player;
-        Actor *enemy = &chain->enemies[game->enemy_index];
-
-        Action player_action = get_next_action_for(&game->player);
-        Action enemy_action  = get_next_action_for(enemy);
+        Turn_Result turn = combat_resolve_turn(&game->combat);
 
         Vector2 enemy_effect_pos;
         Vector2 enemy_effect_size;
@@ -944,146 +854,25 @@ void turn_tick(Game *game, float dt) {
         Rectangle enemy_effect_rect  = rectv2(enemy_effect_pos, enemy_effect_size);
         Rectangle player_effect_rect = rectv2(player_effect_pos, player_effect_size);
 
-        int player_prev_health = player->health;
-        int enemy_prev_health  = enemy->health;
-
-        switch(player_action.type) {
-            /* Offensive Maneuver */
-            case ACTION_SLASH: switch(enemy_action.type) {
-                case ACTION_PARRY:  /* blocks  */
-                {
-                    Sound s;
-                    if (get_sound(ASSET_SOUND_PARRY, &s)) {
-                        PlaySoundMulti(s);
-                    }
-                } break;
-
-                default:
-                {
-                    Sound s;
-                    if (get_sound(ASSET_SOUND_SLASH, &s)) {
-                        PlaySoundMulti(s);
-                    }
-                    shake_camera(game, 8);
-                    spawn_effect(game, ASSET_EFFECT_SPRITE_RECEIVED_SLASH, enemy_effect_rect);
-                    enemy->health -= 1;
-                    game->enemy_hit_highlight_dt = 0.2;
-                } break;
-            } break;
-
-            case ACTION_TACKLE: switch(enemy_action.type) {
-                case ACTION_EVADE:  /* blocked */
-                {
-                    Sound s;
-                    if (get_sound(ASSET_SOUND_EVADE, &s)) {
-                        PlaySoundMulti(s);
-                    }
-                } break;
-
-                default:
-                {
-                    Sound s;
-                    if (get_sound(ASSET_SOUND_TACKLE, &s)) {
-                        PlaySoundMulti(s);
-                    }
-
-                    spawn_effect(game, ASSET_EFFECT_SPRITE_RECEIVED_TACKLE, enemy_effect_rect);
-                    shake_camera(game, 8);
-                    enemy->health -= 1;
-                    game->enemy_hit_highlight_dt = 0.2;
-                } break;
-            } break;
-
-            default:
-                break;
+        present_cue(game, turn.outcome.player_cue, enemy_effect_rect);
+        if (turn.outcome.damage_to_enemy) {
+            game->enemy_hit_highlight_dt = 0.2;
         }
 
-        switch(enemy_action.type) {
-            /* Offensive Maneuver */
-            case ACTION_SLASH: switch(player_action.type) {
-                case ACTION_PARRY:  /* blocks  */
-                {
-                    Sound s;
-                    if (get_sound(ASSET_SOUND_PARRY, &s)) {
-                        PlaySoundMulti(s);
-                    }
-                } break;
-
-                default:
-                {
-                    Sound s;
-                    if (get_sound(ASSET_SOUND_SLASH, &s)) {
-                        PlaySoundMulti(s);
-                    }
-
-                    shake_camera(game, 8);
-                    spawn_effect(game, ASSET_EFFECT_SPRITE_RECEIVED_SLASH, player_effect_rect);
-                    player->health -= 1;
-                    game->flash_strength += 0.25;
-                    game->player_hit_highlight_dt = 0.2;
-                } break;
-            } break;
-
-            case ACTION_TACKLE: switch(player_action.type) {
-                case ACTION_EVADE:  /* blocked */
-                {
-                    Sound s;
-                    if (get_sound(ASSET_SOUND_EVADE, &s)) {
-                        PlaySoundMulti(s);
-                    }
-                } break;
-
-                default:
-                {
-                    Sound s;
-                    if (get_sound(ASSET_SOUND_TACKLE, &s)) {
-                        PlaySoundMulti(s);
-                    }
-                    shake_camera(game, 8);
-                    spawn_effect(game, ASSET_EFFECT_SPRITE_RECEIVED_TACKLE, player_effect_rect);
-                    player->health -= 1;
-                    game->flash_strength += 0.25;
-                    game->player_hit_highlight_dt = 0.2;
-                } break;
-            } break;
-
-            default:
-                break;
+        present_cue(game, turn.outcome.enemy_cue, player_effect_rect);
+        if (turn.outcome.damage_to_player) {
+            game->flash_strength += 0.25;
+            game->player_hit_highlight_dt = 0.2;
         }
 
-        game->last_player_action = player_action.type;
-        game->last_enemy_action  = enemy_action.type;
-
-        if (player->health == player_prev_health
-            && enemy->health == enemy_prev_health)
-        {
-            game->infinite_loop_counter++;
-        } else {
-            game->infinite_loop_counter = 0;
-        } 
+        game->last_player_action = turn.player_action;
+        game->last_enemy_action  = turn.enemy_action;
     }
 }
 
 void effects_tick(Game *game, float dt) {
     if (interval_tick(&game->effect_interval, dt)) {
-        Vec(int) deleting_index = VecCreateEx(int, VecLen(game->effects) + 1, fz_global_temp_allocator);
-        for (int i = 0; i < VecLen(game->effects); ++i) {
-            Effect *e = &game->effects[i];
-            e->elapsed += 1;
-            if (e->elapsed >= e->max_life) {
-                VecPush(deleting_index, i);
-            }
-        }
-
-        for (int i = VecLen(deleting_index) - 1; i >= 0; --i) {
-            /*
-             * deleting_index is sorted.
-             * traversing it in opposite order and performing unordered remove is
-             * faster and guaranteed to work without accidentally removing other effects */
-            VecRemoveUnorderedN(game->effects, deleting_index[i]);
-        }
-
-        VecRelease(deleting_index);
+        effects_advance(&game->effects);
     }
 }
 
@@ -1157,14 +946,11 @@ void update(Game *game, float dt) {
                     if (get_sound(ASSET_SOUND_NEXT_PHASE, &s)) {
                         PlaySoundMulti(s);
                     }
-                    if (game->chain_index < VecLen(game->enemies)) {
-                        game->chain_index++;
-                        game->enemy_index = 0;
-                    }
+                    combat_next_chain(&game->combat);
                 }
 
                 if (is_transition_done(&game->combat_state)) {
-                    if (game->enemy_index != 0) {
+                    if (game->combat.enemy_index != 0) {
                         set_next_state(&game->combat_state, COMBAT_STATE_STAGE_COMPLETE, 0.01);
                     }
                     set_next_state(&game->combat_state, COMBAT_STATE_PLAYER_PLANNING, 2.0);
@@ -1173,19 +959,19 @@ void update(Game *game, float dt) {
 
             case COMBAT_STATE_PLAYER_PLANNING:
             {
-                game->infinite_loop_counter = 0;
+                game->combat.infinite_loop_counter = 0;
                 if (is_transition_done(&game->combat_state)) {
 #if 1
                     if(IsKeyPressed('H')) {
-                        game->player.health = 0;
+                        game->combat.player.health = 0;
                         set_next_state(&game->combat_state, COMBAT_STATE_RUNNING_TURN, 0.25);
                     }
                     else if(IsKeyPressed('S')) {
-                        game->chain_index = VecLen(game->enemies);
+                        game->combat.chain_index = VecLen(game->combat.enemies);
                         set_next_state(&game->combat_state, COMBAT_STATE_RUNNING_TURN, 0.25);
                     }
                     else if(IsKeyPressed('I')) {
-                        Enemy_Chain *chain = &game->enemies[game->chain_index];
+                        Enemy_Chain *chain = &game->combat.enemies[game->combat.chain_index];
                         for (int i = 0; i < chain->enemy_count; ++i) {
                             chain->enemies[i].health = 0;
                         }
@@ -1206,12 +992,12 @@ void update(Game *game, float dt) {
                 }
 
                 if (is_transition_done(&game->combat_state)) {
-                    Enemy_Chain *current = &game->enemies[game->chain_index];
-                    if ((game->enemy_index + 1) < current->enemy_count) {
-                        game->enemy_index++;
+                    Enemy_Chain *current = &game->combat.enemies[game->combat.chain_index];
+                    if ((game->combat.enemy_index + 1) < current->enemy_count) {
+                        combat_next_enemy(&game->combat);
                         set_next_state(&game->combat_state, COMBAT_STATE_PLAYER_PLANNING, 0.25);
                     } else {
-                        if ((game->chain_index + 1) < VecLen(game->enemies)) {
+                        if ((game->combat.chain_index + 1) < VecLen(game->combat.enemies)) {
                             set_next_state(&game->combat_state, COMBAT_STATE_GOING_NEXT_PHASE, 1.25);
                         } else {
                             set_next_state(&game->combat_state, COMBAT_STATE_STAGE_COMPLETE, 2.25);
@@ -1380,14 +1166,14 @@ void render_combat_phase_indicator(Game *game) {
     float x = render_size.width * 0.5;
     float y = render_size.height * 0.15;
 
-    int chain_count = (int)VecLen(game->enemies);
+    int chain_count = (int)VecLen(game->combat.enemies);
     float gap_between    = TILE * 1.5;
     float indicator_size = 20; /* px */
     float fullwidth = chain_count * indicator_size + (chain_count - 1) * gap_between;
     x -= fullwidth * 0.5;
 
     for (int i = 0; i < chain_count; ++i) {
-        if (i == game->chain_index) {
+        if (i == game->combat.chain_index) {
             DrawCircle(x, y, indicator_size * 0.85, WHITE);
         } else {
             DrawCircleLines(x, y, indicator_size * 0.75, WHITE);
@@ -1410,7 +1196,7 @@ void render_player(Game *game, Rectangle player) {
 
     int texture_id = ASSET_PLAYER_STANDING;
 
-    if (game->player.health <= 0) {
+    if (game->combat.player.health <= 0) {
         texture_id = ASSET_PLAYER_DIED;
     } else {
         switch(game->last_player_action) {
@@ -1433,7 +1219,7 @@ void render_player(Game *game, Rectangle player) {
         draw_texture_sane(t, player, c);
     }
 
-    render_healthbar(&game->player, player);
+    render_healthbar(&game->combat.player, player);
 }
 
 void do_combat_gui(Game *game) {
@@ -1453,7 +1239,7 @@ void do_combat_gui(Game *game) {
 
     render_combat_phase_indicator(game);
 
-    Enemy_Chain *chain = &game->enemies[game->chain_index];
+    Enemy_Chain *chain = &game->combat.enemies[game->combat.chain_index];
     Rect_Builder b = rect_builder(render_size);
 
     Vector2 size = v2tile(4.5, 4.5);
@@ -1461,12 +1247,12 @@ void do_combat_gui(Game *game) {
     rb_set_size_v2(&b, size);
     rb_reposition_by_pivot(&b, MIDDLE, CENTER);
 
-    if (game->enemy_index < chain->enemy_count) {
-        Actor *enemy = &chain->enemies[game->enemy_index];
+    if (game->combat.enemy_index < chain->enemy_count) {
+        Actor *enemy = &chain->enemies[game->combat.enemy_index];
 
         render_enemy(game, enemy, b.result, 1);
 
-        for (int i = game->enemy_index + 1; i < chain->enemy_count; ++i) {
+        for (int i = game->combat.enemy_index + 1; i < chain->enemy_count; ++i) {
             Actor *enemy = &chain->enemies[i];
             rb_add_position_by(&b, TILE * 3, 0);
             render_enemy(game, enemy, b.result, 0);
@@ -1493,18 +1279,18 @@ void do_combat_gui(Game *game) {
 
         case COMBAT_STATE_RUNNING_TURN:  /* Nothing */
         {
-            if (game->infinite_loop_counter > (INFINITE_LOOP_FORCEQUIT / 2)) {
+            if (game->combat.infinite_loop_counter > (INFINITE_LOOP_FORCEQUIT / 2)) {
                 Vector2 r = {
                     render_size.width  * 0.5f,
                     render_size.height * 0.5f
                 };
 
-                int count = game->infinite_loop_counter - (INFINITE_LOOP_FORCEQUIT / 2);
+                int count = game->combat.infinite_loop_counter - (INFINITE_LOOP_FORCEQUIT / 2);
                 float activeness = (float)(count * 2) / (float)INFINITE_LOOP_FORCEQUIT;
 
                 Color c = Fade(WHITE, activeness);
                 const char *concern = "Are you in infinite loop?";
-                const char *desc = TextFormat("Ironic considering jam's theme, but forcequit will trigger in %d turns.", INFINITE_LOOP_FORCEQUIT - game->infinite_loop_counter);
+                const char *desc = fz_tprintf("Ironic considering jam's theme, but forcequit will trigger in %d turns.", INFINITE_LOOP_FORCEQUIT - game->combat.infinite_loop_counter);
 
                 Vector2 concern_size = MeasureTextEx(font, concern, TILE * 1.5, 0);
                 Vector2 desc_size    = MeasureTextEx(font, desc,    TILE, 0);
@@ -1549,7 +1335,7 @@ void do_combat_gui(Game *game) {
             };
 
             Color c = Fade(WHITE, 1 - state_activeness);
-            const char *format = TextFormat("Phase %d", game->chain_index + 1);
+            const char *format = fz_tprintf("Phase %d", game->combat.chain_index + 1);
             Vector2 pos = align_text_by(r, format, MIDDLE, CENTER, TILE * 2.5);
             DrawTextEx(font, format, pos, TILE * 2.5, 0, c);
         } break;
@@ -1586,12 +1372,12 @@ void do_combat_gui(Game *game) {
             button.y = (render_size.height * 0.65) - (play_button_size.y * 0.5);
 
             float activeness = usable_button_activeness;
-            if (game->player.action_count == 0) {
+            if (game->combat.player.action_count == 0) {
                 activeness = 0.5;
             }
 
             int flags = 0;
-            if (game->player.action_count > 0
+            if (game->combat.player.action_count > 0
                 && game->combat_state.current == COMBAT_STATE_PLAYER_PLANNING
                 && is_transition_done(&game->combat_state))
             {
@@ -1600,7 +1386,7 @@ void do_combat_gui(Game *game) {
             int pressed = do_button_esque(hash("play"), button, "Lock in", TILE * 0.75, flags, Fade(WHITE, activeness));
 
             if (pressed & INTERACT_CLICK_LEFT) {
-                game->locked_in_index = game->player.action_count;
+                game->locked_in_index = game->combat.player.action_count;
                 Sound s;
                 if (get_sound(ASSET_SOUND_ACTION_LOCKIN, &s)) {
                     PlaySoundMulti(s);
@@ -1611,7 +1397,7 @@ void do_combat_gui(Game *game) {
 
         /* Queue number (as in ?/?) */
         {
-            const char *format = TextFormat("%d / %d", game->player.action_count, ACTION_CAPACITY);
+            const char *format = fz_tprintf("%d / %d", game->combat.player.action_count, ACTION_CAPACITY);
             float w = MeasureText(format, 18);
             DrawText(format, layout.x + (ACTION_CAPACITY * TILE * 0.5) - (w * 0.5), layout.y - 18 - 2, 18, WHITE);
         }
@@ -1627,16 +1413,16 @@ void do_combat_gui(Game *game) {
             float fg_activeness = (i < game->locked_in_index) ? 0.5 : 1;
 
             Action *a = 0;
-            if (i < game->player.action_count) {
-                a = &game->player.actions[i];
+            if (i < game->combat.player.action_count) {
+                a = &game->combat.player.actions[i];
             }
 
-            if (i == game->player.action_index) {
+            if (i == game->combat.player.action_index) {
                 DrawCircle(r.x + TILE * 0.5, r.y - TILE * 0.25, 8, WHITE);
             }
             render_action_icon(a, r, 2, bg_activeness, fg_activeness);
 
-            if (CheckCollisionPointRec(mouse_pos, r) && (i < game->player.action_count)) {
+            if (CheckCollisionPointRec(mouse_pos, r) && (i < game->combat.player.action_count)) {
                 deleting = i;
             }
         }
@@ -1661,7 +1447,7 @@ void do_combat_gui(Game *game) {
             reset_button_alpha = 1;
         }
 
-        const char *text = TextFormat("Reset (%d)", game->reset_count);
+        const char *text = fz_tprintf("Reset (%d)", game->reset_count);
         int reset_has_been_pressed = do_button_esque(hash("Reset"), r, text, TILE * 0.75, flag, Fade(WHITE, reset_button_alpha));
 
         /* Handle interactions */
@@ -1669,8 +1455,8 @@ void do_combat_gui(Game *game) {
             && is_transition_done(&game->combat_state))
         {
             if (reset_has_been_pressed & INTERACT_HOVERING) {
-                const char *text = TextFormat("Reset current lock-in index (%d use remain)", game->reset_count);
-                Vector2 size = Vector2Add(MeasureTextEx(font, text, TILE * 0.5, 0), { 10, 10 });
+                const char *text = fz_tprintf("Reset current lock-in index (%d use remain)", game->reset_count);
+                Vector2 size = Vector2Add(measure_label(text, TILE * 0.5), { 10, 10 });
                 Vector2 pos  = mouse_pos;
                 pos.y -= size.y;
 
@@ -1681,20 +1467,20 @@ void do_combat_gui(Game *game) {
 
             if (reset_has_been_pressed & INTERACT_CLICK_LEFT) {
                 game->locked_in_index = -1;
-                game->player.action_count = 0;
-                game->player.action_index = 0;
+                game->combat.player.action_count = 0;
+                game->combat.player.action_index = 0;
 
-                memset(game->player.actions, 0, sizeof(Action) * ACTION_CAPACITY);
+                memset(game->combat.player.actions, 0, sizeof(Action) * ACTION_CAPACITY);
 
                 game->reset_count--;
             }
 
             if (deleting != -1) {
-                int action_type  = game->player.actions[deleting].type;
+                int action_type  = game->combat.player.actions[deleting].type;
                 const char *name = action_type_to_name_char[action_type];
                 if(game->locked_in_index <= deleting) {
-                    const char *text = TextFormat("Remove %s", name);
-                    Vector2 size = Vector2Add(MeasureTextEx(font, text, TILE * 0.5, 0), {20, 10});
+                    const char *text = fz_tprintf("Remove %s", name);
+                    Vector2 size = Vector2Add(measure_label(text, TILE * 0.5), {20, 10});
                     Vector2 pos = mouse_pos;
                     pos.y -= size.y;
 
@@ -1716,16 +1502,16 @@ void do_combat_gui(Game *game) {
                             PlaySoundMulti(s);
                         }
 
-                        if (deleting < (game->player.action_count - 1)) {
-                            memmove(&game->player.actions[deleting],
-                                    &game->player.actions[deleting + 1],
-                                    game->player.action_count - deleting);
+                        if (deleting < (game->combat.player.action_count - 1)) {
+                            memmove(&game->combat.player.actions[deleting],
+                                    &game->combat.player.actions[deleting + 1],
+                                    game->combat.player.action_count - deleting);
                         }
-                        game->player.action_count -= 1;
+                        game->combat.player.action_count -= 1;
                     }
                 } else {
-                    const char *text = TextFormat("cannot remove %s: it's locked in.", name);
-                    Vector2 size = Vector2Add(MeasureTextEx(font, text, TILE * 0.5, 0), {20, 10});
+                    const char *text = fz_tprintf("cannot remove %s: it's locked in.", name);
+                    Vector2 size = Vector2Add(measure_label(text, TILE * 0.5), {20, 10});
                     Vector2 pos = mouse_pos;
                     pos.y -= size.y;
 
@@ -1800,12 +1586,12 @@ void do_combat_gui(Game *game) {
 
                 if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON)) {
                     Action a = base_actions[selected];
-                    if (game->player.action_count < ACTION_CAPACITY) {
+                    if (game->combat.player.action_count < ACTION_CAPACITY) {
                         Sound s;
                         if(get_sound(ASSET_SOUND_ACTION_SUBMIT, &s)) {
                             PlaySoundMulti(s);
                         }
-                        game->player.actions[game->player.action_count++] = a;
+                        game->combat.player.actions[game->combat.player.action_count++] = a;
                     }
                 }
             }
@@ -2000,10 +1786,6 @@ void do_stage_select_gui(Game *game) {
     }
 }
 
-int effectsort(const void *a, const void *b) {
-    return ((Effect*)a)->asset_id - ((Effect*)b)->asset_id;
-}
-
 void do_gui(Game *game) {
     BeginTextureMode(render_tex);
     ClearBackground(BLACK);
@@ -2049,12 +1831,14 @@ void do_gui(Game *game) {
         } break;
     }
 
-    VecSort(game->effects, effectsort);
+    /* Group by texture. */
+    Effect *effects = fz_slab_at(&game->effects, Effect, 0);
+    Vec(int) draw_order = effects_draw_order(&game->effects);
 
     int current_asset_id = -1;
     Texture2D t = {0};
-    for (int i = 0; i < VecLen(game->effects); ++i) {
-        Effect *e = &game->effects[i];
+    for (int i = 0; i < VecLen(draw_order); ++i) {
+        Effect *e = &effects[draw_order[i]];
         if (current_asset_id != e->asset_id) {
             if (get_texture(e->asset_id, &t)) {
                 assert(t.height == 64 && (t.width % 64) == 0);
@@ -2064,7 +1848,7 @@ void do_gui(Game *game) {
 
         assert((e->elapsed * 64) < t.width);
         Rectangle src  = { (float)e->elapsed * 64, 0, 64, 64 };
-        Rectangle dest = e->rect;
+        Rectangle dest = rect_of(e->rect);
 
         Vector2 origin = {0};
         DrawTexturePro(t, src, dest, origin, 1, WHITE);
@@ -2078,11 +1862,15 @@ int main(void) {
     InitWindow(window_size.width, window_size.height, "MainWindow");
     InitAudioDevice();
 
-    void *arena_mem = fz_heapalloc(32 * fz_KB);
+    /* Frame arena: reserves plenty, only commits what a frame actually touches. */
+    fz_arena_init_virtual(&frame_arena, 64 * fz_MB, 256 * fz_KB);
+
+    fz_tracker_init(&heap_tracker,  fz_heap_allocator(),             "heap");
+    fz_tracker_init(&frame_tracker, fz_arena_allocator(&frame_arena), "frame arena");
+    fz_set_allocator(fz_tracker_allocator(&heap_tracker));
+    fz_set_temp_allocator(fz_tracker_allocator(&frame_tracker));
 
-    fz_Arena arena = {0};
-    fz_arena_init(&arena, arena_mem, 32 * fz_KB);
-    fz_set_temp_allocator(fz_arena_allocator(&arena));
+    label_cache_init(&labels, measure_text);
 
     dither_shader = LoadShader(0, "assets/shaders/dither_shader.fs");
     set_shaderloc(&dither_shader, &dither_shader_loc);
@@ -2097,8 +1885,9 @@ int main(void) {
 
 
     Game game = {{0}};
-    game.enemies = VecCreate(Enemy_Chain, 10);
-    game.effects = VecCreate(Effect, 32);
+    game.combat.enemies = VecCreate(Enemy_Chain, 10);
+    void *effect_memory = fz_alloc(EFFECT_MEMORY);
+    fz_slab_init(&game.effects, effect_memory, EFFECT_MEMORY, sizeof(Effect));
     set_next_state(&game.core_state,   TITLE_SCREEN, 0.1);
     set_next_state(&game.combat_state, COMBAT_STATE_NONE, 1);
 
@@ -2148,8 +1937,14 @@ int main(void) {
     load_music_to_id(ASSET_MUSIC_TITLE, "assets/sounds/terrible_loading_screen.wav");
     load_music_to_id(ASSET_MUSIC_COMBAT, "assets/sounds/terrible_combat_bgm.wav");
 
+    /* After warming up, the main loop must not touch the heap; anything that does gets reported. */
+    fz_alloc_guard_begin(STEADY_STATE_WARMUP_FRAMES, 0);
+
     while(!WindowShouldClose()) {
-        fz_Temp_Memory t = fz_begin_temp(&arena);
+        fz_alloc_guard_frame();
+        fz_Temp_Memory t = fz_begin_temp(&frame_arena);
+        fz_tracker_next_frame(&heap_tracker);
+        fz_tracker_next_frame(&frame_tracker);
         float dt  = GetFrameTime();
 
         Vector2 ws = { window_size.width, window_size.height };
@@ -2172,10 +1967,20 @@ int main(void) {
 
 #if 1
         draw_debug_information(&game);
+
+        if (IsKeyPressed(KEY_F2)) {
+            // the dump builds its tables on the heap, that's not the game allocating.
+            fz_alloc_guard_pause();
+            if (fz_tracker_dump_pprof(&heap_tracker, "heap.pprof")) {
+                printf("Heap profile written to heap.pprof (go tool pprof -top heap.pprof)\n");
+            }
+            fz_alloc_guard_resume();
+        }
 #endif
         EndDrawing();
 
         fz_end_temp(t);
+        fz_tracker_reset_in_use(&frame_tracker);
     }
 
     for (int i = 0; i < fz_COUNTOF(art_assets); ++i) {
@@ -2192,14 +1997,18 @@ int main(void) {
         UnloadMusicStream(music_assets[i]);
     }
 
-    VecRelease(game.enemies);
-    VecRelease(game.effects);
+    VecRelease(game.combat.enemies);
+    fz_free(effect_memory);
     UnloadFont(font);
     UnloadRenderTexture(render_tex);
     UnloadShader(dither_shader);
     CloseAudioDevice();
     CloseWindow();
 
-    fz_heapfree(arena_mem);
+    fz_alloc_guard_end();
+    label_cache_release(&labels);
+    fz_tracker_release(&frame_tracker);
+    fz_tracker_release(&heap_tracker);
+    fz_arena_release(&frame_arena);
     return 0;
 }
@@ -77,6 +77,26 @@ extern "C" {
 #include <string.h> // size_t
 #include <assert.h> // assertion
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define fz_HAS_SSE2 1
+#endif
+
+// only what the compiler was told to target (-mavx2, -march=native, /arch:AVX2); nothing is detected at runtime.
+#if defined(__SSE4_1__) || defined(__AVX__)
+#include <smmintrin.h>
+#define fz_HAS_SSE41 1
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define fz_HAS_AVX2 1
+#endif
+
+#if defined(fz_COMPILER_MSVC)
+#include <intrin.h> // _BitScanForward, _BitScanReverse
+#endif
+
 /*
  * ==================================================
  * Bunch of basic defines.
@@ -98,6 +118,19 @@ extern "C" {
 
 #define fz_UNUSED(x) ((void)x)
 
+// lets the compiler check printf style arguments. index of the format argument, then of the first vararg.
+#if defined(fz_COMPILER_MSVC)
+#define fz_PRINTF_FORMAT(format_index, args_index)
+#else
+#define fz_PRINTF_FORMAT(format_index, args_index) __attribute__((format(printf, format_index, args_index)))
+#endif
+
+#if defined(fz_COMPILER_MSVC)
+#define fz_THREAD_LOCAL __declspec(thread)
+#else
+#define fz_THREAD_LOCAL __thread
+#endif
+
 #define fz_STATIC_ASSERT(cond) \
   typedef char fz_CONCAT(fz_static_assert_failed_at_, __LINE__)[(cond) ? 1 : -1];
 
@@ -105,6 +138,91 @@ extern "C" {
 #define fz_MB ((size_t)1024 * fz_KB)
 #define fz_GB ((size_t)1024 * fz_MB)
 
+#ifndef fz_CACHE_LINE_SIZE
+#define fz_CACHE_LINE_SIZE 64
+#endif
+
+/*
+ * ==================================================
+ * Bit helpers.
+ * ==================================================
+ * */
+
+// count trailing / leading zeros. x must be non-zero.
+inline int
+fz_ctz32(uint32_t x) {
+    assert(x);
+#if defined(fz_COMPILER_MSVC)
+    unsigned long index;
+    _BitScanForward(&index, x);
+    return (int)index;
+#else
+    return __builtin_ctz(x);
+#endif
+}
+
+inline int
+fz_clz32(uint32_t x) {
+    assert(x);
+#if defined(fz_COMPILER_MSVC)
+    unsigned long index;
+    _BitScanReverse(&index, x);
+    return 31 - (int)index;
+#else
+    return __builtin_clz(x);
+#endif
+}
+
+/*
+ * ==================================================
+ * Atomics.
+ * loads acquire, stores release, read-modify-writes are sequentially consistent.
+ * add / exchange / cas return the previous value.
+ * ==================================================
+ * */
+
+#if defined(fz_COMPILER_MSVC)
+// NOTE(fuzzy): x86/x64 only. plain volatile accesses already have acquire / release semantics there,
+// the barrier just keeps the compiler from moving things around.
+inline uint32_t fz_atomic_load32(volatile uint32_t *target)                { uint32_t v = *target; _ReadWriteBarrier(); return v; }
+inline uint64_t fz_atomic_load64(volatile uint64_t *target)                { uint64_t v = *target; _ReadWriteBarrier(); return v; }
+inline void     fz_atomic_store32(volatile uint32_t *target, uint32_t v)   { _ReadWriteBarrier(); *target = v; }
+inline void     fz_atomic_store64(volatile uint64_t *target, uint64_t v)   { _ReadWriteBarrier(); *target = v; }
+inline uint32_t fz_atomic_add32(volatile uint32_t *target, uint32_t v)     { return (uint32_t)_InterlockedExchangeAdd((volatile long *)target, (long)v); }
+inline uint64_t fz_atomic_add64(volatile uint64_t *target, uint64_t v)     { return (uint64_t)_InterlockedExchangeAdd64((volatile long long *)target, (long long)v); }
+inline uint64_t fz_atomic_exchange64(volatile uint64_t *target, uint64_t v){ return (uint64_t)_InterlockedExchange64((volatile long long *)target, (long long)v); }
+inline uint32_t fz_atomic_cas32(volatile uint32_t *target, uint32_t expected, uint32_t desired) {
+    return (uint32_t)_InterlockedCompareExchange((volatile long *)target, (long)desired, (long)expected);
+}
+inline uint64_t fz_atomic_cas64(volatile uint64_t *target, uint64_t expected, uint64_t desired) {
+    return (uint64_t)_InterlockedCompareExchange64((volatile long long *)target, (long long)desired, (long long)expected);
+}
+inline void     fz_atomic_fence(void)      { _mm_mfence(); }
+inline void     fz_atomic_spin_pause(void) { _mm_pause(); }
+#else
+inline uint32_t fz_atomic_load32(volatile uint32_t *target)                { return __atomic_load_n(target, __ATOMIC_ACQUIRE); }
+inline uint64_t fz_atomic_load64(volatile uint64_t *target)                { return __atomic_load_n(target, __ATOMIC_ACQUIRE); }
+inline void     fz_atomic_store32(volatile uint32_t *target, uint32_t v)   { __atomic_store_n(target, v, __ATOMIC_RELEASE); }
+inline void     fz_atomic_store64(volatile uint64_t *target, uint64_t v)   { __atomic_store_n(target, v, __ATOMIC_RELEASE); }
+inline uint32_t fz_atomic_add32(volatile uint32_t *target, uint32_t v)     { return __atomic_fetch_add(target, v, __ATOMIC_SEQ_CST); }
+inline uint64_t fz_atomic_add64(volatile uint64_t *target, uint64_t v)     { return __atomic_fetch_add(target, v, __ATOMIC_SEQ_CST); }
+inline uint64_t fz_atomic_exchange64(volatile uint64_t *target, uint64_t v){ return __atomic_exchange_n(target, v, __ATOMIC_SEQ_CST); }
+inline uint32_t fz_atomic_cas32(volatile uint32_t *target, uint32_t expected, uint32_t desired) {
+    __atomic_compare_exchange_n(target, &expected, desired, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    return expected;
+}
+inline uint64_t fz_atomic_cas64(volatile uint64_t *target, uint64_t expected, uint64_t desired) {
+    __atomic_compare_exchange_n(target, &expected, desired, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    return expected;
+}
+inline void     fz_atomic_fence(void) { __atomic_thread_fence(__ATOMIC_SEQ_CST); }
+inline void     fz_atomic_spin_pause(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+#endif
+
 #if !defined(fz_MINIMAL_FOOTPRINT)
 /*
  * ==================================================
@@ -134,23 +252,33 @@ struct fz_Allocator {
 };
 
 extern fz_Allocator fz_global_allocator;
-extern fz_Allocator fz_global_temp_allocator;
+extern fz_THREAD_LOCAL fz_Allocator fz_global_temp_allocator; // each thread sets its own.
 
-fz_DEF fz_Allocator fz_hook_at_alloc(fz_Allocator new_allocator);
+fz_DEF fz_Allocator fz_set_allocator(fz_Allocator new_allocator);
 fz_DEF fz_Allocator fz_set_temp_allocator(fz_Allocator new_allocator);
 
+// Call site of the allocation that is about to happen; read (and cleared) by the tracking allocator.
+// only written when fz_TRACK_ALLOCATIONS is defined, so it costs nothing otherwise.
+extern fz_THREAD_LOCAL const char *fz_alloc_site;
+
+#if defined(fz_TRACK_ALLOCATIONS)
+#define fz_MARK_SITE() (fz_alloc_site = fz_FILE_AND_LINE)
+#else
+#define fz_MARK_SITE() ((void)0)
+#endif
+
 // ==========================
 // allocation using global definitions.
 
-#define fz_alloc(size) (fz_alloc_ex(fz_global_allocator, size))
+#define fz_alloc(size) (fz_MARK_SITE(), fz_alloc_ex(fz_global_allocator, size))
 #define fz_free(ptr) (fz_free_ex(fz_global_allocator, ptr))
-#define fz_realloc(ptr, old_size, size) (fz_realloc_ex(fz_global_allocator, ptr, old_size, size))
+#define fz_realloc(ptr, old_size, size) (fz_MARK_SITE(), fz_realloc_ex(fz_global_allocator, ptr, old_size, size))
 
-#define fz_heapalloc(size) (fz_alloc_ex(fz_heap_allocator(), size))
+#define fz_heapalloc(size) (fz_MARK_SITE(), fz_alloc_ex(fz_heap_allocator(), size))
 #define fz_heapfree(ptr) (fz_free_ex(fz_heap_allocator(), ptr))
-#define fz_heaprealloc(ptr, old_size, size) (fz_realloc_ex(fz_heap_allocator(), ptr, old_size, size))
+#define fz_heaprealloc(ptr, old_size, size) (fz_MARK_SITE(), fz_realloc_ex(fz_heap_allocator(), ptr, old_size, size))
 
-#define fz_talloc(size) (fz_alloc_ex(fz_global_temp_allocator, size))
+#define fz_talloc(size) (fz_MARK_SITE(), fz_alloc_ex(fz_global_temp_allocator, size))
 #define fz_tfree(ptr)   (fz_free_ex(fz_global_temp_allocator, ptr))
 
 inline void *
@@ -206,6 +334,8 @@ fz_DEF void *fz__vec_create(size_t entry_type_size, size_t capacity, fz_Allocato
 fz_DEF int  fz__vec_grow(void **output, fz_Array_Header_Type *array, size_t element_size, size_t grow_count);
 fz_DEF void fz__vec_release(fz_Array_Header_Type *array_header);
 fz_DEF void fz__vec_sort(void *array, size_t element_size, fz_COMPARATOR_FUNC comparator_func);
+// 1 if reallocating the buffer from old_size to new_size keeps its address (arena, last allocation or shrinking).
+fz_DEF int  fz__vec_resizes_in_place(fz_Array_Header_Type *array, size_t old_size, size_t new_size);
 
 #define fz_Vec(type)           type *
 #define fz_Vec_Header(array)   ((fz_Array_Header_Type *)(array) - 1)
@@ -214,11 +344,11 @@ fz_DEF void fz__vec_sort(void *array, size_t element_size, fz_COMPARATOR_FUNC co
 #define fz_Vec_SetLength(array, len) ((array) && (fz_Vec_Length(array) < len) && (fz_Vec_Capacity(array) < len) ? (fz_Vec_Header(array)->used = len) : 0)
 
 // Internals
-#define _FV_GROW(arr, sz)  (fz__vec_grow((void **)&(arr), fz_Vec_Header(arr), sizeof(arr[0]), sz))
+#define _FV_GROW(arr, sz)  (fz_MARK_SITE(), fz__vec_grow((void **)&(arr), fz_Vec_Header(arr), sizeof(arr[0]), sz))
 #define _FV_MAYBEGROW(arr, sz) ((arr) && (fz_Vec_Length(arr) == fz_Vec_Capacity(arr)) \
                                ? _FV_GROW(arr, sz) : 0)
 
-#define fz_Vec_CreateEx(type, caps, allocator) (type *)fz__vec_create(sizeof(type), (caps), (allocator))
+#define fz_Vec_CreateEx(type, caps, allocator) (type *)(fz_MARK_SITE(), fz__vec_create(sizeof(type), (caps), (allocator)))
 #define fz_Vec_Create(type, caps)              fz_Vec_CreateEx(type, caps, fz_global_allocator)
 #define fz_Vec_Release(array)                  fz__vec_release(fz_Vec_Header(array))
 
@@ -251,23 +381,67 @@ fz_DEF void fz__vec_sort(void *array, size_t element_size, fz_COMPARATOR_FUNC co
 /*
  * ==================================================
  *  Hashmap.
- *  TODO: not implemented yet.
+ *  open addressing with swiss-table style control bytes, probed 16 slots at a time.
+ *  same as Vec, the pointer points to the value slots; header sits right before it.
  * ==================================================
  * */
 
+// NOTE(fuzzy): keys are plain 64-bit integers.
+// MapObj2Key / MapChar2Key hash the object into a key, so two objects with the same 64-bit hash are the same key.
+
+#define fz_MAP_GROUP_WIDTH 16
 
-#if 0
-#define fz_Map(type)
-#define fz_Map_Header(map)
+struct fz_Map_Header_Type {
+    fz_Allocator allocator;
+    size_t element_size;
+    size_t caps;       // slot count. always power of two and >= fz_MAP_GROUP_WIDTH.
+    size_t used;
+    size_t tombstones;
+
+    uint64_t *keys;
+    int8_t   *ctrl;    // caps + fz_MAP_GROUP_WIDTH bytes. the tail mirrors the first group.
+};
+
+fz_DEF void     *fz__map_create(size_t element_size, size_t capacity, fz_Allocator allocator);
+fz_DEF void      fz__map_release(fz_Map_Header_Type *header);
+fz_DEF void      fz__map_reserve(void **map, size_t count);
+fz_DEF void      fz__map_reserve_key(void **map, uint64_t key);
+fz_DEF size_t    fz__map_insert(fz_Map_Header_Type *header, uint64_t key);
+fz_DEF ptrdiff_t fz__map_find(fz_Map_Header_Type *header, uint64_t key);
+fz_DEF size_t    fz__map_index_or_default(fz_Map_Header_Type *header, uint64_t key);
+fz_DEF int       fz__map_delete(fz_Map_Header_Type *header, uint64_t key);
+
+fz_DEF uint64_t fz_hash_bytes(const void *data, size_t size);
+fz_DEF uint64_t fz_hash_string(const char *str);
+
+#define fz_Map(type)           type *
+#define fz_Map_Header(map)     ((fz_Map_Header_Type *)(map) - 1)
+#define fz_Map_Length(map)     ((map) ? fz_Map_Header(map)->used : 0)
+#define fz_Map_Capacity(map)   ((map) ? fz_Map_Header(map)->caps : 0)
+
+#define fz_Map_CreateEx(type, caps, allocator) (type *)(fz_MARK_SITE(), fz__map_create(sizeof(type), (caps), (allocator)))
+#define fz_Map_Create(type, caps)              fz_Map_CreateEx(type, caps, fz_global_allocator)
+#define fz_Map_Release(map)                    fz__map_release(fz_Map_Header(map))
+
+// Get returns a copy, zeroed when the key does not exist. use Find to tell them apart.
+// the zeroed default is one shared slot, so Get can't hand out something writable.
+// Put only grows the table for keys that aren't in it yet.
+#define fz_Map_Has(map, key)        (fz__map_find(fz_Map_Header(map), (key)) >= 0)
+#define fz_Map_Find(map, key)       (fz__map_find(fz_Map_Header(map), (key)))
+#define fz_Map_Put(map, key, item)  (fz_MARK_SITE(), fz__map_reserve_key((void **)&(map), (key)), (map)[fz__map_insert(fz_Map_Header(map), (key))] = (item))
+#if defined(__cplusplus)
+#define fz_Map_Get(map, key)        (fz__map_get((map), fz__map_index_or_default(fz_Map_Header(map), (key))))
+#else
+#define fz_Map_Get(map, key)        (0 ? (map)[0] : (map)[fz__map_index_or_default(fz_Map_Header(map), (key))])
+#endif
+#define fz_Map_Delete(map, key)     (fz__map_delete(fz_Map_Header(map), (key)))
 
-#define fz_Map_CreateEx(type, caps, allocator)
-#define fz_Map_Create(type, caps)
-#define fz_Map_Release(map)
+// Iteration: for (i = 0; i < MapCap(map); ++i) if (MapSlotUsed(map, i)) { MapKeyAt(map, i), map[i] }
+#define fz_Map_SlotUsed(map, i)     (fz_Map_Header(map)->ctrl[i] >= 0)
+#define fz_Map_KeyAt(map, i)        (fz_Map_Header(map)->keys[i])
 
-#define fz_Map_Has(map, key)
-#define fz_Map_Put(map, key, item)
-#define fz_Map_Get(map, key)
-#define fz_Map_Delete(map, key)
+#define fz_Map_ObjectToKey(obj)     (fz_hash_bytes(&(obj), sizeof(obj)))
+#define fz_Map_CharToKey(str)       (fz_hash_string(str))
 
 #if !defined(fz_STRETCH_BUFFER_NO_SHORTHAND)
 
@@ -276,17 +450,80 @@ fz_DEF void fz__vec_sort(void *array, size_t element_size, fz_COMPARATOR_FUNC co
 #define MapCreateEx fz_Map_CreateEx
 #define MapCreate   fz_Map_Create
 #define MapRelease  fz_Map_Release
+#define MapLen      fz_Map_Length
+#define MapCap      fz_Map_Capacity
 
 #define MapObj2Key  fz_Map_ObjectToKey
 #define MapChar2Key fz_Map_CharToKey
 
 #define MapContains fz_Map_Has
+#define MapFind     fz_Map_Find
 #define MapSet      fz_Map_Put
 #define MapGet      fz_Map_Get
 #define MapDelete   fz_Map_Delete
 
+#define MapSlotUsed fz_Map_SlotUsed
+#define MapKeyAt    fz_Map_KeyAt
+
 #endif // if defined fz_STRETCH_BUFFER_NO_SHORTHAND
-#endif // if 0
+
+/*
+ * ==================================================
+ *  Strings.
+ *  fz_Str is a view: pointer + length. everything made here is also NUL terminated, so data goes
+ *  straight into C / raylib functions. format / builder memory comes from the given allocator,
+ *  with the frame temp allocator a string lives until the end of the frame, no matter how many are alive.
+ *
+ *      DrawText(fz_tprintf("Reset (%d)", count), ...);
+ *
+ *  fz_Intern hands out a stable id per distinct string, 0 is never used. meant for bounded sets
+ *  (labels, tooltips, asset names), every distinct string stays around until fz_intern_release.
+ * ==================================================
+ * */
+
+struct fz_Str {
+    const char *data;
+    int         length;
+};
+
+#ifndef fz_STR_FORMAT_GUESS
+#define fz_STR_FORMAT_GUESS 128 // first try; longer results get formatted a second time.
+#endif
+
+fz_DEF fz_Str fz_str(const char *cstr);
+fz_DEF int    fz_str_equal(fz_Str a, fz_Str b);
+fz_DEF fz_Str fz_str_copy(fz_Allocator allocator, fz_Str str);
+fz_DEF fz_Str fz_str_vformat(fz_Allocator allocator, const char *format, va_list args);
+fz_DEF fz_Str fz_str_format(fz_Allocator allocator, const char *format, ...) fz_PRINTF_FORMAT(2, 3);
+
+// NUL terminated, lives in the temp allocator.
+#define fz_tprintf(...) (fz_MARK_SITE(), fz_str_format(fz_global_temp_allocator, __VA_ARGS__).data)
+
+struct fz_Str_Builder {
+    fz_Allocator allocator;
+    char        *data;
+    int          length;
+    int          capacity; // not counting the NUL.
+};
+
+fz_DEF void   fz_str_builder_init(fz_Str_Builder *builder, fz_Allocator allocator, int capacity);
+fz_DEF void   fz_str_append(fz_Str_Builder *builder, fz_Str str);
+fz_DEF void   fz_str_appendf(fz_Str_Builder *builder, const char *format, ...) fz_PRINTF_FORMAT(2, 3);
+// trims the unused capacity (free on an arena when nothing came after) and hands the string over.
+fz_DEF fz_Str fz_str_builder_finish(fz_Str_Builder *builder);
+
+struct fz_Intern {
+    fz_Allocator     allocator;
+    fz_Map(uint32_t) ids;     // fz_hash_bytes of the string -> id.
+    fz_Vec(fz_Str)   strings; // id - 1 -> own copy.
+};
+
+fz_DEF void     fz_intern_init(fz_Intern *table, fz_Allocator allocator);
+fz_DEF void     fz_intern_release(fz_Intern *table);
+fz_DEF uint32_t fz_intern(fz_Intern *table, fz_Str str);
+// 0 when str was never interned. never adds.
+fz_DEF uint32_t fz_intern_find(fz_Intern *table, fz_Str str);
+fz_DEF fz_Str   fz_intern_string(fz_Intern *table, uint32_t id);
 
 /*
  * ==================================================
@@ -298,6 +535,97 @@ fz_DEF void *fz_platform_alloc(size_t size);
 fz_DEF void *fz_platform_realloc(void *ptr, size_t size);
 fz_DEF void  fz_platform_free(void *ptr);
 
+// Virtual memory: reserve address range without backing it, then commit / decommit pages inside of it.
+// size and ptr for commit / decommit must be page aligned.
+fz_DEF void *fz_platform_reserve(size_t size);
+fz_DEF void  fz_platform_commit(void *ptr, size_t size);
+fz_DEF void  fz_platform_decommit(void *ptr, size_t size);
+fz_DEF void  fz_platform_release(void *ptr, size_t size);
+
+// Huge pages: backing memory for big arenas / pools, to cut down on TLB misses.
+// tries transparent huge pages (madvise MADV_HUGEPAGE, if THP isn't set to "never") first, then explicit ones (MAP_HUGETLB / MEM_LARGE_PAGES),
+// then falls back to normal pages. kind says which one was granted; whether the kernel actually backed the
+// memory with huge pages can be checked after touching it, see fz_platform_huge_resident.
+#define fz_HUGE_PAGE_SIZE (2 * fz_MB)
+
+enum fz_Page_Kind {
+    fz_PAGES_NORMAL,
+    fz_PAGES_HUGE_TRANSPARENT,
+    fz_PAGES_HUGE_EXPLICIT,
+};
+
+struct fz_Huge_Memory {
+    void        *memory;
+    size_t       size; // rounded up to fz_HUGE_PAGE_SIZE.
+    fz_Page_Kind kind;
+};
+
+fz_DEF fz_Huge_Memory fz_platform_alloc_huge(size_t size);
+fz_DEF void           fz_platform_free_huge(fz_Huge_Memory memory);
+// bytes of [memory, memory + size) that sit on huge pages right now. (size_t)-1 if the platform can't tell.
+fz_DEF size_t         fz_platform_huge_resident(void *memory, size_t size);
+
+/*
+ * ==================================================
+ * Threads.
+ * ==================================================
+ * */
+
+typedef void (*fz_Thread_Func)(void *user_data);
+
+struct fz_Thread {
+    uintptr_t handle;
+};
+
+fz_DEF fz_Thread fz_thread_create(fz_Thread_Func func, void *user_data);
+fz_DEF void      fz_thread_join(fz_Thread thread);
+fz_DEF int       fz_thread_hardware_count(void); // logical cores.
+fz_DEF void      fz_thread_yield(void);
+
+// counting semaphore, for parking idle threads.
+struct fz_Semaphore {
+    uintptr_t handle;
+};
+
+fz_DEF void fz_semaphore_init(fz_Semaphore *semaphore, uint32_t initial_count);
+fz_DEF void fz_semaphore_release(fz_Semaphore *semaphore);
+fz_DEF void fz_semaphore_wait(fz_Semaphore *semaphore);
+fz_DEF void fz_semaphore_signal(fz_Semaphore *semaphore, uint32_t count);
+
+/*
+ * ==================================================
+ * File Mapping.
+ * read-only view of a whole file, parse it in place instead of fread-ing it into a copy.
+ * when mapping fails (or isn't wanted, see fz_FILE_MAP_READ) the file is read into memory from
+ * the fallback allocator instead, an arena or the frame temp allocator usually; data looks the same either way.
+ *
+ *     fz_File_Map file;
+ *     if (fz_file_map(&file, "stage.bin", fz_FILE_MAP_SEQUENTIAL, fz_arena_allocator(&arena))) {
+ *         parse(file.data, file.size);
+ *         fz_file_unmap(&file);
+ *     }
+ * ==================================================
+ * */
+
+enum fz_File_Map_Flags {
+    fz_FILE_MAP_SEQUENTIAL = 1 << 0, // read front to back once: aggressive read-ahead, drop pages behind.
+    fz_FILE_MAP_RANDOM     = 1 << 1, // no read-ahead.
+    fz_FILE_MAP_WILLNEED   = 1 << 2, // start paging the whole file in right away.
+    fz_FILE_MAP_READ       = 1 << 3, // skip mapping, always read into the fallback allocator.
+};
+
+struct fz_File_Map {
+    const uint8_t *data;
+    size_t         size;
+    int            mapped;   // 0: data came from allocator.
+    fz_Allocator   allocator;
+};
+
+// returns 0 when the file can't be opened or read. an empty file succeeds with data NULL.
+// the fallback allocator may be nil_operation, then mapping is the only option.
+fz_DEF int  fz_file_map(fz_File_Map *file, const char *path, int flags, fz_Allocator fallback);
+fz_DEF void fz_file_unmap(fz_File_Map *file);
+
 inline fz_OPER_FUNC(fz_nil_operation) {
     fz_UNUSED(op);
     fz_UNUSED(ptr);
@@ -320,6 +648,19 @@ struct fz_Heap {
 fz_OPER_FUNC(fz_heap_operation);
 fz_DEF fz_Allocator fz_heap_allocator();
 
+/*
+ * Allocation guard: zero heap allocation in steady state.
+ * once enabled, every heap allocate / reallocate on this thread after warmup_frames of
+ * fz_alloc_guard_frame() is reported with its call site (see fz_TRACK_ALLOCATIONS), or asserts if fatal.
+ * everything on the heap funnels through fz_heap_operation, so fz_global_allocator and fz_heap_allocator() are both covered.
+ * */
+fz_DEF void     fz_alloc_guard_begin(uint64_t warmup_frames, int fatal);
+fz_DEF void     fz_alloc_guard_end(void);
+fz_DEF void     fz_alloc_guard_frame(void); // call once at the top of every frame.
+fz_DEF void     fz_alloc_guard_pause(void); // allowed region, e.g. loading a stage. nests.
+fz_DEF void     fz_alloc_guard_resume(void);
+fz_DEF uint64_t fz_alloc_guard_violations(void);
+
 /*
  * ==================================================
  * Arena Allocator.
@@ -328,8 +669,16 @@ fz_DEF fz_Allocator fz_heap_allocator();
 
 struct fz_Arena {
     uint8_t *memory;
-    size_t   capacity;
+    size_t   capacity; // for virtual arena, this is the committed size.
     size_t   used;
+
+    // Virtual arena only. zero otherwise.
+    size_t   reserved;
+    size_t   decommit_threshold; // committed memory above used + this gets decommitted on fz_end_temp. 0 to keep everything.
+
+    // Atomic arena only. zero otherwise.
+    size_t   chunk_size;
+    uint32_t generation; // changes on fz_end_temp, threads drop their cached chunks when it does.
 };
 
 struct fz_Temp_Memory {
@@ -337,14 +686,62 @@ struct fz_Temp_Memory {
     size_t used_before;
 };
 
+#ifndef fz_ARENA_COMMIT_GRANULARITY
+#define fz_ARENA_COMMIT_GRANULARITY (64 * fz_KB)
+#endif
+
 fz_DEF void fz_arena_init(fz_Arena *arena, void *backing_memory, size_t memory_size);
 
+// Reserves reserve_size of address space and commits it on demand, fz_ARENA_COMMIT_GRANULARITY at a time.
+// memory never moves, so pointers and the in-place realloc stays valid while it grows.
+fz_DEF void fz_arena_init_virtual(fz_Arena *arena, size_t reserve_size, size_t decommit_threshold);
+fz_DEF void fz_arena_release(fz_Arena *arena); // virtual arena only.
+
 fz_DEF fz_OPER_FUNC(fz_arena_operation);
 
 fz_DEF fz_Allocator   fz_arena_allocator(fz_Arena *arena);
 fz_DEF fz_Temp_Memory fz_begin_temp(fz_Arena *arena);
 fz_DEF void            fz_end_temp(fz_Temp_Memory scratch);
 
+/*
+ * Atomic arena: any number of threads allocate from it at once, without locks.
+ * each allocation is a single fetch-add on used; allocations up to chunk_size / 4 are carved out of
+ * a chunk_size block cached per thread, so workers don't keep bouncing the cache line holding used.
+ * reset it with fz_begin_temp / fz_end_temp once the workers are done, never while they are allocating.
+ * don't mix it with fz_arena_allocator on the same arena. release with fz_arena_release.
+ * */
+fz_DEF void fz_arena_init_atomic(fz_Arena *arena, size_t reserve_size, size_t chunk_size);
+
+fz_DEF fz_OPER_FUNC(fz_atomic_arena_operation);
+fz_DEF fz_Allocator fz_atomic_arena_allocator(fz_Arena *arena);
+
+/*
+ * ==================================================
+ * Scratch Arenas.
+ * every thread owns fz_SCRATCH_ARENA_COUNT arenas, lazily allocated on first use.
+ * usage:
+ *     fz_Temp_Memory scratch = fz_get_scratch(&arena_for_result, 1);
+ *     ... allocate temporaries from scratch.arena, result from arena_for_result ...
+ *     fz_release_scratch(scratch);
+ * ==================================================
+ * */
+
+#ifndef fz_SCRATCH_ARENA_COUNT
+#define fz_SCRATCH_ARENA_COUNT 2
+#endif
+
+#ifndef fz_SCRATCH_ARENA_SIZE
+#define fz_SCRATCH_ARENA_SIZE (64 * fz_MB) // reserved, not committed.
+#endif
+
+// Returns a temp block on one of the calling thread's scratch arenas that is not in conflicts.
+// pass the arenas that the caller is already allocating into (e.g. an arena passed down as a parameter).
+fz_DEF fz_Temp_Memory fz_get_scratch(fz_Arena **conflicts, int conflict_count);
+#define fz_release_scratch(scratch) fz_end_temp(scratch)
+
+// frees scratch memory of the calling thread. call it before a worker thread exits.
+fz_DEF void fz_scratch_thread_release(void);
+
 
 /*
  * ==================================================
@@ -378,29 +775,95 @@ fz_DEF fz_OPER_FUNC(fz_stack_operation);
  * ==================================================
  * */
 
-// TODO
 struct fz_SLL_Header {
     fz_SLL_Header *next;
 };
 
+enum {
+    fz_POOL_LAZY    = 1 << 0, // don't touch backing memory on init; hand out fresh elements with a bump pointer.
+    fz_POOL_NO_ZERO = 1 << 1, // don't zero elements on allocation. for types the caller fully initializes.
+};
+
 struct fz_Pool {
     uint8_t *base;
     size_t element_size;
     size_t memory_caps; // The total size of memory capacity. NOT the count of total usable chunk.
     fz_SLL_Header *free;
+
+    size_t bump;        // offset of the first element that was never handed out. memory_caps when not lazy.
+    int    flags;
 };
 
 fz_DEF void fz_pool_init(fz_Pool *pool, void *backing_memory, size_t memory_size, size_t element_size);
+fz_DEF void fz_pool_init_ex(fz_Pool *pool, void *backing_memory, size_t memory_size, size_t element_size, int flags);
 fz_DEF fz_Allocator fz_pool_allocator(fz_Pool *pool);
 
+// Batch versions. alloc_n returns how many elements were actually written into out (less than count when full).
+fz_DEF int  fz_pool_alloc_n(fz_Pool *pool, void **out, int count);
+fz_DEF void fz_pool_free_n(fz_Pool *pool, void **ptrs, int count);
+
 fz_DEF fz_OPER_FUNC(fz_pool_operation);
 
+/*
+ * ==================================================
+ * Slab (generational handles).
+ * elements live packed in a dense array, so iterating is a plain loop over fz_slab_at(slab, type, 0 .. count).
+ * removing moves the last element into the hole; anything that has to survive that holds a fz_Handle instead.
+ * a handle is [generation | slot index]; the slot records where its element currently is in the dense array.
+ * slots come from an fz_Pool and their generation changes on every remove, so a stale handle is an O(1) miss.
+ * usage:
+ *     Effect *e;
+ *     fz_Handle h = fz_slab_add(&slab, (void **)&e);
+ *     ...
+ *     if (Effect *e = (Effect *)fz_slab_get(&slab, h)) { still alive }
+ * ==================================================
+ * */
+
+typedef uint32_t fz_Handle; // 0 is never a valid handle.
+
+#ifndef fz_HANDLE_INDEX_BITS
+#define fz_HANDLE_INDEX_BITS 20 // rest is generation: 12 bits, one slot has to be reused 4095 times before a handle aliases.
+#endif
+#define fz_HANDLE_INDEX_MASK      ((1u << fz_HANDLE_INDEX_BITS) - 1)
+#define fz_HANDLE_GENERATION_MASK ((1u << (32 - fz_HANDLE_INDEX_BITS)) - 1)
+
+struct fz_Slab_Slot {
+    fz_SLL_Header pool_link;   // belongs to the pool while the slot is free.
+    uint32_t      dense_index;
+    uint32_t      generation;  // survives the pool free, see fz_POOL_NO_ZERO.
+};
+
+struct fz_Slab {
+    fz_Pool    slots;
+    uint8_t   *dense;
+    uint32_t  *dense_slots; // slot index of every dense element.
+    size_t     element_size;
+    int        count;
+    int        capacity;
+};
+
+// splits backing_memory into slots, dense elements and their back references.
+fz_DEF void      fz_slab_init(fz_Slab *slab, void *backing_memory, size_t memory_size, size_t element_size);
+// zeroed element. returns 0 (and out is NULL) when full.
+fz_DEF fz_Handle fz_slab_add(fz_Slab *slab, void **out);
+// NULL if the handle is stale.
+fz_DEF void     *fz_slab_get(fz_Slab *slab, fz_Handle handle);
+// 0 if the handle is stale.
+fz_DEF int       fz_slab_remove(fz_Slab *slab, fz_Handle handle);
+fz_DEF fz_Handle fz_slab_handle_at(fz_Slab *slab, int dense_index);
+fz_DEF void      fz_slab_clear(fz_Slab *slab);
+
+#define fz_slab_at(slab, type, dense_index) ((type *)((slab)->dense + (size_t)(dense_index) * (slab)->element_size))
+
 /*
  * ==================================================
  * FreeList Allocator.
  * ==================================================
  * */
 
+// Boundary tags: every block is [header | payload | footer], both header and footer hold the payload size.
+// lowest bit of size is set while the block is in use. free blocks thread fz_ListNode through header + payload.
+// looking at the footer right before a header, and the header right after a footer, finds both neighbours in O(1).
 struct fz_SizeHeader {
     size_t size;
 };
@@ -418,29 +881,289 @@ struct fz_Freelist {
     fz_ListNode sentinel;
 };
 
+struct fz_Freelist_Stats {
+    size_t free_bytes;
+    size_t free_blocks;
+    size_t largest_free;
+
+    // 1 - (largest_free / free_bytes). 0 means all free memory is one block.
+    float  fragmentation;
+};
+
 fz_DEF void fz_freelist_init(fz_Freelist *freelist, void *backing_memory, size_t memory_size);
 fz_DEF fz_Allocator fz_freelist_allocator(fz_Freelist *freelist);
+fz_DEF fz_Freelist_Stats fz_freelist_stats(fz_Freelist *freelist);
 
 fz_OPER_FUNC(fz_freelist_operation);
 
+/*
+ * ==================================================
+ * TLSF (Two-Level Segregated Fit) Allocator.
+ * constant time allocate / free for general purpose, long-lived allocations.
+ * first level splits sizes by power of two, second level splits each of them linearly into 16.
+ * a bitmap for each level finds a non-empty free list without walking.
+ * ==================================================
+ * */
+
+#define fz_TLSF_SL_COUNT_LOG2 4
+#define fz_TLSF_SL_COUNT      (1 << fz_TLSF_SL_COUNT_LOG2)
+#define fz_TLSF_ALIGN_LOG2    4 // 16 bytes.
+#define fz_TLSF_FL_SHIFT      (fz_TLSF_SL_COUNT_LOG2 + fz_TLSF_ALIGN_LOG2)
+#define fz_TLSF_FL_MAX        32 // blocks up to 4GB.
+#define fz_TLSF_FL_COUNT      (fz_TLSF_FL_MAX - fz_TLSF_FL_SHIFT + 1)
+#define fz_TLSF_SMALL_BLOCK   (1 << fz_TLSF_FL_SHIFT)
+
+// Physical neighbours are reached by prev_phys and by the size; free lists only use next_free / prev_free,
+// which live in the (unused) payload of a free block.
+struct fz_Tlsf_Block {
+    fz_Tlsf_Block *prev_phys;
+    size_t         size;      // payload size. lower bits are flags (free / previous block is free).
+
+    fz_Tlsf_Block *next_free;
+    fz_Tlsf_Block *prev_free;
+};
+
+struct fz_Tlsf {
+    void  *base;
+    size_t memory_caps;
+
+    uint32_t       fl_bitmap;
+    uint32_t       sl_bitmap[fz_TLSF_FL_COUNT];
+    fz_Tlsf_Block *blocks[fz_TLSF_FL_COUNT][fz_TLSF_SL_COUNT];
+};
+
+fz_DEF void fz_tlsf_init(fz_Tlsf *tlsf, void *backing_memory, size_t memory_size);
+fz_DEF fz_Allocator fz_tlsf_allocator(fz_Tlsf *tlsf);
+
+fz_OPER_FUNC(fz_tlsf_operation);
+
+/*
+ * ==================================================
+ * Buddy Allocator.
+ * for big, power-of-two-ish blocks: decoded textures, audio buffers.
+ * every block is min_block_size << level and sits at an offset that is a multiple of its own size,
+ * so a block's buddy is at offset ^ size. split and merge walk at most level_count levels.
+ * requests round up to the next power of two, so internal waste is bounded by half the block.
+ * per-block bookkeeping lives in a side table at the front of the backing memory, block memory itself is untouched
+ * while allocated and keeps min_block_size alignment.
+ * ==================================================
+ * */
+
+#ifndef fz_BUDDY_MAX_LEVELS
+#define fz_BUDDY_MAX_LEVELS 40
+#endif
+
+#define fz_BUDDY_FREE_FLAG 0x80
+
+struct fz_Buddy_Node {
+    fz_Buddy_Node *prev;
+    fz_Buddy_Node *next;
+};
+
+struct fz_Buddy {
+    uint8_t *base;           // aligned to min_block_size.
+    size_t   size;           // usable bytes, multiple of min_block_size.
+    size_t   min_block_size; // power of two, at least sizeof(fz_Buddy_Node).
+    int      level_count;
+    size_t   free_bytes;
+
+    uint8_t       *block_info; // per min block: level of the block starting there, | fz_BUDDY_FREE_FLAG when free.
+    fz_Buddy_Node *free_lists[fz_BUDDY_MAX_LEVELS];
+};
+
+fz_DEF void         fz_buddy_init(fz_Buddy *buddy, void *backing_memory, size_t memory_size, size_t min_block_size);
+fz_DEF fz_Allocator fz_buddy_allocator(fz_Buddy *buddy);
+fz_DEF size_t       fz_buddy_largest_free(fz_Buddy *buddy);
+
+fz_OPER_FUNC(fz_buddy_operation);
+
 /*
  * ==================================================
  * Ring Allocator.
  * ==================================================
  * */
 
+// Every allocation is prefixed with this header.
+// the lowest bit of size is used as a "released" flag; sizes are always multiple of fz_PUSH_ALIGNMENT.
+struct fz_Ring_Header {
+    size_t   size;  // size of the whole block, including header and padding.
+    uint64_t frame; // frame number this block was allocated in.
+};
+
 struct fz_Ring {
-    void *base; // Fixed position -- never changes.
+    uint8_t *base; // Fixed position -- never changes.
     size_t memory_size;
 
-    void *alloc;
-    void *free;
+    uint8_t *alloc; // head: next allocation goes here.
+    uint8_t *free;  // tail: oldest live allocation.
+    size_t   used;  // bytes between free and alloc, including the skipped bytes at the end when wrapping.
+
+    uint64_t frame; // stamped onto every new allocation.
 };
 
 fz_OPER_FUNC(fz_ring_operation);
-fz_DEF void fz_ring_init(fz_Ring *freelist, void *backing_memory, size_t memory_size);
+fz_DEF void fz_ring_init(fz_Ring *ring, void *backing_memory, size_t memory_size);
 fz_DEF fz_Allocator fz_ring_allocator(fz_Ring *ring);
 
+// Sets the frame number for subsequent allocations. frame should only go up.
+fz_DEF void fz_ring_begin_frame(fz_Ring *ring, uint64_t frame);
+
+// Releases every allocation made in (or before) the given frame, in FIFO order.
+fz_DEF void fz_ring_retire(fz_Ring *ring, uint64_t frame);
+
+/*
+ * ==================================================
+ * Tracking Allocator.
+ * wraps any allocator and records bytes in use, high-water mark and allocation counts,
+ * in total, per frame and per call site (fz_FILE_AND_LINE; needs fz_TRACK_ALLOCATIONS for call sites).
+ * every allocation gets a small header in front of it to remember its size and call site.
+ * ==================================================
+ * */
+
+#ifndef fz_TRACKER_MAX_SITES
+#define fz_TRACKER_MAX_SITES 256
+#endif
+
+struct fz_Tracker_Site {
+    const char *site;      // "(file:line)"
+
+    size_t   bytes_in_use;
+    size_t   live_count;
+    size_t   total_bytes;
+    uint64_t alloc_count;
+    uint64_t frame_alloc_count;
+};
+
+struct fz_Tracker_Header {
+    size_t size;
+    size_t site_index;
+};
+
+struct fz_Tracker {
+    fz_Allocator backing;
+    const char  *name;
+
+    size_t   bytes_in_use;
+    size_t   high_water;
+    uint64_t alloc_count;
+    uint64_t free_count;
+
+    uint64_t frame_alloc_count;
+    size_t   frame_bytes;
+    uint64_t last_frame_alloc_count; // finished frame; what you usually want to display.
+    size_t   last_frame_bytes;
+
+    fz_Map(int)     site_lookup; // site pointer -> index into sites. on the heap, sized for every site at init.
+    int             site_count;
+    fz_Tracker_Site sites[fz_TRACKER_MAX_SITES]; // sites[0] collects everything without a known site.
+};
+
+fz_DEF void         fz_tracker_init(fz_Tracker *tracker, fz_Allocator backing, const char *name);
+fz_DEF void         fz_tracker_release(fz_Tracker *tracker);
+fz_DEF fz_Allocator fz_tracker_allocator(fz_Tracker *tracker);
+fz_DEF void         fz_tracker_next_frame(fz_Tracker *tracker);
+
+// For backing allocators that drop memory wholesale (arena + fz_end_temp): forget everything in use.
+fz_DEF void         fz_tracker_reset_in_use(fz_Tracker *tracker);
+
+// Writes up to count sites with the most bytes in use into out, biggest first. returns how many.
+fz_DEF int          fz_tracker_top_sites(fz_Tracker *tracker, fz_Tracker_Site **out, int count);
+
+// Writes an uncompressed profile.proto file that `pprof` reads directly (alloc / inuse, objects / space).
+fz_DEF int          fz_tracker_dump_pprof(fz_Tracker *tracker, const char *path);
+
+fz_OPER_FUNC(fz_tracker_operation);
+
+/*
+ * ==================================================
+ * Job System.
+ * work stealing: every worker owns a Chase-Lev deque, pushes and pops at the bottom (LIFO, cache warm),
+ * idle workers steal from the top of somebody else's deque.
+ * jobs come from a fixed per-worker ring, nothing touches the heap after fz_jobs_init.
+ * a job is finished once its function returned and all of its children are finished;
+ * fz_job_wait runs other jobs while it waits instead of blocking.
+ * while a job runs, fz_global_temp_allocator points at a scratch arena of the running thread,
+ * everything allocated from it is gone when the job returns.
+ *
+ *     fz_Job *root = fz_job_create(0, 0, 0);
+ *     for (...) fz_job_run(fz_job_create(simulate, &batches[i], root));
+ *     fz_job_run(root);
+ *     fz_job_wait(root);
+ * ==================================================
+ * */
+
+#ifndef fz_JOB_MAX_WORKERS
+#define fz_JOB_MAX_WORKERS 64
+#endif
+
+#ifndef fz_JOB_CAPACITY
+#define fz_JOB_CAPACITY 4096 // per worker, power of two. also the maximum of jobs in flight per worker.
+#endif
+
+#define fz_JOB_PAYLOAD_SIZE 32
+
+struct fz_Job;
+typedef void (*fz_Job_Func)(fz_Job *job, void *user_data);
+
+// one cache line, so two workers never fight over neighbouring jobs.
+struct fz_Job {
+    fz_Job_Func       func;
+    void             *user_data; // points at payload for fz_job_create_copy.
+    fz_Job           *parent;
+    volatile uint32_t unfinished; // 1 for the job itself + 1 for every unfinished child.
+    uint32_t          worker;
+    uint8_t           payload[fz_JOB_PAYLOAD_SIZE];
+};
+
+struct fz_Job_Deque {
+    volatile uint64_t top;    // thieves CAS this.
+    uint8_t           padding[fz_CACHE_LINE_SIZE - sizeof(uint64_t)];
+    volatile uint64_t bottom; // only the owner writes this.
+    volatile uint64_t jobs[fz_JOB_CAPACITY]; // fz_Job pointers.
+};
+
+struct fz_Job_System;
+
+struct fz_Job_Worker {
+    fz_Job_Deque   deque;
+    fz_Job_System *system;
+    int            index;
+    uint32_t       job_next;
+    uint32_t       random;   // picks steal victims.
+    fz_Job        *jobs;     // fz_JOB_CAPACITY of them.
+};
+
+struct fz_Job_System {
+    int              worker_count; // worker 0 is the thread that called fz_jobs_init.
+    fz_Job_Worker   *workers;
+    fz_Thread        threads[fz_JOB_MAX_WORKERS];
+    fz_Semaphore     wake;
+    volatile uint32_t sleeping;
+    volatile uint32_t running;
+    fz_Allocator     allocator;
+};
+
+// thread_count < 0 spawns one thread per core, minus the calling thread. 0 runs everything on the calling thread.
+fz_DEF void    fz_jobs_init(fz_Job_System *system, int thread_count, fz_Allocator allocator);
+fz_DEF void    fz_jobs_shutdown(fz_Job_System *system);
+// index of the calling thread's worker, -1 when it isn't one.
+fz_DEF int     fz_jobs_worker_index(void);
+
+// func may be NULL: an empty job, handy as a parent to wait on. parent may be NULL.
+// only worker threads create and run jobs.
+fz_DEF fz_Job *fz_job_create(fz_Job_Func func, void *user_data, fz_Job *parent);
+// copies data into the job itself; user_data hands out the copy.
+fz_DEF fz_Job *fz_job_create_copy(fz_Job_Func func, const void *data, size_t size, fz_Job *parent);
+fz_DEF void    fz_job_run(fz_Job *job);
+fz_DEF int     fz_job_finished(fz_Job *job);
+// runs pending jobs until job is finished.
+fz_DEF void    fz_job_wait(fz_Job *job);
+
+typedef void (*fz_Job_Range_Func)(void *user_data, int begin, int end);
+
+// splits [0, count) into batches of batch_size, runs them over all workers and waits.
+fz_DEF void    fz_jobs_parallel_for(int count, int batch_size, fz_Job_Range_Func func, void *user_data);
+
 #else  // if !defined(fz_MINIMAL_FOOTPRINT) {...above block...} else
 
 fz_DEF void *xmalloc(size_t size);
@@ -458,6 +1181,8 @@ fz_DEF void *xcalloc(size_t size, size_t count);
  // Everything below is a C++ feature.
 
 #if defined(__cplusplus)
+#include <new> // placement new
+
 #if !defined(fz_MINIMAL_FOOTPRINT)
 struct fz_Temp_Block {
     fz_Temp_Memory tm;
@@ -466,42 +1191,530 @@ struct fz_Temp_Block {
         tm = fz_begin_temp(&arena);
     }
 
+    // takes over already started temp memory, e.g. fz_Temp_Block scratch(fz_get_scratch(0, 0));
+    fz_Temp_Block(fz_Temp_Memory memory) {
+        tm = memory;
+    }
+
+    fz_Allocator allocator() {
+        return fz_arena_allocator(tm.arena);
+    }
+
     ~fz_Temp_Block() {
         fz_end_temp(tm);
     }
 };
-#endif
+
+// fz_Map_Get: a copy of the slot, never a reference into the table.
+template<typename T>
+static inline T fz__map_get(const T *map, size_t index) {
+    return map[index];
+}
 
 /*
  * ==================================================
- * Scope Exit.
+ * Typed Vector.
+ * a handle over the same stretch buffer the Vec macros use, so C-style code keeps working on it.
  * usage:
- *     some initializtaion code here;
- *     fz_scopeexit { something... };
+ *     fz_Vector<Enemy_Chain> enemies(game->enemies);
+ *     Enemy_Chain &chain = enemies.emplace(); // constructed in place, no copy.
+ *     game->enemies = enemies.data;           // the buffer may have moved.
+ * it owns nothing: copying the handle copies the pointer, release() is VecRelease.
+ * when the buffer has to move, elements are moved rather than memcpy'd unless T is trivially copyable.
+ * on an arena, growing the last allocation (or shrinking) never moves the buffer.
  * ==================================================
  * */
 template<typename T>
-struct fz_ScopeExit {
-    T func;
-    fz_ScopeExit(T f): func(f) {}
-    ~fz_ScopeExit() { func(); }
-};
+struct fz_Vector {
+    T *data;
 
-struct fz_ScopeExit_Help {
-    template<typename G>
-    fz_ScopeExit<G> operator+(G func) { return func; }
-};
+    fz_Vector(): data(0) {}
+    fz_Vector(T *array): data(array) {}
+    explicit fz_Vector(int caps, fz_Allocator allocator = fz_global_allocator) {
+        data = (T *)fz__vec_create(sizeof(T), caps, allocator);
+    }
 
-#define fz_scopeexit auto fz_CONCAT(FZ_SCOPEEXIT_, __LINE__) = fz_ScopeExit_Help() + [&]
+    fz_Array_Header_Type *header() const { return fz_Vec_Header(data); }
 
-#endif
+    int length()   const { return data ? header()->used : 0; }
+    int capacity() const { return data ? header()->caps : 0; }
 
+    T &operator[](int index) { assert(0 <= index && index < length()); return data[index]; }
+    const T &operator[](int index) const { assert(0 <= index && index < length()); return data[index]; }
 
-#endif // FUZZY_MY_H
+    T *begin() { return data; }
+    T *end()   { return data + length(); }
+    T &last()  { assert(length() > 0); return data[length() - 1]; }
 
-/*
- * ==================================================
- * Implementations.
+    void reserve(int caps) {
+        if (!data) data = (T *)fz__vec_create(sizeof(T), 0, fz_global_allocator);
+        if (caps > header()->caps) set_capacity(caps);
+    }
+
+    template<typename... Args>
+    T &emplace(Args &&... args) {
+        grow_for(1);
+        T *slot = new (data + header()->used) T(static_cast<Args &&>(args)...);
+        header()->used++;
+        return *slot;
+    }
+
+    T &push(const T &object) { return emplace(object); }
+    T &push(T &&object)      { return emplace(static_cast<T &&>(object)); }
+
+    void append_n(const T *objects, int count) {
+        assert(count >= 0);
+        if (count == 0) return;
+        grow_for(count);
+
+        T *dest = data + header()->used;
+        if (__is_trivially_copyable(T)) {
+            memcpy((void *)dest, objects, sizeof(T) * count);
+        } else {
+            for (int i = 0; i < count; ++i) new (dest + i) T(objects[i]);
+        }
+        header()->used += count;
+    }
+
+    T pop() {
+        assert(length() > 0);
+        T *slot = data + --header()->used;
+        T result = static_cast<T &&>(*slot);
+        slot->~T();
+        return result;
+    }
+
+    void clear() {
+        if (!data) return;
+        for (int i = 0; i < header()->used; ++i) data[i].~T();
+        header()->used = 0;
+    }
+
+    void shrink_to_fit() {
+        if (data && header()->used < header()->caps) set_capacity(header()->used);
+    }
+
+    void release() {
+        if (!data) return;
+        clear();
+        fz__vec_release(header());
+        data = 0;
+    }
+
+    void grow_for(int count) {
+        int needed = length() + count;
+        if (needed <= capacity()) return;
+
+        int next_cap = capacity() ? capacity() : 1;
+        while(next_cap < needed) next_cap *= 2;
+        reserve(next_cap);
+    }
+
+    void set_capacity(int caps) {
+        fz_Array_Header_Type *old_header = header();
+        assert(caps >= old_header->used);
+
+        size_t old_size = sizeof(fz_Array_Header_Type) + (size_t)old_header->caps * sizeof(T);
+        size_t new_size = sizeof(fz_Array_Header_Type) + (size_t)caps * sizeof(T);
+
+        fz_Array_Header_Type *new_header;
+        if (__is_trivially_copyable(T) || fz__vec_resizes_in_place(old_header, old_size, new_size)) {
+            new_header = (fz_Array_Header_Type *)fz_realloc_ex(old_header->allocator, old_header, old_size, new_size);
+            assert(new_header);
+        } else {
+            new_header = (fz_Array_Header_Type *)fz_alloc_ex(old_header->allocator, new_size);
+            assert(new_header);
+            *new_header = *old_header;
+
+            T *from = (T *)(old_header + 1);
+            T *to   = (T *)(new_header + 1);
+            for (int i = 0; i < old_header->used; ++i) {
+                new (to + i) T(static_cast<T &&>(from[i]));
+                from[i].~T();
+            }
+            fz_free_ex(old_header->allocator, old_header);
+        }
+
+        new_header->caps = caps;
+        data = (T *)(new_header + 1);
+    }
+};
+
+/*
+ * ==================================================
+ * Sorting.
+ * the comparator / key extractor is a template parameter, so it inlines instead of going through qsort's function pointer.
+ * usage:
+ *     VecSortBy(effects, [](const Effect &a, const Effect &b) { return a.asset_id < b.asset_id; });
+ *     VecRadixSort(effects, [](const Effect &e) { return e.asset_id; }); // stable, key is int32_t or uint32_t.
+ * ==================================================
+ * */
+
+#ifndef fz_SORT_INSERTION_CUTOFF
+#define fz_SORT_INSERTION_CUTOFF 16
+#endif
+
+#ifndef fz_RADIX_SORT_CUTOFF
+#define fz_RADIX_SORT_CUTOFF 64 // below this histogramming costs more than it saves.
+#endif
+
+template<typename T>
+inline void fz__sort_swap(T &a, T &b) {
+    T temp = static_cast<T &&>(a);
+    a = static_cast<T &&>(b);
+    b = static_cast<T &&>(temp);
+}
+
+template<typename T, typename Less>
+inline void fz__insertion_sort(T *items, int count, Less &less) {
+    for (int i = 1; i < count; ++i) {
+        if (!less(items[i], items[i - 1])) continue;
+
+        T value = static_cast<T &&>(items[i]);
+        int j = i;
+        do {
+            items[j] = static_cast<T &&>(items[j - 1]);
+            --j;
+        } while (j > 0 && less(value, items[j - 1]));
+        items[j] = static_cast<T &&>(value);
+    }
+}
+
+template<typename T, typename Less>
+inline void fz__heap_sift_down(T *items, int root, int count, Less &less) {
+    for (;;) {
+        int child = root * 2 + 1;
+        if (child >= count) break;
+        if (child + 1 < count && less(items[child], items[child + 1])) child++;
+        if (!less(items[root], items[child])) break;
+
+        fz__sort_swap(items[root], items[child]);
+        root = child;
+    }
+}
+
+template<typename T, typename Less>
+void fz__heap_sort(T *items, int count, Less &less) {
+    for (int i = count / 2 - 1; i >= 0; --i) fz__heap_sift_down(items, i, count, less);
+    for (int end = count - 1; end > 0; --end) {
+        fz__sort_swap(items[0], items[end]);
+        fz__heap_sift_down(items, 0, end, less);
+    }
+}
+
+template<typename T, typename Less>
+void fz__intro_sort(T *items, int count, int depth, Less &less) {
+    while (count > fz_SORT_INSERTION_CUTOFF) {
+        if (depth-- == 0) {
+            fz__heap_sort(items, count, less);
+            return;
+        }
+
+        // median of three; the largest ends up last and stops the left scan.
+        int mid = count / 2;
+        if (less(items[mid], items[0]))         fz__sort_swap(items[mid], items[0]);
+        if (less(items[count - 1], items[mid])) fz__sort_swap(items[count - 1], items[mid]);
+        if (less(items[mid], items[0]))         fz__sort_swap(items[mid], items[0]);
+        fz__sort_swap(items[0], items[mid]); // pivot lives at 0 while partitioning.
+
+        int i = 0, j = count;
+        for (;;) {
+            do ++i; while (less(items[i], items[0]));
+            do --j; while (less(items[0], items[j]));
+            if (i >= j) break;
+            fz__sort_swap(items[i], items[j]);
+        }
+        fz__sort_swap(items[0], items[j]);
+
+        // recurse into the smaller half, loop on the larger one.
+        int left_count  = j;
+        int right_count = count - j - 1;
+        if (left_count < right_count) {
+            fz__intro_sort(items, left_count, depth, less);
+            items += j + 1;
+            count  = right_count;
+        } else {
+            fz__intro_sort(items + j + 1, right_count, depth, less);
+            count = left_count;
+        }
+    }
+
+    fz__insertion_sort(items, count, less);
+}
+
+template<typename T, typename Less>
+void fz_sort(T *items, int count, Less less) {
+    if (count < 2) return;
+    int depth = 2 * (31 - fz_clz32((uint32_t)count));
+    fz__intro_sort(items, count, depth, less);
+}
+
+inline uint32_t fz__radix_bits(uint32_t key) { return key; }
+inline uint32_t fz__radix_bits(int32_t key)  { return (uint32_t)key ^ 0x80000000u; } // negatives sort first.
+
+// LSD radix sort, 8 bits per pass; passes where every key shares the digit are skipped.
+// the ping-pong buffer comes from a scratch arena.
+template<typename T, typename Key>
+void fz_radix_sort(T *items, int count, Key key) {
+    static_assert(__is_trivially_copyable(T), "fz_radix_sort moves elements with memcpy.");
+    if (count < 2) return;
+
+    if (count < fz_RADIX_SORT_CUTOFF) {
+        auto less = [&key](const T &a, const T &b) { return fz__radix_bits(key(a)) < fz__radix_bits(key(b)); };
+        fz__insertion_sort(items, count, less);
+        return;
+    }
+
+    uint32_t histogram[4][256];
+    memset(histogram, 0, sizeof(histogram));
+    for (int i = 0; i < count; ++i) {
+        uint32_t bits = fz__radix_bits(key(items[i]));
+        histogram[0][(bits      ) & 0xff]++;
+        histogram[1][(bits >>  8) & 0xff]++;
+        histogram[2][(bits >> 16) & 0xff]++;
+        histogram[3][(bits >> 24)       ]++;
+    }
+
+    fz_Temp_Block scratch(fz_get_scratch(0, 0));
+    T *buffer = (T *)fz_alloc_ex(scratch.allocator(), sizeof(T) * count);
+    T *from = items;
+    T *to   = buffer;
+
+    for (int pass = 0; pass < 4; ++pass) {
+        uint32_t *counts = histogram[pass];
+        uint32_t shift   = pass * 8;
+        if (counts[(fz__radix_bits(key(from[0])) >> shift) & 0xff] == (uint32_t)count) continue;
+
+        uint32_t offset = 0;
+        for (int digit = 0; digit < 256; ++digit) {
+            uint32_t c = counts[digit];
+            counts[digit] = offset;
+            offset += c;
+        }
+
+        for (int i = 0; i < count; ++i) {
+            uint32_t digit = (fz__radix_bits(key(from[i])) >> shift) & 0xff;
+            memcpy((void *)&to[counts[digit]++], &from[i], sizeof(T));
+        }
+
+        T *temp = from; from = to; to = temp;
+    }
+
+    if (from != items) memcpy((void *)items, from, sizeof(T) * count);
+}
+
+#define fz_Vec_SortBy(array, less)   fz_sort((array), (int)fz_Vec_Length(array), (less))
+#define fz_Vec_RadixSort(array, key) fz_radix_sort((array), (int)fz_Vec_Length(array), (key))
+
+#if !defined(fz_STRETCH_BUFFER_NO_SHORTHAND)
+#define VecSortBy    fz_Vec_SortBy
+#define VecRadixSort fz_Vec_RadixSort
+#endif
+#endif
+
+/*
+ * ==================================================
+ * Ring Buffer.
+ * fixed capacity N (power of two) FIFO, indices run freely and get masked.
+ *     fz_RingBuf<T, N>                  single thread.
+ *     fz_RingBuf<T, N, fz_RING_SPSC>    one producer thread, one consumer thread. wait-free.
+ *     fz_RingBuf<T, N, fz_RING_MPMC>    any number of both. lock-free, bounded (Vyukov's sequence numbers).
+ * push returns false when full, pop returns false when empty; nothing ever blocks.
+ * the concurrent flavours want to live in static or heap memory, they are N * sizeof(T) plus a few cache lines.
+ * ==================================================
+ * */
+
+enum fz_Ring_Flavour {
+    fz_RING_SINGLE,
+    fz_RING_SPSC,
+    fz_RING_MPMC,
+};
+
+template<typename T, uint32_t N, int Flavour = fz_RING_SINGLE>
+struct fz_RingBuf;
+
+template<typename T, uint32_t N>
+struct fz_RingBuf<T, N, fz_RING_SINGLE> {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "fz_RingBuf capacity must be a power of two.");
+    enum { MASK = N - 1 };
+
+    uint32_t head; // next pop.
+    uint32_t tail; // next push.
+    T        items[N];
+
+    fz_RingBuf(): head(0), tail(0) {}
+
+    uint32_t count()    const { return tail - head; }
+    uint32_t capacity() const { return N; }
+    bool     empty()    const { return tail == head; }
+    bool     full()     const { return tail - head == N; }
+
+    bool push(const T &item) {
+        if (full()) return false;
+        items[tail++ & MASK] = item;
+        return true;
+    }
+
+    // drops the oldest item when full, e.g. for log records.
+    void push_overwrite(const T &item) {
+        if (full()) head++;
+        items[tail++ & MASK] = item;
+    }
+
+    bool pop(T *out) {
+        if (empty()) return false;
+        *out = items[head++ & MASK];
+        return true;
+    }
+
+    // 0 is the oldest.
+    T &operator[](uint32_t index) { assert(index < count()); return items[(head + index) & MASK]; }
+};
+
+template<typename T, uint32_t N>
+struct fz_RingBuf<T, N, fz_RING_SPSC> {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "fz_RingBuf capacity must be a power of two.");
+    enum { MASK = N - 1 };
+
+    // each side owns a cache line; the cached copy of the other side's index saves
+    // touching the other line until the ring looks full (or empty).
+    alignas(fz_CACHE_LINE_SIZE) volatile uint32_t tail;
+    uint32_t cached_head;
+
+    alignas(fz_CACHE_LINE_SIZE) volatile uint32_t head;
+    uint32_t cached_tail;
+
+    alignas(fz_CACHE_LINE_SIZE) T items[N];
+
+    fz_RingBuf(): tail(0), cached_head(0), head(0), cached_tail(0) {}
+
+    // only exact when both sides are idle.
+    uint32_t count()    const { return fz_atomic_load32((volatile uint32_t *)&tail) - fz_atomic_load32((volatile uint32_t *)&head); }
+    uint32_t capacity() const { return N; }
+
+    // producer thread only.
+    bool push(const T &item) {
+        uint32_t t = tail;
+        if (t - cached_head == N) {
+            cached_head = fz_atomic_load32(&head);
+            if (t - cached_head == N) return false;
+        }
+        items[t & MASK] = item;
+        fz_atomic_store32(&tail, t + 1);
+        return true;
+    }
+
+    // consumer thread only.
+    bool pop(T *out) {
+        uint32_t h = head;
+        if (h == cached_tail) {
+            cached_tail = fz_atomic_load32(&tail);
+            if (h == cached_tail) return false;
+        }
+        *out = items[h & MASK];
+        fz_atomic_store32(&head, h + 1);
+        return true;
+    }
+};
+
+template<typename T, uint32_t N>
+struct fz_RingBuf<T, N, fz_RING_MPMC> {
+    static_assert(N > 1 && (N & (N - 1)) == 0, "fz_RingBuf capacity must be a power of two.");
+    enum { MASK = N - 1 };
+
+    // a cell is free for the push at position p when sequence == p, and full for the pop at p when sequence == p + 1.
+    struct Cell {
+        volatile uint32_t sequence;
+        T                 item;
+    };
+
+    alignas(fz_CACHE_LINE_SIZE) volatile uint32_t push_position;
+    alignas(fz_CACHE_LINE_SIZE) volatile uint32_t pop_position;
+    alignas(fz_CACHE_LINE_SIZE) Cell cells[N];
+
+    fz_RingBuf(): push_position(0), pop_position(0) {
+        for (uint32_t i = 0; i < N; ++i) cells[i].sequence = i;
+    }
+
+    // only exact when every thread is idle.
+    uint32_t count()    const { return fz_atomic_load32((volatile uint32_t *)&push_position) - fz_atomic_load32((volatile uint32_t *)&pop_position); }
+    uint32_t capacity() const { return N; }
+
+    bool push(const T &item) {
+        uint32_t position = fz_atomic_load32(&push_position);
+        Cell *cell;
+        for (;;) {
+            cell = &cells[position & MASK];
+            int32_t difference = (int32_t)(fz_atomic_load32(&cell->sequence) - position);
+            if (difference == 0) {
+                uint32_t seen = fz_atomic_cas32(&push_position, position, position + 1);
+                if (seen == position) break;
+                position = seen;
+            } else if (difference < 0) {
+                return false; // full.
+            } else {
+                position = fz_atomic_load32(&push_position);
+            }
+        }
+
+        cell->item = item;
+        fz_atomic_store32(&cell->sequence, position + 1);
+        return true;
+    }
+
+    bool pop(T *out) {
+        uint32_t position = fz_atomic_load32(&pop_position);
+        Cell *cell;
+        for (;;) {
+            cell = &cells[position & MASK];
+            int32_t difference = (int32_t)(fz_atomic_load32(&cell->sequence) - (position + 1));
+            if (difference == 0) {
+                uint32_t seen = fz_atomic_cas32(&pop_position, position, position + 1);
+                if (seen == position) break;
+                position = seen;
+            } else if (difference < 0) {
+                return false; // empty.
+            } else {
+                position = fz_atomic_load32(&pop_position);
+            }
+        }
+
+        *out = cell->item;
+        fz_atomic_store32(&cell->sequence, position + N);
+        return true;
+    }
+};
+
+/*
+ * ==================================================
+ * Scope Exit.
+ * usage:
+ *     some initializtaion code here;
+ *     fz_scopeexit { something... };
+ * ==================================================
+ * */
+template<typename T>
+struct fz_ScopeExit {
+    T func;
+    fz_ScopeExit(T f): func(f) {}
+    ~fz_ScopeExit() { func(); }
+};
+
+struct fz_ScopeExit_Help {
+    template<typename G>
+    fz_ScopeExit<G> operator+(G func) { return func; }
+};
+
+#define fz_scopeexit auto fz_CONCAT(FZ_SCOPEEXIT_, __LINE__) = fz_ScopeExit_Help() + [&]
+
+#endif
+
+
+#endif // FUZZY_MY_H
+
+/*
+ * ==================================================
+ * Implementations.
  * ==================================================
  * */
 
@@ -515,7 +1728,8 @@ extern "C" {
 #if !defined(fz_MINIMAL_FOOTPRINT)
 
 fz_Allocator fz_global_allocator = { 0, fz_heap_operation };
-fz_Allocator fz_global_temp_allocator = { 0, fz_nil_operation };
+fz_THREAD_LOCAL fz_Allocator fz_global_temp_allocator = { 0, fz_nil_operation };
+fz_THREAD_LOCAL const char *fz_alloc_site = 0;
 
 fz_Allocator fz_set_allocator(fz_Allocator new_allocator) {
     fz_Allocator old = fz_global_allocator;
@@ -562,248 +1776,2427 @@ void fz_platform_free(void *ptr) {
     free(ptr);
 }
 
-fz_OPER_FUNC(fz_heap_operation) {
-    switch(op) {
-        case fz_MEMORY_OPER_ALLOCATE:
-            return fz_platform_alloc(size);
+#if defined(fz_OS_WINDOWS)
+#if !defined(fz_WIN_H_INCLUDED)
+// windows.h is not around (see fz_NO_WINDOWS_H); declare the bits we need.
+extern __declspec(dllimport) void *__stdcall VirtualAlloc(void *address, size_t size, unsigned long type, unsigned long protect);
+extern __declspec(dllimport) int   __stdcall VirtualFree(void *address, size_t size, unsigned long type);
+#define MEM_COMMIT     0x00001000
+#define MEM_RESERVE    0x00002000
+#define MEM_DECOMMIT   0x00004000
+#define MEM_RELEASE    0x00008000
+#define PAGE_NOACCESS  0x01
+#define PAGE_READWRITE 0x04
+#define MEM_LARGE_PAGES 0x20000000
+extern __declspec(dllimport) size_t __stdcall GetLargePageMinimum(void);
+#endif
 
-        case fz_MEMORY_OPER_FREE:
-            fz_platform_free(ptr); return NULL;
+void *fz_platform_reserve(size_t size) {
+    void *result = VirtualAlloc(0, size, MEM_RESERVE, PAGE_NOACCESS);
+    assert(result && "Failed to reserve memory.");
+    return result;
+}
 
-        case fz_MEMORY_OPER_REALLOCATE:
-            return fz_platform_realloc(ptr, size);
+void fz_platform_commit(void *ptr, size_t size) {
+    void *result = VirtualAlloc(ptr, size, MEM_COMMIT, PAGE_READWRITE);
+    assert(result && "Failed to commit memory.");
+    fz_UNUSED(result);
+}
+
+void fz_platform_decommit(void *ptr, size_t size) {
+    VirtualFree(ptr, size, MEM_DECOMMIT);
+}
+
+void fz_platform_release(void *ptr, size_t size) {
+    fz_UNUSED(size);
+    VirtualFree(ptr, 0, MEM_RELEASE);
+}
+
+// NOTE(fuzzy): windows has no transparent huge pages. large pages need SeLockMemoryPrivilege,
+// so without it this quietly ends up with normal pages.
+fz_Huge_Memory fz_platform_alloc_huge(size_t size) {
+    fz_Huge_Memory result;
+    result.size   = fz_align_to_power_of_two(size, fz_HUGE_PAGE_SIZE);
+    result.kind   = fz_PAGES_NORMAL;
+    result.memory = NULL;
+
+    size_t large_page = GetLargePageMinimum();
+    if (large_page && (result.size % large_page) == 0) {
+        result.memory = VirtualAlloc(0, result.size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+        if (result.memory) result.kind = fz_PAGES_HUGE_EXPLICIT;
     }
-    return NULL;
+
+    if (!result.memory) {
+        result.memory = VirtualAlloc(0, result.size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+        assert(result.memory && "Failed to allocate memory.");
+    }
+    return result;
 }
 
-fz_Allocator fz_heap_allocator() {
-    fz_Allocator allocator = {0};
-    allocator.oper_func = fz_heap_operation;
+void fz_platform_free_huge(fz_Huge_Memory memory) {
+    VirtualFree(memory.memory, 0, MEM_RELEASE);
+}
 
-    return allocator;
+size_t fz_platform_huge_resident(void *memory, size_t size) {
+    fz_UNUSED(memory);
+    fz_UNUSED(size);
+    return (size_t)-1;
 }
 
-/*
- * ==================================================
- * Stretch Buffer (vector).
- * basically the same as stb_ds.h (https://github.com/nothings/stb/blob/master/stb_ds.h)
- * ==================================================
- * */
+#else
+#include <sys/mman.h>
 
-/*
- * Couple things to note:
- * @param output -- this points to a beginning of an array, AFTER the header.
- * @param header -- this points to a beginning of a header, which should equal to (output - sizeof(fz_Array_Header_Type)).
- * */
-int fz__vec_grow(void **output, fz_Array_Header_Type *header, size_t element_size, size_t grow_count) {
-    assert(header);
-    assert(output);
-    assert((*output) == (header + 1));
-    if (header->caps == 0) header->caps = 1;
+void *fz_platform_reserve(size_t size) {
+    void *result = mmap(0, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    assert(result != MAP_FAILED && "Failed to reserve memory.");
+    return result;
+}
 
-    int next_cap    = header->caps;
-    int next_length = header->used + grow_count;
+void fz_platform_commit(void *ptr, size_t size) {
+    int result = mprotect(ptr, size, PROT_READ | PROT_WRITE);
+    assert(result == 0 && "Failed to commit memory.");
+    fz_UNUSED(result);
+}
 
-    while(next_cap <= next_length) next_cap *= 2;
-    size_t old_size = (size_t) header->caps * element_size;
-    size_t new_size = (size_t) next_cap     * element_size;
+void fz_platform_decommit(void *ptr, size_t size) {
+    madvise(ptr, size, MADV_DONTNEED);
+    mprotect(ptr, size, PROT_NONE);
+}
 
-    fz_Array_Header_Type *new_array = (fz_Array_Header_Type *)fz_realloc_ex(header->allocator, header, old_size, new_size);
-    assert(new_array);
+void fz_platform_release(void *ptr, size_t size) {
+    munmap(ptr, size);
+}
 
-    new_array->caps = next_cap;
-    *output = (void *)(new_array + 1);
-    return 1;
+#if defined(MADV_HUGEPAGE)
+// madvise(MADV_HUGEPAGE) succeeds even with THP set to "never", so ask the kernel what it is set to.
+// "always [madvise] never": the bracketed one is current. no file, THP isn't built in.
+static int fz__transparent_huge_pages_enabled(void) {
+    FILE *file = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+    if (!file) return 0;
+
+    char line[128];
+    int enabled = 0;
+    if (fgets(line, sizeof(line), file)) {
+        enabled = strstr(line, "[always]") != NULL || strstr(line, "[madvise]") != NULL;
+    }
+
+    fclose(file);
+    return enabled;
 }
+#endif
 
-void *
-fz__vec_create(size_t entry_type_size, size_t capacity, fz_Allocator allocator) {
-    fz_Array_Header_Type *result = (fz_Array_Header_Type *)fz_alloc_ex(allocator, sizeof(fz_Array_Header_Type) + (entry_type_size * capacity));
+fz_Huge_Memory fz_platform_alloc_huge(size_t size) {
+    fz_Huge_Memory result;
+    result.size   = fz_align_to_power_of_two(size, fz_HUGE_PAGE_SIZE);
+    result.kind   = fz_PAGES_NORMAL;
+    result.memory = NULL;
+
+#if defined(MADV_HUGEPAGE)
+    if (fz__transparent_huge_pages_enabled()) {
+        // transparent huge pages only cover 2MB aligned ranges, so over-map and trim both ends.
+        size_t padded = result.size + fz_HUGE_PAGE_SIZE;
+        uint8_t *raw = (uint8_t *)mmap(0, padded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw != MAP_FAILED) {
+            uint8_t *aligned = (uint8_t *)fz_align_to_power_of_two((uintptr_t)raw, fz_HUGE_PAGE_SIZE);
+            if (aligned != raw) munmap(raw, aligned - raw);
+            if (aligned + result.size != raw + padded) munmap(aligned + result.size, (raw + padded) - (aligned + result.size));
+
+            if (madvise(aligned, result.size, MADV_HUGEPAGE) == 0) {
+                result.memory = aligned;
+                result.kind   = fz_PAGES_HUGE_TRANSPARENT;
+                return result;
+            }
+            munmap(aligned, result.size);
+        }
+    }
+#endif
 
-    result->allocator = allocator;
-    result->used      = 0;
-    result->caps      = capacity;
+#if defined(MAP_HUGETLB)
+    {
+        // only works if the admin reserved pages, e.g. vm.nr_hugepages.
+        void *explicit_pages = mmap(0, result.size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (explicit_pages != MAP_FAILED) {
+            result.memory = explicit_pages;
+            result.kind   = fz_PAGES_HUGE_EXPLICIT;
+            return result;
+        }
+    }
+#endif
 
-    return (void *)(result + 1);
+    result.memory = mmap(0, result.size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    assert(result.memory != MAP_FAILED && "Failed to allocate memory.");
+    return result;
 }
 
-void fz__vec_release(fz_Array_Header_Type *array_header) {
-    assert(array_header);
-    fz_free_ex(array_header->allocator, array_header);
+void fz_platform_free_huge(fz_Huge_Memory memory) {
+    munmap(memory.memory, memory.size);
 }
 
-void fz__vec_sort(fz_Vec(void) array, size_t elem_size, fz_COMPARATOR_FUNC comparator_func) {
-    qsort(array, fz_Vec_Length(array), elem_size, comparator_func);
+size_t fz_platform_huge_resident(void *memory, size_t size) {
+#if defined(fz_OS_LINUX)
+    // walk /proc/self/smaps and add up the huge page counters of every mapping overlapping the range.
+    FILE *smaps = fopen("/proc/self/smaps", "r");
+    if (!smaps) return (size_t)-1;
+
+    uintptr_t begin = (uintptr_t)memory;
+    uintptr_t end   = begin + size;
+    int overlapping = 0;
+    size_t result   = 0;
+
+    char line[512];
+    while (fgets(line, sizeof(line), smaps)) {
+        unsigned long long map_begin, map_end, kilobytes;
+        if (sscanf(line, "%llx-%llx ", &map_begin, &map_end) == 2) {
+            overlapping = (map_begin < end) && (begin < map_end);
+        } else if (overlapping &&
+                   (sscanf(line, "AnonHugePages: %llu kB", &kilobytes) == 1 ||
+                    sscanf(line, "Private_Hugetlb: %llu kB", &kilobytes) == 1)) {
+            result += (size_t)kilobytes * fz_KB;
+        }
+    }
+
+    fclose(smaps);
+    // neighbouring anonymous mappings can get merged into the same one, don't report more than asked for.
+    return result < size ? result : size;
+#else
+    fz_UNUSED(memory);
+    fz_UNUSED(size);
+    return (size_t)-1;
+#endif
 }
+#endif
 
 /*
  * ==================================================
- * Arena Allocator.
+ * Threads.
  * ==================================================
  * */
 
-#ifndef fz_PUSH_ALIGNMENT
-#define fz_PUSH_ALIGNMENT 16
+// func and user_data ride along to the new thread in here; the thread frees it.
+struct fz__Thread_Start {
+    fz_Thread_Func func;
+    void          *user_data;
+};
+
+#if defined(fz_OS_WINDOWS)
+#if !defined(fz_WIN_H_INCLUDED)
+extern __declspec(dllimport) void         *__stdcall CreateThread(void *attributes, size_t stack_size, unsigned long (__stdcall *start)(void *), void *parameter, unsigned long flags, unsigned long *thread_id);
+extern __declspec(dllimport) unsigned long __stdcall WaitForSingleObject(void *handle, unsigned long milliseconds);
+extern __declspec(dllimport) int           __stdcall CloseHandle(void *handle);
+extern __declspec(dllimport) unsigned long __stdcall GetActiveProcessorCount(unsigned short group);
+extern __declspec(dllimport) int           __stdcall SwitchToThread(void);
+extern __declspec(dllimport) void         *__stdcall CreateSemaphoreA(void *attributes, long initial_count, long maximum_count, const char *name);
+extern __declspec(dllimport) int           __stdcall ReleaseSemaphore(void *semaphore, long release_count, long *previous_count);
+#define INFINITE 0xFFFFFFFF
 #endif
 
-void fz_arena_init(fz_Arena *arena, void *backing_memory, size_t memory_size) {
-    if (arena && backing_memory) {
-        arena->capacity = memory_size;
-        arena->used     = 0;
-        arena->memory   = (uint8_t *)backing_memory;
-        arena->capacity = memory_size;
-    }
+static unsigned long __stdcall fz__thread_entry(void *parameter) {
+    fz__Thread_Start start = *(fz__Thread_Start *)parameter;
+    fz_platform_free(parameter);
+    start.func(start.user_data);
+    return 0;
 }
 
-fz_OPER_FUNC(fz_arena_operation) {
-    fz_Arena *arena = (fz_Arena *)user_data;
+fz_Thread fz_thread_create(fz_Thread_Func func, void *user_data) {
+    fz__Thread_Start *start = (fz__Thread_Start *)fz_platform_alloc(sizeof(fz__Thread_Start));
+    start->func      = func;
+    start->user_data = user_data;
 
-    int reallocating = 0;
-    switch(op) {
-        case fz_MEMORY_OPER_REALLOCATE:
-            assert(arena->memory < ptr && ptr < (arena->memory + arena->capacity));
-            reallocating = 1;
-        /*
-         * fallthrough.
-         *  reallocate and allocate does the same thing, since it's cannot be freed
-         */
+    fz_Thread result;
+    result.handle = (uintptr_t)CreateThread(0, 0, fz__thread_entry, start, 0, 0);
+    assert(result.handle && "Failed to create a thread.");
+    return result;
+}
 
-        case fz_MEMORY_OPER_ALLOCATE:
-        {
-            if (size < fz_PUSH_ALIGNMENT) size = fz_PUSH_ALIGNMENT;
+void fz_thread_join(fz_Thread thread) {
+    WaitForSingleObject((void *)thread.handle, INFINITE);
+    CloseHandle((void *)thread.handle);
+}
 
-            if (reallocating) {
-                assert(old_size <= arena->used);
+int fz_thread_hardware_count(void) {
+    return (int)GetActiveProcessorCount(0xffff); // ALL_PROCESSOR_GROUPS
+}
 
-                if (ptr == (arena->memory + (arena->used - old_size))) { // ptr is the last allocation point and can be simply extended.
-                    // NOTE(fuzzy): I don't know why you would want to do that, but you can realloc memory to a smaller size.
-                    // in that case do nothing.
-                    if (old_size < size) {
-                        size_t size_difference = size - old_size;
-                        uintptr_t aligned_size = fz_align_to_power_of_two(size_difference, fz_PUSH_ALIGNMENT);
-                        arena->used += aligned_size;
-                    }
-                    return ptr;
+void fz_thread_yield(void) {
+    SwitchToThread();
+}
+
+void fz_semaphore_init(fz_Semaphore *semaphore, uint32_t initial_count) {
+    semaphore->handle = (uintptr_t)CreateSemaphoreA(0, (long)initial_count, 0x7fffffff, 0);
+    assert(semaphore->handle && "Failed to create a semaphore.");
+}
+
+void fz_semaphore_release(fz_Semaphore *semaphore) {
+    CloseHandle((void *)semaphore->handle);
+    semaphore->handle = 0;
+}
+
+void fz_semaphore_wait(fz_Semaphore *semaphore) {
+    WaitForSingleObject((void *)semaphore->handle, INFINITE);
+}
+
+void fz_semaphore_signal(fz_Semaphore *semaphore, uint32_t count) {
+    ReleaseSemaphore((void *)semaphore->handle, (long)count, 0);
+}
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <unistd.h>
+
+static void *fz__thread_entry(void *parameter) {
+    fz__Thread_Start start = *(fz__Thread_Start *)parameter;
+    fz_platform_free(parameter);
+    start.func(start.user_data);
+    return NULL;
+}
+
+fz_Thread fz_thread_create(fz_Thread_Func func, void *user_data) {
+    fz__Thread_Start *start = (fz__Thread_Start *)fz_platform_alloc(sizeof(fz__Thread_Start));
+    start->func      = func;
+    start->user_data = user_data;
+
+    pthread_t thread;
+    int failed = pthread_create(&thread, NULL, fz__thread_entry, start);
+    assert(!failed && "Failed to create a thread.");
+    fz_UNUSED(failed);
+
+    fz_Thread result;
+    result.handle = (uintptr_t)thread;
+    return result;
+}
+
+void fz_thread_join(fz_Thread thread) {
+    pthread_join((pthread_t)thread.handle, NULL);
+}
+
+int fz_thread_hardware_count(void) {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+}
+
+void fz_thread_yield(void) {
+    sched_yield();
+}
+
+void fz_semaphore_init(fz_Semaphore *semaphore, uint32_t initial_count) {
+    sem_t *sem = (sem_t *)fz_platform_alloc(sizeof(sem_t));
+    int failed = sem_init(sem, 0, initial_count);
+    assert(!failed && "Failed to create a semaphore.");
+    fz_UNUSED(failed);
+    semaphore->handle = (uintptr_t)sem;
+}
+
+void fz_semaphore_release(fz_Semaphore *semaphore) {
+    sem_destroy((sem_t *)semaphore->handle);
+    fz_platform_free((void *)semaphore->handle);
+    semaphore->handle = 0;
+}
+
+void fz_semaphore_wait(fz_Semaphore *semaphore) {
+    while (sem_wait((sem_t *)semaphore->handle) != 0) {
+        // EINTR, try again.
+    }
+}
+
+void fz_semaphore_signal(fz_Semaphore *semaphore, uint32_t count) {
+    for (uint32_t i = 0; i < count; ++i) {
+        sem_post((sem_t *)semaphore->handle);
+    }
+}
+#endif
+
+/*
+ * ==================================================
+ * File Mapping.
+ * ==================================================
+ * */
+
+#if defined(fz_OS_WINDOWS)
+#if !defined(fz_WIN_H_INCLUDED)
+extern __declspec(dllimport) void         *__stdcall CreateFileA(const char *name, unsigned long access, unsigned long share, void *security, unsigned long disposition, unsigned long flags, void *template_file);
+extern __declspec(dllimport) unsigned long __stdcall GetFileSize(void *file, unsigned long *size_high);
+extern __declspec(dllimport) void         *__stdcall CreateFileMappingA(void *file, void *security, unsigned long protect, unsigned long size_high, unsigned long size_low, const char *name);
+extern __declspec(dllimport) void         *__stdcall MapViewOfFile(void *mapping, unsigned long access, unsigned long offset_high, unsigned long offset_low, size_t size);
+extern __declspec(dllimport) int           __stdcall UnmapViewOfFile(const void *address);
+extern __declspec(dllimport) int           __stdcall ReadFile(void *file, void *buffer, unsigned long size, unsigned long *read, void *overlapped);
+#define GENERIC_READ              0x80000000
+#define FILE_SHARE_READ           0x00000001
+#define OPEN_EXISTING             3
+#define FILE_ATTRIBUTE_NORMAL     0x00000080
+#define FILE_FLAG_SEQUENTIAL_SCAN 0x08000000
+#define FILE_FLAG_RANDOM_ACCESS   0x10000000
+#define PAGE_READONLY             0x02
+#define FILE_MAP_READ             0x0004
+#define INVALID_HANDLE_VALUE      ((void *)(intptr_t)-1)
+#endif
+
+// NOTE(fuzzy): fz_FILE_MAP_WILLNEED is ignored here; PrefetchVirtualMemory would do it, but needs windows 8 headers.
+int fz_file_map(fz_File_Map *file, const char *path, int flags, fz_Allocator fallback) {
+    memset(file, 0, sizeof(*file));
+    file->allocator = fallback;
+
+    unsigned long hint = FILE_ATTRIBUTE_NORMAL;
+    if (flags & fz_FILE_MAP_SEQUENTIAL) hint |= FILE_FLAG_SEQUENTIAL_SCAN;
+    if (flags & fz_FILE_MAP_RANDOM)     hint |= FILE_FLAG_RANDOM_ACCESS;
+
+    void *handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, hint, 0);
+    if (handle == INVALID_HANDLE_VALUE) return 0;
+
+    unsigned long size_high = 0;
+    unsigned long size_low  = GetFileSize(handle, &size_high);
+    file->size = ((size_t)size_high << 32) | size_low;
+    if (file->size == 0) {
+        CloseHandle(handle);
+        return 1;
+    }
+
+    if (!(flags & fz_FILE_MAP_READ)) {
+        void *mapping = CreateFileMappingA(handle, 0, PAGE_READONLY, 0, 0, 0);
+        if (mapping) {
+            // the view keeps the mapping alive, both handles can go.
+            void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping);
+            if (view) {
+                CloseHandle(handle);
+                file->data   = (const uint8_t *)view;
+                file->mapped = 1;
+                return 1;
+            }
+        }
+    }
+
+    uint8_t *buffer = (uint8_t *)fz_alloc_ex(fallback, file->size);
+    size_t   done   = 0;
+    while (buffer && done < file->size) {
+        size_t chunk = file->size - done;
+        if (chunk > 0x40000000) chunk = 0x40000000; // ReadFile takes 32 bits.
+
+        unsigned long read = 0;
+        if (!ReadFile(handle, buffer + done, (unsigned long)chunk, &read, 0) || read == 0) break;
+        done += read;
+    }
+    CloseHandle(handle);
+
+    if (done != file->size) {
+        if (buffer) fz_free_ex(fallback, buffer);
+        memset(file, 0, sizeof(*file));
+        return 0;
+    }
+    file->data = buffer;
+    return 1;
+}
+
+void fz_file_unmap(fz_File_Map *file) {
+    if (file->mapped) {
+        UnmapViewOfFile(file->data);
+    } else if (file->data) {
+        fz_free_ex(file->allocator, (void *)file->data);
+    }
+    memset(file, 0, sizeof(*file));
+}
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+int fz_file_map(fz_File_Map *file, const char *path, int flags, fz_Allocator fallback) {
+    memset(file, 0, sizeof(*file));
+    file->allocator = fallback;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return 0;
+    }
+    file->size = (size_t)info.st_size;
+    if (file->size == 0) {
+        close(fd);
+        return 1;
+    }
+
+    if (!(flags & fz_FILE_MAP_READ)) {
+        void *view = mmap(0, file->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (view != MAP_FAILED) {
+            // the mapping holds its own reference to the file.
+            close(fd);
+            if (flags & fz_FILE_MAP_SEQUENTIAL) madvise(view, file->size, MADV_SEQUENTIAL);
+            if (flags & fz_FILE_MAP_RANDOM)     madvise(view, file->size, MADV_RANDOM);
+            if (flags & fz_FILE_MAP_WILLNEED)   madvise(view, file->size, MADV_WILLNEED);
+
+            file->data   = (const uint8_t *)view;
+            file->mapped = 1;
+            return 1;
+        }
+    }
+
+#if defined(POSIX_FADV_SEQUENTIAL)
+    if (flags & fz_FILE_MAP_SEQUENTIAL) posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    uint8_t *buffer = (uint8_t *)fz_alloc_ex(fallback, file->size);
+    size_t   done   = 0;
+    while (buffer && done < file->size) {
+        ssize_t got = read(fd, buffer + done, file->size - done);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) break;
+        done += (size_t)got;
+    }
+    close(fd);
+
+    if (done != file->size) {
+        if (buffer) fz_free_ex(fallback, buffer);
+        memset(file, 0, sizeof(*file));
+        return 0;
+    }
+    file->data = buffer;
+    return 1;
+}
+
+void fz_file_unmap(fz_File_Map *file) {
+    if (file->mapped) {
+        munmap((void *)file->data, file->size);
+    } else if (file->data) {
+        fz_free_ex(file->allocator, (void *)file->data);
+    }
+    memset(file, 0, sizeof(*file));
+}
+#endif
+
+struct fz__Alloc_Guard {
+    int      enabled;
+    int      fatal;
+    int      paused;
+    uint64_t frame;
+    uint64_t warmup_frames;
+    uint64_t violations;
+};
+
+static fz_THREAD_LOCAL fz__Alloc_Guard fz__alloc_guard;
+
+void fz_alloc_guard_begin(uint64_t warmup_frames, int fatal) {
+    memset(&fz__alloc_guard, 0, sizeof(fz__alloc_guard));
+    fz__alloc_guard.enabled       = 1;
+    fz__alloc_guard.fatal         = fatal;
+    fz__alloc_guard.warmup_frames = warmup_frames;
+}
+
+void fz_alloc_guard_end(void) {
+    fz__alloc_guard.enabled = 0;
+}
+
+void fz_alloc_guard_frame(void) {
+    fz__alloc_guard.frame++;
+}
+
+void fz_alloc_guard_pause(void) {
+    fz__alloc_guard.paused++;
+}
+
+void fz_alloc_guard_resume(void) {
+    assert(fz__alloc_guard.paused > 0);
+    fz__alloc_guard.paused--;
+}
+
+uint64_t fz_alloc_guard_violations(void) {
+    return fz__alloc_guard.violations;
+}
+
+static void fz__alloc_guard_check(const char *what, size_t size) {
+    fz__Alloc_Guard *guard = &fz__alloc_guard;
+    if (!guard->enabled || guard->paused || guard->frame <= guard->warmup_frames) return;
+
+    guard->violations++;
+    printf("[alloc guard] heap %s of %zu bytes in frame %llu at %s\n",
+           what, size, (unsigned long long)guard->frame, fz_alloc_site ? fz_alloc_site : "(unknown site)");
+
+    if (guard->fatal) {
+        fflush(stdout); // the report above, before the assert takes the process down.
+        assert(false && "heap allocation in steady state.");
+    }
+}
+
+fz_OPER_FUNC(fz_heap_operation) {
+    switch(op) {
+        case fz_MEMORY_OPER_ALLOCATE:
+            fz__alloc_guard_check("allocation", size);
+            return fz_platform_alloc(size);
+
+        case fz_MEMORY_OPER_FREE:
+            fz_platform_free(ptr); return NULL;
+
+        case fz_MEMORY_OPER_REALLOCATE:
+            fz__alloc_guard_check("reallocation", size);
+            return fz_platform_realloc(ptr, size);
+    }
+    return NULL;
+}
+
+fz_Allocator fz_heap_allocator() {
+    fz_Allocator allocator = {0};
+    allocator.oper_func = fz_heap_operation;
+
+    return allocator;
+}
+
+/*
+ * ==================================================
+ * Stretch Buffer (vector).
+ * basically the same as stb_ds.h (https://github.com/nothings/stb/blob/master/stb_ds.h)
+ * ==================================================
+ * */
+
+/*
+ * Couple things to note:
+ * @param output -- this points to a beginning of an array, AFTER the header.
+ * @param header -- this points to a beginning of a header, which should equal to (output - sizeof(fz_Array_Header_Type)).
+ * */
+int fz__vec_grow(void **output, fz_Array_Header_Type *header, size_t element_size, size_t grow_count) {
+    assert(header);
+    assert(output);
+    assert((*output) == (header + 1));
+    if (header->caps == 0) header->caps = 1;
+
+    int next_cap    = header->caps;
+    int next_length = header->used + grow_count;
+
+    while(next_cap <= next_length) next_cap *= 2;
+    size_t old_size = sizeof(fz_Array_Header_Type) + (size_t) header->caps * element_size;
+    size_t new_size = sizeof(fz_Array_Header_Type) + (size_t) next_cap     * element_size;
+
+    fz_Array_Header_Type *new_array = (fz_Array_Header_Type *)fz_realloc_ex(header->allocator, header, old_size, new_size);
+    assert(new_array);
+
+    new_array->caps = next_cap;
+    *output = (void *)(new_array + 1);
+    return 1;
+}
+
+void *
+fz__vec_create(size_t entry_type_size, size_t capacity, fz_Allocator allocator) {
+    fz_Array_Header_Type *result = (fz_Array_Header_Type *)fz_alloc_ex(allocator, sizeof(fz_Array_Header_Type) + (entry_type_size * capacity));
+
+    result->allocator = allocator;
+    result->used      = 0;
+    result->caps      = capacity;
+
+    return (void *)(result + 1);
+}
+
+void fz__vec_release(fz_Array_Header_Type *array_header) {
+    assert(array_header);
+    fz_free_ex(array_header->allocator, array_header);
+}
+
+void fz__vec_sort(fz_Vec(void) array, size_t elem_size, fz_COMPARATOR_FUNC comparator_func) {
+    qsort(array, fz_Vec_Length(array), elem_size, comparator_func);
+}
+
+int fz__vec_resizes_in_place(fz_Array_Header_Type *header, size_t old_size, size_t new_size) {
+    assert(header);
+    if (header->allocator.oper_func != fz_arena_operation) return 0;
+    if (new_size <= old_size) return 1;
+
+    fz_Arena *arena = (fz_Arena *)header->allocator.user_data;
+    return (uint8_t *)header == (arena->memory + (arena->used - old_size));
+}
+
+/*
+ * ==================================================
+ *  Hashmap.
+ * ==================================================
+ * */
+
+#define fz_MAP_CTRL_EMPTY   ((int8_t)-128) // 0b10000000
+#define fz_MAP_CTRL_DELETED ((int8_t)-2)   // 0b11111110
+// full slots store the lower 7 bits of the hash; sign bit is always 0.
+
+uint64_t fz_hash_bytes(const void *data, size_t size) {
+    // FNV-1a.
+    const uint8_t *bytes = (const uint8_t *)data;
+    uint64_t x = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; ++i) {
+        x ^= bytes[i];
+        x *= 1099511628211ULL;
+    }
+    return x;
+}
+
+uint64_t fz_hash_string(const char *str) {
+    return fz_hash_bytes(str, strlen(str));
+}
+
+// keys are often small sequential integers; scramble them so both h1 and h2 get good bits.
+static inline uint64_t fz__map_mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+// bit N is set when group[N] == h.
+static inline uint32_t fz__map_group_match(const int8_t *group, int8_t h) {
+#if defined(fz_HAS_SSE2)
+    __m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h), ctrl));
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < fz_MAP_GROUP_WIDTH; ++i) {
+        if (group[i] == h) mask |= (1u << i);
+    }
+    return mask;
+#endif
+}
+
+// bit N is set when group[N] is either empty or deleted (sign bit is set).
+static inline uint32_t fz__map_group_match_free(const int8_t *group) {
+#if defined(fz_HAS_SSE2)
+    return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)group));
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < fz_MAP_GROUP_WIDTH; ++i) {
+        if (group[i] < 0) mask |= (1u << i);
+    }
+    return mask;
+#endif
+}
+
+static inline void fz__map_set_ctrl(fz_Map_Header_Type *header, size_t slot, int8_t value) {
+    header->ctrl[slot] = value;
+    if (slot < fz_MAP_GROUP_WIDTH) header->ctrl[header->caps + slot] = value;
+}
+
+static size_t fz__map_keys_offset(size_t element_size, size_t caps) {
+    // +1 slot for the default value returned by MapGet on missing keys.
+    size_t values_end = sizeof(fz_Map_Header_Type) + element_size * (caps + 1);
+    return fz_align_to_power_of_two(values_end, sizeof(uint64_t));
+}
+
+static size_t fz__map_allocation_size(size_t element_size, size_t caps) {
+    return fz__map_keys_offset(element_size, caps) + sizeof(uint64_t) * caps + caps + fz_MAP_GROUP_WIDTH;
+}
+
+static fz_Map_Header_Type *fz__map_allocate(size_t element_size, size_t caps, fz_Allocator allocator) {
+    uint8_t *memory = (uint8_t *)fz_alloc_ex(allocator, fz__map_allocation_size(element_size, caps));
+    assert(memory);
+
+    fz_Map_Header_Type *header = (fz_Map_Header_Type *)memory;
+    header->allocator    = allocator;
+    header->element_size = element_size;
+    header->caps         = caps;
+    header->used         = 0;
+    header->tombstones   = 0;
+    header->keys         = (uint64_t *)(memory + fz__map_keys_offset(element_size, caps));
+    header->ctrl         = (int8_t *)(header->keys + caps);
+
+    memset(header->ctrl, fz_MAP_CTRL_EMPTY, caps + fz_MAP_GROUP_WIDTH);
+    memset((uint8_t *)(header + 1) + element_size * caps, 0, element_size); // default slot.
+
+    return header;
+}
+
+static size_t fz__map_caps_for(size_t count) {
+    // keep load factor (including tombstones) under 7/8.
+    size_t caps = fz_MAP_GROUP_WIDTH;
+    while ((caps / 8) * 7 < count) caps *= 2;
+    return caps;
+}
+
+void *fz__map_create(size_t element_size, size_t capacity, fz_Allocator allocator) {
+    fz_Map_Header_Type *header = fz__map_allocate(element_size, fz__map_caps_for(capacity), allocator);
+    return (void *)(header + 1);
+}
+
+void fz__map_release(fz_Map_Header_Type *header) {
+    assert(header);
+    fz_free_ex(header->allocator, header);
+}
+
+// first empty or deleted slot on the probe sequence of hash. key must not exist.
+static size_t fz__map_find_free_slot(fz_Map_Header_Type *header, uint64_t hash) {
+    size_t mask = header->caps - 1;
+    size_t pos  = (size_t)(hash >> 7) & mask;
+
+    for (size_t step = fz_MAP_GROUP_WIDTH; ; step += fz_MAP_GROUP_WIDTH) {
+        uint32_t free_mask = fz__map_group_match_free(header->ctrl + pos);
+        if (free_mask) {
+            return (pos + fz_ctz32(free_mask)) & mask;
+        }
+        pos = (pos + step) & mask;
+    }
+}
+
+ptrdiff_t fz__map_find(fz_Map_Header_Type *header, uint64_t key) {
+    uint64_t hash = fz__map_mix(key);
+    int8_t   h2   = (int8_t)(hash & 0x7f);
+    size_t   mask = header->caps - 1;
+    size_t   pos  = (size_t)(hash >> 7) & mask;
+
+    // triangular probing over groups visits every group once when caps is power of two.
+    for (size_t step = fz_MAP_GROUP_WIDTH; step <= header->caps; step += fz_MAP_GROUP_WIDTH) {
+        const int8_t *group = header->ctrl + pos;
+
+        uint32_t match = fz__map_group_match(group, h2);
+        while (match) {
+            size_t slot = (pos + fz_ctz32(match)) & mask;
+            if (header->keys[slot] == key) return (ptrdiff_t)slot;
+            match &= match - 1;
+        }
+
+        if (fz__map_group_match(group, fz_MAP_CTRL_EMPTY)) return -1;
+        pos = (pos + step) & mask;
+    }
+    return -1;
+}
+
+size_t fz__map_index_or_default(fz_Map_Header_Type *header, uint64_t key) {
+    ptrdiff_t found = fz__map_find(header, key);
+    return (found >= 0) ? (size_t)found : header->caps;
+}
+
+size_t fz__map_insert(fz_Map_Header_Type *header, uint64_t key) {
+    ptrdiff_t found = fz__map_find(header, key);
+    if (found >= 0) return (size_t)found;
+
+    uint64_t hash = fz__map_mix(key);
+    size_t   slot = fz__map_find_free_slot(header, hash);
+    assert((header->used + header->tombstones) < header->caps && "MapSet without fz__map_reserve.");
+
+    if (header->ctrl[slot] == fz_MAP_CTRL_DELETED) header->tombstones--;
+    fz__map_set_ctrl(header, slot, (int8_t)(hash & 0x7f));
+    header->keys[slot] = key;
+    header->used++;
+
+    return slot;
+}
+
+void fz__map_reserve(void **map, size_t count) {
+    assert(map && *map && "map must be created with MapCreate / MapCreateEx first.");
+    fz_Map_Header_Type *header = fz_Map_Header(*map);
+
+    if ((header->used + header->tombstones + count) <= (header->caps / 8) * 7) return;
+
+    // rehash. if it's mostly tombstones, the same size is enough.
+    size_t new_caps = fz__map_caps_for(header->used + count);
+    if (new_caps < header->caps) new_caps = header->caps;
+
+    fz_Map_Header_Type *rehashed = fz__map_allocate(header->element_size, new_caps, header->allocator);
+    uint8_t *old_values = (uint8_t *)(header + 1);
+    uint8_t *new_values = (uint8_t *)(rehashed + 1);
+
+    for (size_t i = 0; i < header->caps; ++i) {
+        if (header->ctrl[i] < 0) continue;
+
+        uint64_t key  = header->keys[i];
+        uint64_t hash = fz__map_mix(key);
+        size_t   slot = fz__map_find_free_slot(rehashed, hash);
+
+        fz__map_set_ctrl(rehashed, slot, (int8_t)(hash & 0x7f));
+        rehashed->keys[slot] = key;
+        memcpy(new_values + slot * header->element_size, old_values + i * header->element_size, header->element_size);
+    }
+    rehashed->used = header->used;
+
+    fz_free_ex(header->allocator, header);
+    *map = (void *)(rehashed + 1);
+}
+
+void fz__map_reserve_key(void **map, uint64_t key) {
+    assert(map && *map && "map must be created with MapCreate / MapCreateEx first.");
+    if (fz__map_find(fz_Map_Header(*map), key) >= 0) return; // overwriting never needs room.
+    fz__map_reserve(map, 1);
+}
+
+int fz__map_delete(fz_Map_Header_Type *header, uint64_t key) {
+    ptrdiff_t found = fz__map_find(header, key);
+    if (found < 0) return 0;
+
+    fz__map_set_ctrl(header, (size_t)found, fz_MAP_CTRL_DELETED);
+    header->used--;
+    header->tombstones++;
+
+    // nothing left: safe to wipe out every tombstone.
+    if (header->used == 0) {
+        memset(header->ctrl, fz_MAP_CTRL_EMPTY, header->caps + fz_MAP_GROUP_WIDTH);
+        header->tombstones = 0;
+    }
+    return 1;
+}
+
+/*
+ * ==================================================
+ *  Strings.
+ * ==================================================
+ * */
+
+fz_Str fz_str(const char *cstr) {
+    fz_Str result;
+    result.data   = cstr ? cstr : "";
+    result.length = cstr ? (int)strlen(cstr) : 0;
+    return result;
+}
+
+int fz_str_equal(fz_Str a, fz_Str b) {
+    return a.length == b.length && memcmp(a.data, b.data, (size_t)a.length) == 0;
+}
+
+fz_Str fz_str_copy(fz_Allocator allocator, fz_Str str) {
+    fz_Str result = fz_str(0);
+
+    char *copy = (char *)fz_alloc_ex(allocator, (size_t)str.length + 1);
+    if (!copy) return result;
+
+    memcpy(copy, str.data, (size_t)str.length);
+    copy[str.length] = 0;
+
+    result.data   = copy;
+    result.length = str.length;
+    return result;
+}
+
+fz_Str fz_str_vformat(fz_Allocator allocator, const char *format, va_list args) {
+    fz_Str result = fz_str(0);
+
+    va_list again;
+    va_copy(again, args);
+
+    // one vsnprintf for almost everything: guess, then give the unused tail back (in place on an arena).
+    char *buffer = (char *)fz_alloc_ex(allocator, fz_STR_FORMAT_GUESS);
+    if (!buffer) {
+        va_end(again);
+        return result;
+    }
+
+    int length = vsnprintf(buffer, fz_STR_FORMAT_GUESS, format, args);
+    if (length < 0) {
+        fz_free_ex(allocator, buffer);
+        va_end(again);
+        return result;
+    }
+
+    if (length >= fz_STR_FORMAT_GUESS) {
+        buffer = (char *)fz_realloc_ex(allocator, buffer, fz_STR_FORMAT_GUESS, (size_t)length + 1);
+        vsnprintf(buffer, (size_t)length + 1, format, again);
+    } else {
+        buffer = (char *)fz_realloc_ex(allocator, buffer, fz_STR_FORMAT_GUESS, (size_t)length + 1);
+    }
+    va_end(again);
+
+    result.data   = buffer;
+    result.length = length;
+    return result;
+}
+
+fz_Str fz_str_format(fz_Allocator allocator, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    fz_Str result = fz_str_vformat(allocator, format, args);
+    va_end(args);
+    return result;
+}
+
+void fz_str_builder_init(fz_Str_Builder *builder, fz_Allocator allocator, int capacity) {
+    if (capacity < 16) capacity = 16;
+
+    builder->allocator = allocator;
+    builder->length    = 0;
+    builder->capacity  = capacity;
+    builder->data      = (char *)fz_alloc_ex(allocator, (size_t)capacity + 1);
+    assert(builder->data && "String builder's allocator ran out of memory.");
+    builder->data[0] = 0;
+}
+
+static void fz__str_builder_reserve(fz_Str_Builder *builder, int extra) {
+    int needed = builder->length + extra;
+    if (needed <= builder->capacity) return;
+
+    int capacity = builder->capacity * 2;
+    if (capacity < needed) capacity = needed;
+
+    builder->data = (char *)fz_realloc_ex(builder->allocator, builder->data,
+                                          (size_t)builder->capacity + 1, (size_t)capacity + 1);
+    assert(builder->data && "String builder's allocator ran out of memory.");
+    builder->capacity = capacity;
+}
+
+void fz_str_append(fz_Str_Builder *builder, fz_Str str) {
+    fz__str_builder_reserve(builder, str.length);
+    memcpy(builder->data + builder->length, str.data, (size_t)str.length);
+    builder->length += str.length;
+    builder->data[builder->length] = 0;
+}
+
+void fz_str_appendf(fz_Str_Builder *builder, const char *format, ...) {
+    va_list args, again;
+    va_start(args, format);
+    va_copy(again, args);
+
+    // print into whatever capacity is left first, most of the time that is enough.
+    int room   = builder->capacity - builder->length;
+    int length = vsnprintf(builder->data + builder->length, (size_t)room + 1, format, args);
+    if (length > room) {
+        fz__str_builder_reserve(builder, length);
+        vsnprintf(builder->data + builder->length, (size_t)length + 1, format, again);
+    }
+    if (length > 0) builder->length += length;
+    builder->data[builder->length] = 0;
+
+    va_end(again);
+    va_end(args);
+}
+
+fz_Str fz_str_builder_finish(fz_Str_Builder *builder) {
+    fz_Str result;
+    result.data   = (char *)fz_realloc_ex(builder->allocator, builder->data,
+                                          (size_t)builder->capacity + 1, (size_t)builder->length + 1);
+    result.length = builder->length;
+
+    memset(builder, 0, sizeof(*builder));
+    return result;
+}
+
+void fz_intern_init(fz_Intern *table, fz_Allocator allocator) {
+    table->allocator = allocator;
+    table->ids       = fz_Map_CreateEx(uint32_t, 64, allocator);
+    table->strings   = fz_Vec_CreateEx(fz_Str, 64, allocator);
+}
+
+void fz_intern_release(fz_Intern *table) {
+    for (int i = 0; i < fz_Vec_Length(table->strings); ++i) {
+        fz_free_ex(table->allocator, (void *)table->strings[i].data);
+    }
+    fz_Vec_Release(table->strings);
+    fz_Map_Release(table->ids);
+    memset(table, 0, sizeof(*table));
+}
+
+uint32_t fz_intern_find(fz_Intern *table, fz_Str str) {
+    ptrdiff_t found = fz_Map_Find(table->ids, fz_hash_bytes(str.data, (size_t)str.length));
+    if (found < 0) return 0;
+
+    uint32_t id = table->ids[found];
+    // NOTE(fuzzy): same as the rest of fz_Map, keys are 64-bit hashes. make a collision loud at least.
+    assert(fz_str_equal(table->strings[id - 1], str) && "Two interned strings share a 64-bit hash.");
+    return id;
+}
+
+uint32_t fz_intern(fz_Intern *table, fz_Str str) {
+    uint32_t id = fz_intern_find(table, str);
+    if (id) return id;
+
+    fz_Vec_Push(table->strings, fz_str_copy(table->allocator, str));
+    id = (uint32_t)fz_Vec_Length(table->strings);
+    fz_Map_Put(table->ids, fz_hash_bytes(str.data, (size_t)str.length), id);
+    return id;
+}
+
+fz_Str fz_intern_string(fz_Intern *table, uint32_t id) {
+    assert(id > 0 && (int)id <= fz_Vec_Length(table->strings));
+    return table->strings[id - 1];
+}
+
+/*
+ * ==================================================
+ * Arena Allocator.
+ * ==================================================
+ * */
+
+#ifndef fz_PUSH_ALIGNMENT
+#define fz_PUSH_ALIGNMENT 16
+#endif
+
+void fz_arena_init(fz_Arena *arena, void *backing_memory, size_t memory_size) {
+    if (arena && backing_memory) {
+        arena->capacity = memory_size;
+        arena->used     = 0;
+        arena->memory   = (uint8_t *)backing_memory;
+        arena->capacity = memory_size;
+        arena->reserved = 0;
+        arena->decommit_threshold = 0;
+        arena->chunk_size = 0;
+        arena->generation = 0;
+    }
+}
+
+void fz_arena_init_virtual(fz_Arena *arena, size_t reserve_size, size_t decommit_threshold) {
+    size_t reserving = fz_align_to_power_of_two(reserve_size, fz_ARENA_COMMIT_GRANULARITY);
+
+    arena->memory   = (uint8_t *)fz_platform_reserve(reserving);
+    arena->capacity = 0;
+    arena->used     = 0;
+    arena->reserved = reserving;
+    arena->decommit_threshold = decommit_threshold;
+    arena->chunk_size = 0;
+    arena->generation = 0;
+}
+
+void fz_arena_release(fz_Arena *arena) {
+    assert(arena->reserved && "fz_arena_release is only for virtual arena.");
+    fz_platform_release(arena->memory, arena->reserved);
+
+    arena->memory   = NULL;
+    arena->capacity = 0;
+    arena->used     = 0;
+    arena->reserved = 0;
+}
+
+// Returns 1 if arena can hold `needed` bytes, committing more pages if it's virtual.
+static int fz__arena_fits(fz_Arena *arena, size_t needed) {
+    if (needed < arena->capacity) return 1;
+    if (!arena->reserved) return 0;
+
+    size_t committing = fz_align_to_power_of_two(needed + 1, fz_ARENA_COMMIT_GRANULARITY);
+    if (committing > arena->reserved) return 0;
+
+    fz_platform_commit(arena->memory + arena->capacity, committing - arena->capacity);
+    arena->capacity = committing;
+    return 1;
+}
+
+fz_OPER_FUNC(fz_arena_operation) {
+    fz_Arena *arena = (fz_Arena *)user_data;
+
+    int reallocating = 0;
+    switch(op) {
+        case fz_MEMORY_OPER_REALLOCATE:
+            assert(arena->memory <= ptr && ptr < (arena->memory + arena->capacity));
+            reallocating = 1;
+        /*
+         * fallthrough.
+         *  reallocate and allocate does the same thing, since it's cannot be freed
+         */
+
+        case fz_MEMORY_OPER_ALLOCATE:
+        {
+            if (size < fz_PUSH_ALIGNMENT) size = fz_PUSH_ALIGNMENT;
+
+            if (reallocating) {
+                assert(old_size <= arena->used);
+                int is_last = (ptr == (arena->memory + (arena->used - old_size)));
+
+                // shrinking never moves. the tail is given back if nothing was allocated after it.
+                if (size <= old_size) {
+                    if (is_last) arena->used -= old_size - size;
+                    return ptr;
+                }
+
+                if (is_last) { // ptr is the last allocation point and can be simply extended.
+                    // NOTE(fuzzy): grow by the exact difference -- next allocation aligns itself anyway,
+                    // and rounding here would break the (used - old_size) check on the next extend.
+                    size_t size_difference = size - old_size;
+                    int fits = fz__arena_fits(arena, arena->used + size_difference);
+                    assert(fits && "Arena is out of memory.");
+                    fz_UNUSED(fits);
+                    arena->used += size_difference;
+                    return ptr;
+                }
+            }
+
+            uintptr_t unaligned_memory_ptr = (uintptr_t)(arena->memory + arena->used);
+            uintptr_t memory_ptr = fz_align_to_power_of_two(unaligned_memory_ptr, fz_PUSH_ALIGNMENT);
+
+            // This amount (remainder) will be pushed along with the size of allocation
+            // to match the alignment. this will never go negative.
+            ptrdiff_t remainder = memory_ptr - unaligned_memory_ptr;
+            assert(remainder >= 0);
+
+            int fits = fz__arena_fits(arena, arena->used + remainder + size);
+            assert(fits && "Arena is out of memory.");
+            fz_UNUSED(fits);
+
+            uint8_t *memory = (uint8_t *)memory_ptr;
+            arena->used += remainder + size;
+
+            if (reallocating) {
+                memmove(memory, ptr, old_size);
+            }
+
+            return memory;
+        };
+
+        // For the sake of completeness.
+        case fz_MEMORY_OPER_FREE:
+        {
+            return NULL;
+        };
+    }
+    return NULL;
+}
+
+fz_Allocator fz_arena_allocator(fz_Arena *arena) {
+    fz_Allocator result;
+    result.user_data = (void *)arena;
+    result.oper_func = fz_arena_operation;
+    return result;
+}
+
+/*
+ * ==================================================
+ * Atomic Arena.
+ * ==================================================
+ * */
+
+#ifndef fz_ARENA_CHUNK_CACHES
+#define fz_ARENA_CHUNK_CACHES 4 // atomic arenas a thread can allocate from without evicting its chunks.
+#endif
+
+fz_STATIC_ASSERT(sizeof(size_t) == sizeof(uint64_t)); // used is bumped with fz_atomic_add64.
+
+struct fz__Arena_Chunk_Cache {
+    fz_Arena *arena;
+    uint32_t  generation;
+    uint8_t  *cursor;
+    uint8_t  *end;
+};
+
+static fz_THREAD_LOCAL fz__Arena_Chunk_Cache fz__arena_chunk_caches[fz_ARENA_CHUNK_CACHES];
+static fz_THREAD_LOCAL int fz__arena_chunk_cache_victim;
+
+// unique across arenas, so a cache entry can't mistake a re-initialized arena at the same address for the old one.
+static volatile uint32_t fz__arena_generations;
+
+static uint32_t fz__arena_next_generation(void) {
+    return fz_atomic_add32(&fz__arena_generations, 1) + 1;
+}
+
+void fz_arena_init_atomic(fz_Arena *arena, size_t reserve_size, size_t chunk_size) {
+    assert(chunk_size > 0 && (chunk_size % fz_PUSH_ALIGNMENT) == 0);
+    fz_arena_init_virtual(arena, reserve_size, 0);
+
+    arena->chunk_size = chunk_size;
+    arena->generation = fz__arena_next_generation();
+}
+
+// commits up to `needed`. several threads may commit the same pages at once, which is harmless;
+// capacity only ever grows here.
+static int fz__arena_fits_atomic(fz_Arena *arena, size_t needed) {
+    volatile uint64_t *capacity = (volatile uint64_t *)&arena->capacity;
+    uint64_t committed = fz_atomic_load64(capacity);
+    if (needed < committed) return 1;
+
+    size_t committing = fz_align_to_power_of_two(needed + 1, fz_ARENA_COMMIT_GRANULARITY);
+    if (committing > arena->reserved) return 0;
+
+    fz_platform_commit(arena->memory + committed, committing - committed);
+    while (committed < committing) {
+        uint64_t seen = fz_atomic_cas64(capacity, committed, committing);
+        if (seen == committed) break;
+        committed = seen;
+    }
+    return 1;
+}
+
+static uint8_t *fz__atomic_arena_push(fz_Arena *arena, size_t size) {
+    size_t offset = (size_t)fz_atomic_add64((volatile uint64_t *)&arena->used, size);
+
+    int fits = fz__arena_fits_atomic(arena, offset + size);
+    assert(fits && "Arena is out of memory.");
+    fz_UNUSED(fits);
+
+    return arena->memory + offset;
+}
+
+static fz__Arena_Chunk_Cache *fz__arena_chunk_cache(fz_Arena *arena) {
+    for (int i = 0; i < fz_ARENA_CHUNK_CACHES; ++i) {
+        if (fz__arena_chunk_caches[i].arena == arena) return &fz__arena_chunk_caches[i];
+    }
+
+    // the evicted chunk's tail is simply wasted until the arena is reset.
+    fz__Arena_Chunk_Cache *cache = &fz__arena_chunk_caches[fz__arena_chunk_cache_victim];
+    fz__arena_chunk_cache_victim = (fz__arena_chunk_cache_victim + 1) % fz_ARENA_CHUNK_CACHES;
+
+    cache->arena      = arena;
+    cache->generation = 0;
+    cache->cursor     = NULL;
+    cache->end        = NULL;
+    return cache;
+}
+
+fz_OPER_FUNC(fz_atomic_arena_operation) {
+    fz_Arena *arena = (fz_Arena *)user_data;
+
+    switch(op) {
+        case fz_MEMORY_OPER_REALLOCATE:
+            assert(arena->memory <= ptr && ptr < (arena->memory + arena->reserved));
+            // NOTE(fuzzy): can't tell whether ptr is the last allocation without racing, so it never extends in place.
+            if (size <= old_size) return ptr;
+        /*
+         * fallthrough.
+         */
+
+        case fz_MEMORY_OPER_ALLOCATE:
+        {
+            // every size is a multiple of fz_PUSH_ALIGNMENT, so every offset stays aligned.
+            size_t aligned_size = fz_align_to_power_of_two(size ? size : 1, fz_PUSH_ALIGNMENT);
+            uint8_t *memory;
+
+            if (aligned_size <= arena->chunk_size / 4) {
+                fz__Arena_Chunk_Cache *cache = fz__arena_chunk_cache(arena);
+
+                uint32_t generation = fz_atomic_load32((volatile uint32_t *)&arena->generation);
+                if (cache->generation != generation) {
+                    cache->generation = generation;
+                    cache->cursor     = NULL;
+                    cache->end        = NULL;
+                }
+
+                if ((size_t)(cache->end - cache->cursor) < aligned_size) {
+                    cache->cursor = fz__atomic_arena_push(arena, arena->chunk_size);
+                    cache->end    = cache->cursor + arena->chunk_size;
+                }
+
+                memory = cache->cursor;
+                cache->cursor += aligned_size;
+            } else {
+                memory = fz__atomic_arena_push(arena, aligned_size);
+            }
+            assert(((uintptr_t)memory & (fz_PUSH_ALIGNMENT - 1)) == 0);
+
+            if (op == fz_MEMORY_OPER_REALLOCATE) {
+                memcpy(memory, ptr, old_size);
+            }
+            return memory;
+        };
+
+        case fz_MEMORY_OPER_FREE:
+        {
+            return NULL;
+        };
+    }
+    return NULL;
+}
+
+fz_Allocator fz_atomic_arena_allocator(fz_Arena *arena) {
+    assert(arena->chunk_size && "use fz_arena_init_atomic.");
+    fz_Allocator result;
+    result.user_data = (void *)arena;
+    result.oper_func = fz_atomic_arena_operation;
+    return result;
+}
+
+fz_Temp_Memory fz_begin_temp(fz_Arena *arena) {
+    fz_Temp_Memory result;
+    result.arena = arena;
+    result.used_before = arena->used;
+    return result;
+}
+
+void fz_end_temp(fz_Temp_Memory scratch) {
+    fz_Arena *arena = scratch.arena;
+    arena->used = scratch.used_before;
+
+    if (arena->chunk_size) {
+        arena->generation = fz__arena_next_generation();
+    }
+
+    if (arena->reserved && arena->decommit_threshold) {
+        size_t keep = fz_align_to_power_of_two(arena->used + arena->decommit_threshold, fz_ARENA_COMMIT_GRANULARITY);
+        if (keep < arena->capacity) {
+            fz_platform_decommit(arena->memory + keep, arena->capacity - keep);
+            arena->capacity = keep;
+        }
+    }
+}
+
+/*
+ * ==================================================
+ * Scratch Arenas.
+ * ==================================================
+ * */
+
+static fz_THREAD_LOCAL fz_Arena fz__scratch_arenas[fz_SCRATCH_ARENA_COUNT];
+
+fz_Temp_Memory fz_get_scratch(fz_Arena **conflicts, int conflict_count) {
+    for (int i = 0; i < fz_SCRATCH_ARENA_COUNT; ++i) {
+        fz_Arena *arena = &fz__scratch_arenas[i];
+
+        int conflicting = 0;
+        for (int j = 0; j < conflict_count; ++j) {
+            if (conflicts[j] == arena) {
+                conflicting = 1;
+                break;
+            }
+        }
+        if (conflicting) continue;
+
+        if (!arena->memory) {
+            fz_arena_init_virtual(arena, fz_SCRATCH_ARENA_SIZE, 0);
+        }
+        return fz_begin_temp(arena);
+    }
+
+    assert(false && "every scratch arena conflicts; raise fz_SCRATCH_ARENA_COUNT.");
+    fz_Temp_Memory nothing = {0};
+    return nothing;
+}
+
+void fz_scratch_thread_release(void) {
+    for (int i = 0; i < fz_SCRATCH_ARENA_COUNT; ++i) {
+        fz_Arena *arena = &fz__scratch_arenas[i];
+        if (arena->memory) {
+            fz_arena_release(arena);
+        }
+    }
+}
+
+/*
+ * ==================================================
+ * Stack Allocator.
+ * ==================================================
+ * */
+
+void fz_stack_init(fz_StackAlloc *stackalloc, void *backing_memory, size_t memory_size) {
+    stackalloc->base = (uint8_t *)backing_memory;
+    stackalloc->caps = memory_size;
+    stackalloc->prev = 0;
+    stackalloc->current = 0;
+}
+
+fz_Allocator fz_stack_allocator(fz_StackAlloc *stackalloc) {
+    fz_Allocator result;
+    result.user_data = (void *)stackalloc;
+    result.oper_func = fz_stack_operation;
+    return result;
+}
+
+fz_OPER_FUNC(fz_stack_operation) {
+    fz_StackAlloc *stack = (fz_StackAlloc *)user_data;
+
+    switch(op) {
+        case fz_MEMORY_OPER_ALLOCATE:
+        {
+            size_t new_size = size + sizeof(fz_Stack_Header);
+            uintptr_t unaligned_ptr = (uintptr_t)(stack->base + stack->current);
+            uintptr_t memory_ptr = fz_align_to_power_of_two(unaligned_ptr, fz_PUSH_ALIGNMENT);
+
+            ptrdiff_t remainder = memory_ptr - unaligned_ptr;
+            assert(remainder >= 0);
+            assert((stack->current + remainder + new_size) <= stack->caps);
+
+            fz_Stack_Header *memory = (fz_Stack_Header *)memory_ptr;
+
+            memory->prev_offset = stack->prev;
+            memory->padding     = remainder;
+
+            stack->prev     = stack->current;
+            stack->current += new_size + remainder;
+
+            return (void *)(memory + 1);
+        } break;
+
+        case fz_MEMORY_OPER_FREE:
+        {
+            assert(stack->base <= ptr && ptr <= (stack->base + stack->caps));
+            fz_Stack_Header *header = (fz_Stack_Header *)ptr - 1;
+            size_t header_placed_in = ((size_t)header - header->padding - (size_t)stack->base);
+            assert(stack->prev == header_placed_in && "Order difference: stack free must follow LIFO rules.");
+
+            stack->current = stack->prev;
+            stack->prev = header->prev_offset;
+        } break;
+
+        case fz_MEMORY_OPER_REALLOCATE:
+        {
+            assert(stack->base <= ptr && ptr <= (stack->base + stack->caps));
+            fz_Stack_Header *header = (fz_Stack_Header *)ptr - 1;
+            size_t header_placed_in = ((size_t)header - header->padding - (size_t)stack->base);
+            assert(stack->prev == header_placed_in && "Order difference: stack free must follow LIFO rules.");
+
+            // the top allocation runs from ptr up to current.
+            size_t allocation_size = (size_t)(stack->base + stack->current - (uint8_t *)ptr);
+            if (allocation_size < size) {
+                assert((stack->current + (size - allocation_size)) <= stack->caps);
+                stack->current += size - allocation_size;
+            }
+
+            return ptr;
+        } break;
+    }
+
+    return NULL;
+}
+
+/*
+ * ==================================================
+ * Pool Allocator.
+ * ==================================================
+ * */
+
+void fz_pool_init(fz_Pool *pool, void *backing_memory, size_t memory_size, size_t element_size) {
+    fz_pool_init_ex(pool, backing_memory, memory_size, element_size, 0);
+}
+
+void fz_pool_init_ex(fz_Pool *pool, void *backing_memory, size_t memory_size, size_t element_size, int flags) {
+    assert(memory_size  > sizeof(fz_SLL_Header));
+    assert(element_size > sizeof(fz_SLL_Header));
+
+    uint8_t *backing = (uint8_t *)backing_memory;
+    size_t available_count = memory_size / element_size; // any fractions will get rounded down to 0.
+
+    pool->base         = backing;
+    pool->element_size = element_size;
+    pool->memory_caps  = available_count * element_size;
+    pool->flags        = flags;
+
+    if (flags & fz_POOL_LAZY) {
+        pool->free = NULL;
+        pool->bump = 0;
+        return;
+    }
+
+    memset(backing, 0, memory_size);
+
+    // NOTE:
+    // available_count - 1 means that the last one of the sll header
+    // will be left resetted to zero from the memset above;
+    // effectively leaving the next member variable to NULL
+    for (size_t i = 0; i + 1 < available_count; ++i) {
+        size_t memory_position = i * element_size;
+        fz_SLL_Header *current = (fz_SLL_Header *)(backing + memory_position);
+        current->next = (fz_SLL_Header *)(backing + memory_position + element_size);
+    }
+
+    pool->free = (fz_SLL_Header *)backing;
+    pool->bump = pool->memory_caps;
+}
+
+fz_Allocator fz_pool_allocator(fz_Pool *pool) {
+    fz_Allocator allocator;
+    allocator.user_data = pool;
+    allocator.oper_func = fz_pool_operation;
+
+    return allocator;
+}
+
+int fz_pool_alloc_n(fz_Pool *pool, void **out, int count) {
+    int zeroing = !(pool->flags & fz_POOL_NO_ZERO);
+    int written = 0;
+
+    while (written < count && pool->free) {
+        fz_SLL_Header *chunk = pool->free;
+        pool->free = chunk->next;
+
+        if (zeroing) memset(chunk, 0, pool->element_size);
+        out[written++] = chunk;
+    }
+
+    // the rest comes from untouched memory in one contiguous run.
+    size_t remaining = (pool->memory_caps - pool->bump) / pool->element_size;
+    size_t taking    = (size_t)(count - written);
+    if (taking > remaining) taking = remaining;
+
+    if (taking) {
+        uint8_t *run = pool->base + pool->bump;
+        pool->bump += taking * pool->element_size;
+
+        if (zeroing) memset(run, 0, taking * pool->element_size);
+        for (size_t i = 0; i < taking; ++i) {
+            out[written++] = run + i * pool->element_size;
+        }
+    }
+
+    return written;
+}
+
+void fz_pool_free_n(fz_Pool *pool, void **ptrs, int count) {
+    if (count <= 0) return;
+
+    // chain them up first, then splice onto the free list at once.
+    for (int i = 0; i < count; ++i) {
+        assert(pool->base <= (uint8_t *)ptrs[i] && (uint8_t *)ptrs[i] < (pool->base + pool->memory_caps));
+        ((fz_SLL_Header *)ptrs[i])->next = (i + 1 < count) ? (fz_SLL_Header *)ptrs[i + 1] : pool->free;
+    }
+    pool->free = (fz_SLL_Header *)ptrs[0];
+}
+
+fz_OPER_FUNC(fz_pool_operation) {
+    fz_UNUSED(old_size);
+    fz_Pool *pool = (fz_Pool *)user_data;
+
+    switch(op) {
+        case fz_MEMORY_OPER_ALLOCATE:
+        {
+            assert(size == pool->element_size);
+            void *available_chunk = NULL;
+
+            if (pool->free) {
+                available_chunk = pool->free;
+                pool->free = pool->free->next;
+            } else if (pool->bump < pool->memory_caps) {
+                available_chunk = pool->base + pool->bump;
+                pool->bump += pool->element_size;
+            } else {
+                return NULL; // Pool is full.
+            }
+
+            if (!(pool->flags & fz_POOL_NO_ZERO)) {
+                memset(available_chunk, 0, size);
+            }
+            return available_chunk;
+        };
+
+        case fz_MEMORY_OPER_FREE:
+        {
+            // NOTE(fuzzy): no need to clear here -- allocation zeroes it (unless fz_POOL_NO_ZERO).
+            assert(pool->base <= ptr && ptr < (pool->base + pool->memory_caps));
+
+            fz_SLL_Header freed;
+            freed.next = pool->free;
+
+            *(fz_SLL_Header *)ptr = freed;
+            pool->free = (fz_SLL_Header *)ptr;
+
+        } break;
+
+        case fz_MEMORY_OPER_REALLOCATE:
+        {
+            fz_UNREACHABLE_PATH;
+        };
+    }
+
+    return NULL;
+}
+
+/*
+ * ==================================================
+ * Slab.
+ * ==================================================
+ * */
+
+void fz_slab_init(fz_Slab *slab, void *backing_memory, size_t memory_size, size_t element_size) {
+    assert(element_size > 0);
+
+    size_t per_element = sizeof(fz_Slab_Slot) + element_size + sizeof(uint32_t);
+    size_t capacity    = (memory_size - 2 * fz_PUSH_ALIGNMENT) / per_element; // room to align each region.
+    if (capacity > fz_HANDLE_INDEX_MASK) capacity = fz_HANDLE_INDEX_MASK;
+    assert(capacity > 0);
+
+    uint8_t *backing = (uint8_t *)backing_memory;
+    uint8_t *dense   = (uint8_t *)fz_align_to_power_of_two((uintptr_t)(backing + capacity * sizeof(fz_Slab_Slot)), fz_PUSH_ALIGNMENT);
+    uint8_t *back    = (uint8_t *)fz_align_to_power_of_two((uintptr_t)(dense + capacity * element_size), fz_PUSH_ALIGNMENT);
+    assert(back + capacity * sizeof(uint32_t) <= backing + memory_size);
+
+    // not lazy: that zeroes every slot, so generations start out defined.
+    fz_pool_init_ex(&slab->slots, backing, capacity * sizeof(fz_Slab_Slot), sizeof(fz_Slab_Slot), fz_POOL_NO_ZERO);
+
+    slab->dense        = dense;
+    slab->dense_slots  = (uint32_t *)back;
+    slab->element_size = element_size;
+    slab->count        = 0;
+    slab->capacity     = (int)capacity;
+}
+
+static fz_Slab_Slot *fz__slab_slot(fz_Slab *slab, fz_Handle handle) {
+    uint32_t index = handle & fz_HANDLE_INDEX_MASK;
+    if ((handle >> fz_HANDLE_INDEX_BITS) == 0 || index >= (uint32_t)slab->capacity) return NULL;
+
+    fz_Slab_Slot *slot = (fz_Slab_Slot *)slab->slots.base + index;
+    if (slot->generation != (handle >> fz_HANDLE_INDEX_BITS)) return NULL; // free slots never match, see fz_slab_remove.
+    return slot;
+}
+
+fz_Handle fz_slab_add(fz_Slab *slab, void **out) {
+    fz_Slab_Slot *slot = (fz_Slab_Slot *)fz_alloc_ex(fz_pool_allocator(&slab->slots), sizeof(fz_Slab_Slot));
+    if (!slot) {
+        if (out) *out = NULL;
+        return 0;
+    }
+
+    if (slot->generation == 0) slot->generation = 1; // never handed out before.
+    uint32_t index = (uint32_t)(slot - (fz_Slab_Slot *)slab->slots.base);
+
+    slot->dense_index = (uint32_t)slab->count;
+    slab->dense_slots[slab->count] = index;
+
+    void *element = fz_slab_at(slab, uint8_t, slab->count);
+    memset(element, 0, slab->element_size);
+    slab->count++;
+
+    if (out) *out = element;
+    return (slot->generation << fz_HANDLE_INDEX_BITS) | index;
+}
+
+void *fz_slab_get(fz_Slab *slab, fz_Handle handle) {
+    fz_Slab_Slot *slot = fz__slab_slot(slab, handle);
+    return slot ? fz_slab_at(slab, uint8_t, slot->dense_index) : NULL;
+}
+
+int fz_slab_remove(fz_Slab *slab, fz_Handle handle) {
+    fz_Slab_Slot *slot = fz__slab_slot(slab, handle);
+    if (!slot) return 0;
+
+    uint32_t hole = slot->dense_index;
+    uint32_t last = (uint32_t)(slab->count - 1);
+    if (hole != last) {
+        memcpy(fz_slab_at(slab, uint8_t, hole), fz_slab_at(slab, uint8_t, last), slab->element_size);
+
+        uint32_t moved_slot = slab->dense_slots[last];
+        slab->dense_slots[hole] = moved_slot;
+        ((fz_Slab_Slot *)slab->slots.base + moved_slot)->dense_index = hole;
+    }
+    slab->count--;
+
+    // bump the generation now rather than on reuse, so handles to a free slot are already stale.
+    slot->generation = (slot->generation + 1) & fz_HANDLE_GENERATION_MASK;
+    if (slot->generation == 0) slot->generation = 1;
+
+    fz_free_ex(fz_pool_allocator(&slab->slots), slot);
+    return 1;
+}
+
+fz_Handle fz_slab_handle_at(fz_Slab *slab, int dense_index) {
+    assert(0 <= dense_index && dense_index < slab->count);
+    uint32_t index = slab->dense_slots[dense_index];
+    fz_Slab_Slot *slot = (fz_Slab_Slot *)slab->slots.base + index;
+    return (slot->generation << fz_HANDLE_INDEX_BITS) | index;
+}
+
+void fz_slab_clear(fz_Slab *slab) {
+    while (slab->count > 0) {
+        fz_slab_remove(slab, fz_slab_handle_at(slab, slab->count - 1));
+    }
+}
+
+/*
+ * ==================================================
+ * Freelist Allocator.
+ * ==================================================
+ * */
+
+#define fz_FREELIST_USED_FLAG   ((size_t)1)
+#define fz_FREELIST_OVERHEAD    (2 * sizeof(fz_SizeHeader)) // header + footer.
+#define fz_FREELIST_MIN_PAYLOAD (sizeof(fz_ListNode) - sizeof(fz_SizeHeader))
+
+static inline size_t fz__freelist_payload(fz_SizeHeader *header) {
+    return header->size & ~fz_FREELIST_USED_FLAG;
+}
+
+static inline fz_SizeHeader *fz__freelist_footer(fz_SizeHeader *header) {
+    return (fz_SizeHeader *)((uint8_t *)(header + 1) + fz__freelist_payload(header));
+}
+
+static inline void fz__freelist_set_block(fz_SizeHeader *header, size_t payload, size_t used) {
+    header->size = payload | used;
+    fz__freelist_footer(header)->size = payload | used;
+}
+
+static inline void fz__freelist_unlink(fz_ListNode *node) {
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+}
+
+static inline void fz__freelist_push(fz_Freelist *list, fz_ListNode *node) {
+    node->prev = &list->sentinel;
+    node->next = list->sentinel.next;
+    list->sentinel.next->prev = node;
+    list->sentinel.next = node;
+}
+
+void fz_freelist_init(fz_Freelist *freelist, void *backing_memory, size_t memory_size) {
+    freelist->base = backing_memory;
+    freelist->memory_caps = memory_size;
+
+    // Layout: [prologue footer | header | payload ... | footer | epilogue header]
+    // prologue and epilogue are marked used, so coalescing never walks out of the memory.
+    // payload is kept 16 byte aligned, and size multiple of 16.
+    uintptr_t rounded_up = fz_align_to_power_of_two((uintptr_t)backing_memory, 16);
+    size_t usable = memory_size - (size_t)(rounded_up - (uintptr_t)backing_memory);
+    assert(usable >= 16 + fz_FREELIST_OVERHEAD + fz_FREELIST_MIN_PAYLOAD + sizeof(fz_SizeHeader));
+
+    fz_SizeHeader *prologue = (fz_SizeHeader *)(rounded_up + 16 - 2 * sizeof(fz_SizeHeader));
+    prologue->size = fz_FREELIST_USED_FLAG;
+
+    fz_SizeHeader *header = prologue + 1;
+    size_t payload = (usable - 16 - fz_FREELIST_OVERHEAD) & ~(size_t)15;
+    fz__freelist_set_block(header, payload, 0);
+
+    fz_SizeHeader *epilogue = fz__freelist_footer(header) + 1;
+    epilogue->size = fz_FREELIST_USED_FLAG;
+
+    freelist->sentinel.size = fz_FREELIST_USED_FLAG;
+    freelist->sentinel.next = &freelist->sentinel;
+    freelist->sentinel.prev = &freelist->sentinel;
+    fz__freelist_push(freelist, (fz_ListNode *)header);
+}
+
+fz_Allocator fz_freelist_allocator(fz_Freelist *freelist) {
+    fz_Allocator allocator;
+    allocator.user_data = freelist;
+    allocator.oper_func = fz_freelist_operation;
+    return allocator;
+}
+
+fz_Freelist_Stats fz_freelist_stats(fz_Freelist *freelist) {
+    fz_Freelist_Stats stats = {0};
+
+    for (fz_ListNode *node = freelist->sentinel.next; node != &freelist->sentinel; node = node->next) {
+        stats.free_bytes  += node->size;
+        stats.free_blocks += 1;
+        if (node->size > stats.largest_free) stats.largest_free = node->size;
+    }
+
+    if (stats.free_bytes) {
+        stats.fragmentation = 1.0f - ((float)stats.largest_free / (float)stats.free_bytes);
+    }
+    return stats;
+}
+
+// Splits `payload` off the front of a used block, handing back the rest as a free block.
+static void fz__freelist_split(fz_Freelist *list, fz_SizeHeader *header, size_t payload) {
+    size_t block_payload = fz__freelist_payload(header);
+    if (block_payload < payload + fz_FREELIST_OVERHEAD + fz_FREELIST_MIN_PAYLOAD) return;
+
+    fz__freelist_set_block(header, payload, fz_FREELIST_USED_FLAG);
+
+    fz_SizeHeader *remain = fz__freelist_footer(header) + 1;
+    fz__freelist_set_block(remain, block_payload - payload - fz_FREELIST_OVERHEAD, 0);
+    fz__freelist_push(list, (fz_ListNode *)remain);
+}
+
+fz_OPER_FUNC(fz_freelist_operation) {
+    fz_Freelist *list = (fz_Freelist *)user_data;
+    size_t size_pow2 = fz_align_to_power_of_two(size, 16);
+    if (size_pow2 < fz_FREELIST_MIN_PAYLOAD) size_pow2 = fz_FREELIST_MIN_PAYLOAD;
+
+    switch(op) {
+        case fz_MEMORY_OPER_ALLOCATE:
+        {
+            fz_ListNode *current  = list->sentinel.next;
+            fz_ListNode *best_fit = NULL;
+
+            while(current != &list->sentinel) {
+                if (size_pow2 == current->size) {
+                    best_fit = current;
+                    break;
+                }
+
+                if (size_pow2 <= current->size && (!best_fit || current->size < best_fit->size)) {
+                    best_fit = current;
                 }
+                current = current->next;
+            }
+            // Too big. fail.
+            if (!best_fit) {
+                return NULL;
             }
 
-            uintptr_t unaligned_memory_ptr = (uintptr_t)(arena->memory + arena->used);
-            uintptr_t memory_ptr = fz_align_to_power_of_two(unaligned_memory_ptr, fz_PUSH_ALIGNMENT);
+            fz__freelist_unlink(best_fit);
 
-            // This amount (remainder) will be pushed along with the size of allocation
-            // to match the alignment. this will never go negative.
-            ptrdiff_t remainder = memory_ptr - unaligned_memory_ptr;
-            assert(remainder >= 0);
-            assert((arena->used + remainder + size) < arena->capacity);
+            fz_SizeHeader *header = (fz_SizeHeader *)best_fit;
+            fz__freelist_set_block(header, best_fit->size, fz_FREELIST_USED_FLAG);
+            fz__freelist_split(list, header, size_pow2);
 
-            uint8_t *memory = (uint8_t *)memory_ptr;
-            arena->used += remainder + size;
+            return (void *)(header + 1);
+        } break;
 
-            if (reallocating) {
-                memmove(ptr, memory, old_size);
+        case fz_MEMORY_OPER_FREE:
+        {
+            assert(list->base <= ptr && ptr < ((char *)list->base + list->memory_caps));
+
+            fz_SizeHeader *header = ((fz_SizeHeader*)ptr - 1);
+            assert((header->size & fz_FREELIST_USED_FLAG) && "double free on freelist allocator.");
+            size_t payload = fz__freelist_payload(header);
+
+            // Coalesce with the previous block: its footer sits right before our header.
+            fz_SizeHeader *prev_footer = header - 1;
+            if (!(prev_footer->size & fz_FREELIST_USED_FLAG)) {
+                fz_SizeHeader *prev = (fz_SizeHeader *)((uint8_t *)prev_footer - prev_footer->size) - 1;
+                fz__freelist_unlink((fz_ListNode *)prev);
+
+                payload += prev_footer->size + fz_FREELIST_OVERHEAD;
+                header = prev;
             }
 
-            return memory;
-        };
+            // ...and with the next one: its header sits right after our footer.
+            fz_SizeHeader *next = (fz_SizeHeader *)((uint8_t *)(header + 1) + payload) + 1;
+            if (!(next->size & fz_FREELIST_USED_FLAG)) {
+                fz__freelist_unlink((fz_ListNode *)next);
+                payload += next->size + fz_FREELIST_OVERHEAD;
+            }
 
-        // For the sake of completeness.
-        case fz_MEMORY_OPER_FREE:
+            fz__freelist_set_block(header, payload, 0);
+            fz__freelist_push(list, (fz_ListNode *)header);
+        } break;
+
+        case fz_MEMORY_OPER_REALLOCATE:
         {
+            fz_SizeHeader *header = ((fz_SizeHeader*)ptr - 1);
+            size_t block_size = fz__freelist_payload(header);
+            if (size_pow2 <= block_size) return ptr;
+
+            // Grow in place when the next block is free and big enough.
+            fz_SizeHeader *next = fz__freelist_footer(header) + 1;
+            if (!(next->size & fz_FREELIST_USED_FLAG) && (block_size + fz_FREELIST_OVERHEAD + next->size) >= size_pow2) {
+                fz__freelist_unlink((fz_ListNode *)next);
+                fz__freelist_set_block(header, block_size + fz_FREELIST_OVERHEAD + next->size, fz_FREELIST_USED_FLAG);
+                fz__freelist_split(list, header, size_pow2);
+                return ptr;
+            }
+
+            void *new_memory = fz_freelist_operation(fz_MEMORY_OPER_ALLOCATE, 0, 0, size, user_data);
+
+            if (new_memory) {
+                memmove(new_memory, ptr, block_size);
+                fz_freelist_operation(fz_MEMORY_OPER_FREE, ptr, 0, 0, user_data);
+                return new_memory;
+            }
+
             return NULL;
-        };
+        } break;
     }
+
     return NULL;
 }
 
-fz_Allocator fz_arena_allocator(fz_Arena *arena) {
-    fz_Allocator result;
-    result.user_data = (void *)arena;
-    result.oper_func = fz_arena_operation;
-    return result;
+/*
+ * ==================================================
+ * TLSF Allocator.
+ * ==================================================
+ * */
+
+#define fz_TLSF_BLOCK_FREE      ((size_t)1)
+#define fz_TLSF_BLOCK_PREV_FREE ((size_t)2)
+#define fz_TLSF_FLAG_MASK       ((size_t)3)
+
+#define fz_TLSF_HEADER_SIZE     (offsetof(fz_Tlsf_Block, next_free))
+#define fz_TLSF_MIN_PAYLOAD     (sizeof(fz_Tlsf_Block) - fz_TLSF_HEADER_SIZE)
+
+static inline size_t fz__tlsf_size(fz_Tlsf_Block *block) {
+    return block->size & ~fz_TLSF_FLAG_MASK;
 }
 
-fz_Temp_Memory fz_begin_temp(fz_Arena *arena) {
-    fz_Temp_Memory result;
-    result.arena = arena;
-    result.used_before = arena->used;
-    return result;
+static inline void fz__tlsf_set_size(fz_Tlsf_Block *block, size_t size) {
+    block->size = size | (block->size & fz_TLSF_FLAG_MASK);
+}
+
+static inline fz_Tlsf_Block *fz__tlsf_next_phys(fz_Tlsf_Block *block) {
+    return (fz_Tlsf_Block *)((uint8_t *)block + fz_TLSF_HEADER_SIZE + fz__tlsf_size(block));
+}
+
+static inline void fz__tlsf_mapping(size_t size, int *fl, int *sl) {
+    assert(size < ((size_t)1 << fz_TLSF_FL_MAX));
+    if (size < fz_TLSF_SMALL_BLOCK) {
+        *fl = 0;
+        *sl = (int)size / (fz_TLSF_SMALL_BLOCK / fz_TLSF_SL_COUNT);
+    } else {
+        int top = 31 - fz_clz32((uint32_t)size);
+        *sl = (int)(size >> (top - fz_TLSF_SL_COUNT_LOG2)) ^ fz_TLSF_SL_COUNT;
+        *fl = top - (fz_TLSF_FL_SHIFT - 1);
+    }
+}
+
+static void fz__tlsf_insert(fz_Tlsf *tlsf, fz_Tlsf_Block *block) {
+    int fl, sl;
+    fz__tlsf_mapping(fz__tlsf_size(block), &fl, &sl);
+
+    fz_Tlsf_Block *head = tlsf->blocks[fl][sl];
+    block->next_free = head;
+    block->prev_free = NULL;
+    if (head) head->prev_free = block;
+
+    tlsf->blocks[fl][sl] = block;
+    tlsf->fl_bitmap     |= (1u << fl);
+    tlsf->sl_bitmap[fl] |= (1u << sl);
+}
+
+static void fz__tlsf_remove(fz_Tlsf *tlsf, fz_Tlsf_Block *block) {
+    int fl, sl;
+    fz__tlsf_mapping(fz__tlsf_size(block), &fl, &sl);
+
+    if (block->next_free) block->next_free->prev_free = block->prev_free;
+    if (block->prev_free) block->prev_free->next_free = block->next_free;
+
+    if (tlsf->blocks[fl][sl] == block) {
+        tlsf->blocks[fl][sl] = block->next_free;
+        if (!block->next_free) {
+            tlsf->sl_bitmap[fl] &= ~(1u << sl);
+            if (!tlsf->sl_bitmap[fl]) tlsf->fl_bitmap &= ~(1u << fl);
+        }
+    }
+}
+
+static inline void fz__tlsf_mark_free(fz_Tlsf_Block *block) {
+    block->size |= fz_TLSF_BLOCK_FREE;
+
+    fz_Tlsf_Block *next = fz__tlsf_next_phys(block);
+    next->prev_phys = block;
+    next->size |= fz_TLSF_BLOCK_PREV_FREE;
+}
+
+static inline void fz__tlsf_mark_used(fz_Tlsf_Block *block) {
+    block->size &= ~fz_TLSF_BLOCK_FREE;
+    fz__tlsf_next_phys(block)->size &= ~fz_TLSF_BLOCK_PREV_FREE;
+}
+
+// Cuts the tail of a used block beyond `size` into a free block, if it's big enough to be one.
+static void fz__tlsf_trim_used(fz_Tlsf *tlsf, fz_Tlsf_Block *block, size_t size) {
+    size_t block_size = fz__tlsf_size(block);
+    if (block_size < size + sizeof(fz_Tlsf_Block)) return;
+
+    fz_Tlsf_Block *remain = (fz_Tlsf_Block *)((uint8_t *)block + fz_TLSF_HEADER_SIZE + size);
+    remain->size      = block_size - size - fz_TLSF_HEADER_SIZE;
+    remain->prev_phys = block;
+    fz__tlsf_set_size(block, size);
+
+    // block is used, so remain never has a free previous block.
+    // a free block after it is possible when shrinking, so merge that one in.
+    fz_Tlsf_Block *next = fz__tlsf_next_phys(remain);
+    if (next->size & fz_TLSF_BLOCK_FREE) {
+        fz__tlsf_remove(tlsf, next);
+        remain->size += fz_TLSF_HEADER_SIZE + fz__tlsf_size(next);
+    }
+
+    fz__tlsf_mark_free(remain);
+    fz__tlsf_insert(tlsf, remain);
+}
+
+void fz_tlsf_init(fz_Tlsf *tlsf, void *backing_memory, size_t memory_size) {
+    memset(tlsf, 0, sizeof(*tlsf));
+    tlsf->base        = backing_memory;
+    tlsf->memory_caps = memory_size;
+
+    uintptr_t rounded_up = fz_align_to_power_of_two((uintptr_t)backing_memory, (size_t)1 << fz_TLSF_ALIGN_LOG2);
+    size_t usable = memory_size - (size_t)(rounded_up - (uintptr_t)backing_memory);
+    assert(usable >= 2 * fz_TLSF_HEADER_SIZE + fz_TLSF_MIN_PAYLOAD);
+
+    // one big free block, followed by a zero-sized used block so the last block always has a next.
+    size_t payload = (usable - 2 * fz_TLSF_HEADER_SIZE) & ~(((size_t)1 << fz_TLSF_ALIGN_LOG2) - 1);
+    if (payload >= ((size_t)1 << fz_TLSF_FL_MAX)) payload = ((size_t)1 << fz_TLSF_FL_MAX) - ((size_t)1 << fz_TLSF_ALIGN_LOG2);
+
+    fz_Tlsf_Block *block = (fz_Tlsf_Block *)rounded_up;
+    block->prev_phys = NULL;
+    block->size      = payload;
+
+    fz_Tlsf_Block *sentinel = fz__tlsf_next_phys(block);
+    sentinel->size = 0;
+
+    fz__tlsf_mark_free(block);
+    fz__tlsf_insert(tlsf, block);
+}
+
+fz_Allocator fz_tlsf_allocator(fz_Tlsf *tlsf) {
+    fz_Allocator allocator;
+    allocator.user_data = tlsf;
+    allocator.oper_func = fz_tlsf_operation;
+    return allocator;
+}
+
+fz_OPER_FUNC(fz_tlsf_operation) {
+    fz_Tlsf *tlsf = (fz_Tlsf *)user_data;
+
+    size_t adjusted = fz_align_to_power_of_two(size, (size_t)1 << fz_TLSF_ALIGN_LOG2);
+    if (adjusted < fz_TLSF_MIN_PAYLOAD) adjusted = fz_TLSF_MIN_PAYLOAD;
+
+    switch(op) {
+        case fz_MEMORY_OPER_ALLOCATE:
+        {
+            // round up to the next class so that any block in the found list is big enough.
+            size_t searching = adjusted;
+            if (searching >= fz_TLSF_SMALL_BLOCK) {
+                searching += ((size_t)1 << (31 - fz_clz32((uint32_t)searching) - fz_TLSF_SL_COUNT_LOG2)) - 1;
+            }
+            if (searching >= ((size_t)1 << fz_TLSF_FL_MAX)) return NULL;
+
+            int fl, sl;
+            fz__tlsf_mapping(searching, &fl, &sl);
+
+            uint32_t sl_map = tlsf->sl_bitmap[fl] & (~0u << sl);
+            if (!sl_map) {
+                uint32_t fl_map = (fl + 1 < 32) ? (tlsf->fl_bitmap & (~0u << (fl + 1))) : 0;
+                if (!fl_map) return NULL; // Too big. fail.
+
+                fl     = fz_ctz32(fl_map);
+                sl_map = tlsf->sl_bitmap[fl];
+            }
+            sl = fz_ctz32(sl_map);
+
+            fz_Tlsf_Block *block = tlsf->blocks[fl][sl];
+            assert(block && fz__tlsf_size(block) >= adjusted);
+
+            fz__tlsf_remove(tlsf, block);
+            fz__tlsf_mark_used(block);
+            fz__tlsf_trim_used(tlsf, block, adjusted);
+
+            return (uint8_t *)block + fz_TLSF_HEADER_SIZE;
+        } break;
+
+        case fz_MEMORY_OPER_FREE:
+        {
+            assert(tlsf->base <= ptr && ptr < ((uint8_t *)tlsf->base + tlsf->memory_caps));
+            fz_Tlsf_Block *block = (fz_Tlsf_Block *)((uint8_t *)ptr - fz_TLSF_HEADER_SIZE);
+            assert(!(block->size & fz_TLSF_BLOCK_FREE) && "double free on tlsf allocator.");
+
+            // Coalesce both ways; free blocks never sit next to each other.
+            if (block->size & fz_TLSF_BLOCK_PREV_FREE) {
+                fz_Tlsf_Block *prev = block->prev_phys;
+                fz__tlsf_remove(tlsf, prev);
+                fz__tlsf_set_size(prev, fz__tlsf_size(prev) + fz_TLSF_HEADER_SIZE + fz__tlsf_size(block));
+                block = prev;
+            }
+
+            fz_Tlsf_Block *next = fz__tlsf_next_phys(block);
+            if (next->size & fz_TLSF_BLOCK_FREE) {
+                fz__tlsf_remove(tlsf, next);
+                fz__tlsf_set_size(block, fz__tlsf_size(block) + fz_TLSF_HEADER_SIZE + fz__tlsf_size(next));
+            }
+
+            fz__tlsf_mark_free(block);
+            fz__tlsf_insert(tlsf, block);
+        } break;
+
+        case fz_MEMORY_OPER_REALLOCATE:
+        {
+            fz_Tlsf_Block *block = (fz_Tlsf_Block *)((uint8_t *)ptr - fz_TLSF_HEADER_SIZE);
+            size_t block_size = fz__tlsf_size(block);
+
+            if (adjusted <= block_size) {
+                fz__tlsf_trim_used(tlsf, block, adjusted);
+                return ptr;
+            }
+
+            // grow in place by eating the next block if it's free and big enough.
+            fz_Tlsf_Block *next = fz__tlsf_next_phys(block);
+            if ((next->size & fz_TLSF_BLOCK_FREE) && (block_size + fz_TLSF_HEADER_SIZE + fz__tlsf_size(next)) >= adjusted) {
+                fz__tlsf_remove(tlsf, next);
+                fz__tlsf_set_size(block, block_size + fz_TLSF_HEADER_SIZE + fz__tlsf_size(next));
+                fz__tlsf_mark_used(block);
+                fz__tlsf_trim_used(tlsf, block, adjusted);
+                return ptr;
+            }
+
+            void *new_memory = fz_tlsf_operation(fz_MEMORY_OPER_ALLOCATE, 0, 0, size, user_data);
+            if (new_memory) {
+                memcpy(new_memory, ptr, block_size);
+                fz_tlsf_operation(fz_MEMORY_OPER_FREE, ptr, 0, 0, user_data);
+            }
+            return new_memory;
+        } break;
+    }
+
+    return NULL;
+}
+
+/*
+ * ==================================================
+ * Buddy Allocator.
+ * ==================================================
+ * */
+
+static void fz__buddy_push(fz_Buddy *buddy, uint8_t *block, int level) {
+    fz_Buddy_Node *node = (fz_Buddy_Node *)block;
+    node->prev = NULL;
+    node->next = buddy->free_lists[level];
+    if (node->next) node->next->prev = node;
+    buddy->free_lists[level] = node;
+
+    buddy->block_info[(block - buddy->base) / buddy->min_block_size] = (uint8_t)(level | fz_BUDDY_FREE_FLAG);
+    buddy->free_bytes += buddy->min_block_size << level;
+}
+
+static void fz__buddy_remove(fz_Buddy *buddy, uint8_t *block, int level) {
+    fz_Buddy_Node *node = (fz_Buddy_Node *)block;
+    if (node->prev) node->prev->next = node->next;
+    else            buddy->free_lists[level] = node->next;
+    if (node->next) node->next->prev = node->prev;
+
+    buddy->free_bytes -= buddy->min_block_size << level;
+}
+
+void fz_buddy_init(fz_Buddy *buddy, void *backing_memory, size_t memory_size, size_t min_block_size) {
+    assert((min_block_size & (min_block_size - 1)) == 0 && min_block_size >= sizeof(fz_Buddy_Node));
+    memset(buddy, 0, sizeof(*buddy));
+
+    uint8_t *backing = (uint8_t *)backing_memory;
+    uint8_t *end     = backing + memory_size;
+    size_t info_size = memory_size / min_block_size;
+
+    buddy->block_info     = backing;
+    buddy->base           = (uint8_t *)fz_align_to_power_of_two((uintptr_t)(backing + info_size), min_block_size);
+    assert(buddy->base < end && "Backing memory is too small for the buddy allocator.");
+    buddy->size           = ((size_t)(end - buddy->base) / min_block_size) * min_block_size;
+    buddy->min_block_size = min_block_size;
+    memset(buddy->block_info, 0, info_size);
+
+    while (buddy->level_count < fz_BUDDY_MAX_LEVELS && (min_block_size << buddy->level_count) <= buddy->size) {
+        buddy->level_count++;
+    }
+
+    // cover the region with the biggest naturally aligned blocks that fit; the tail of a
+    // non power of two region simply has buddies that are never free.
+    size_t offset = 0;
+    while (offset + min_block_size <= buddy->size) {
+        int level = buddy->level_count - 1;
+        while (level > 0 && ((offset & ((min_block_size << level) - 1)) || offset + (min_block_size << level) > buddy->size)) {
+            level--;
+        }
+        fz__buddy_push(buddy, buddy->base + offset, level);
+        offset += min_block_size << level;
+    }
+}
+
+fz_Allocator fz_buddy_allocator(fz_Buddy *buddy) {
+    fz_Allocator allocator;
+    allocator.user_data = buddy;
+    allocator.oper_func = fz_buddy_operation;
+    return allocator;
+}
+
+size_t fz_buddy_largest_free(fz_Buddy *buddy) {
+    for (int level = buddy->level_count - 1; level >= 0; --level) {
+        if (buddy->free_lists[level]) return buddy->min_block_size << level;
+    }
+    return 0;
+}
+
+static int fz__buddy_level_for(fz_Buddy *buddy, size_t size) {
+    int level = 0;
+    while ((buddy->min_block_size << level) < size) level++;
+    return level;
+}
+
+fz_OPER_FUNC(fz_buddy_operation) {
+    fz_Buddy *buddy = (fz_Buddy *)user_data;
+
+    switch(op) {
+        case fz_MEMORY_OPER_ALLOCATE:
+        {
+            int level = fz__buddy_level_for(buddy, size);
+
+            int found = level;
+            while (found < buddy->level_count && !buddy->free_lists[found]) found++;
+            if (found >= buddy->level_count) return NULL; // Too big or out of memory.
+
+            uint8_t *block = (uint8_t *)buddy->free_lists[found];
+            fz__buddy_remove(buddy, block, found);
+
+            // split down, the upper halves go back on the free lists.
+            while (found > level) {
+                found--;
+                fz__buddy_push(buddy, block + (buddy->min_block_size << found), found);
+            }
+
+            buddy->block_info[(block - buddy->base) / buddy->min_block_size] = (uint8_t)level;
+            return block;
+        } break;
+
+        case fz_MEMORY_OPER_FREE:
+        {
+            assert(buddy->base <= ptr && ptr < (buddy->base + buddy->size));
+            size_t offset = (size_t)((uint8_t *)ptr - buddy->base);
+            size_t index  = offset / buddy->min_block_size;
+            int    level  = buddy->block_info[index];
+            assert(!(level & fz_BUDDY_FREE_FLAG) && "double free on buddy allocator.");
+            buddy->block_info[index] = 0;
+
+            while (level + 1 < buddy->level_count) {
+                size_t block_size   = buddy->min_block_size << level;
+                size_t buddy_offset = offset ^ block_size;
+                if (buddy_offset + block_size > buddy->size) break;
+
+                size_t buddy_index = buddy_offset / buddy->min_block_size;
+                if (buddy->block_info[buddy_index] != (level | fz_BUDDY_FREE_FLAG)) break;
+
+                fz__buddy_remove(buddy, buddy->base + buddy_offset, level);
+                buddy->block_info[buddy_index] = 0;
+                if (buddy_offset < offset) offset = buddy_offset;
+                level++;
+            }
+
+            fz__buddy_push(buddy, buddy->base + offset, level);
+        } break;
+
+        case fz_MEMORY_OPER_REALLOCATE:
+        {
+            assert(buddy->base <= ptr && ptr < (buddy->base + buddy->size));
+            int level = buddy->block_info[((uint8_t *)ptr - buddy->base) / buddy->min_block_size];
+            size_t block_size = buddy->min_block_size << level;
+            if (size <= block_size) return ptr;
+
+            void *new_memory = fz_buddy_operation(fz_MEMORY_OPER_ALLOCATE, 0, 0, size, user_data);
+            if (new_memory) {
+                memcpy(new_memory, ptr, old_size < block_size ? old_size : block_size);
+                fz_buddy_operation(fz_MEMORY_OPER_FREE, ptr, 0, 0, user_data);
+            }
+            return new_memory;
+        } break;
+    }
+
+    return NULL;
+}
+
+/*
+ * ==================================================
+ * Ring Allocator.
+ * ==================================================
+ * */
+
+#define fz_RING_RELEASED_FLAG ((size_t)1)
+#define fz_RING_HEADER_SIZE   (fz_align_to_power_of_two(sizeof(fz_Ring_Header), fz_PUSH_ALIGNMENT))
+
+void fz_ring_init(fz_Ring *ring, void *backing_memory, size_t memory_size) {
+    uintptr_t rounded_up = fz_align_to_power_of_two((uintptr_t)backing_memory, fz_PUSH_ALIGNMENT);
+    size_t    lost       = (size_t)(rounded_up - (uintptr_t)backing_memory);
+    assert(memory_size > lost + fz_RING_HEADER_SIZE);
+
+    ring->base        = (uint8_t *)rounded_up;
+    ring->memory_size = (memory_size - lost) & ~((size_t)fz_PUSH_ALIGNMENT - 1);
+    ring->alloc       = ring->base;
+    ring->free        = ring->base;
+    ring->used        = 0;
+    ring->frame       = 0;
 }
 
-void fz_end_temp(fz_Temp_Memory scratch) {
-    scratch.arena->used = scratch.used_before;
+fz_Allocator fz_ring_allocator(fz_Ring *ring) {
+    fz_Allocator allocator;
+    allocator.user_data = ring;
+    allocator.oper_func = fz_ring_operation;
+    return allocator;
+}
+
+void fz_ring_begin_frame(fz_Ring *ring, uint64_t frame) {
+    assert(ring->frame <= frame);
+    ring->frame = frame;
 }
 
 /*
- * ==================================================
- * Stack Allocator.
- * ==================================================
+ * Walks from the tail and drops every block that is either released or
+ * allocated at/before retire_frame. stops at the first block still in use,
+ * so the memory is always handed back in FIFO order.
  * */
+static void fz__ring_advance_tail(fz_Ring *ring, int retiring, uint64_t retire_frame) {
+    uint8_t *end = ring->base + ring->memory_size;
+
+    while(ring->used > 0) {
+        size_t to_end = (size_t)(end - ring->free);
+
+        // not even a header fits in here: this was skipped over when the head wrapped around.
+        if (to_end < fz_RING_HEADER_SIZE) {
+            ring->used -= to_end;
+            ring->free  = ring->base;
+            continue;
+        }
+
+        fz_Ring_Header *header = (fz_Ring_Header *)ring->free;
+        size_t block_size = header->size & ~fz_RING_RELEASED_FLAG;
+        int    releasable = (header->size & fz_RING_RELEASED_FLAG) || (retiring && header->frame <= retire_frame);
+        if (!releasable) break;
+
+        assert(block_size <= ring->used);
+        ring->used -= block_size;
+        ring->free += block_size;
+        if (ring->free == end) ring->free = ring->base;
+    }
 
-void fz_stack_init(fz_StackAlloc *stackalloc, void *backing_memory, size_t memory_size) {
-    stackalloc->base = (uint8_t *)backing_memory;
-    stackalloc->caps = memory_size;
-    stackalloc->prev = 0;
-    stackalloc->current = 0;
+    if (ring->used == 0) {
+        ring->alloc = ring->base;
+        ring->free  = ring->base;
+    }
 }
 
-fz_Allocator fz_stack_allocator(fz_StackAlloc *stackalloc) {
-    fz_Allocator result;
-    result.user_data = (void *)stackalloc;
-    result.oper_func = fz_stack_operation;
-    return result;
+void fz_ring_retire(fz_Ring *ring, uint64_t frame) {
+    fz__ring_advance_tail(ring, 1, frame);
 }
 
-fz_OPER_FUNC(fz_stack_operation) {
-    fz_StackAlloc *stack = (fz_StackAlloc *)user_data;
+fz_OPER_FUNC(fz_ring_operation) {
+    fz_Ring *ring = (fz_Ring *)user_data;
+    uint8_t *end  = ring->base + ring->memory_size;
 
     switch(op) {
         case fz_MEMORY_OPER_ALLOCATE:
         {
-            size_t new_size = size + sizeof(fz_Stack_Header);
-            uintptr_t unaligned_ptr = (uintptr_t)(stack->base + stack->current);
-            uintptr_t memory_ptr = fz_align_to_power_of_two(unaligned_ptr, fz_PUSH_ALIGNMENT);
+            size_t block_size = fz_align_to_power_of_two(fz_RING_HEADER_SIZE + size, fz_PUSH_ALIGNMENT);
 
-            ptrdiff_t remainder = memory_ptr - unaligned_ptr;
-            assert(remainder >= 0);
-            assert((stack->current + remainder + new_size) < stack->caps);
+            if (ring->used == 0) {
+                ring->alloc = ring->base;
+                ring->free  = ring->base;
+            }
 
-            fz_Stack_Header *memory = (fz_Stack_Header *)memory_ptr;
+            uint8_t *memory = NULL;
+            if (ring->free < ring->alloc || ring->used == 0) {
+                // free space is split in two: [alloc, end) and [base, free).
+                size_t to_end = (size_t)(end - ring->alloc);
+
+                if (block_size <= to_end) {
+                    memory = ring->alloc;
+                } else if (block_size <= (size_t)(ring->free - ring->base)) {
+                    // Wrap around. the remainder at the end is accounted as used,
+                    // and is skipped over by the tail when it gets there.
+                    if (to_end >= fz_RING_HEADER_SIZE) {
+                        fz_Ring_Header *skip = (fz_Ring_Header *)ring->alloc;
+                        skip->size  = to_end | fz_RING_RELEASED_FLAG;
+                        skip->frame = ring->frame;
+                    }
+                    ring->used += to_end;
+                    memory = ring->base;
+                }
+            } else {
+                // free space is [alloc, free). if alloc == free and used != 0, ring is full.
+                if (block_size <= (size_t)(ring->free - ring->alloc)) {
+                    memory = ring->alloc;
+                }
+            }
 
-            memory->prev_offset = stack->prev;
-            memory->padding     = remainder;
+            // Out of memory: caller has to retire older frames first.
+            if (!memory) return NULL;
 
-            stack->prev     = stack->current;
-            stack->current += new_size + remainder;
-            stack->caps    += new_size + remainder;
+            fz_Ring_Header *header = (fz_Ring_Header *)memory;
+            header->size  = block_size;
+            header->frame = ring->frame;
 
-            return (void *)(memory + 1);
+            ring->alloc = memory + block_size;
+            ring->used += block_size;
+            if (ring->alloc == end) ring->alloc = ring->base;
+
+            return (void *)(memory + fz_RING_HEADER_SIZE);
         } break;
 
         case fz_MEMORY_OPER_FREE:
         {
-            assert(stack->base <= ptr && ptr <= (stack->base + stack->caps));
-            fz_Stack_Header *header = (fz_Stack_Header *)ptr - 1;
-            size_t header_placed_in = ((size_t)header - header->padding - (size_t)stack->base);
-            assert(stack->prev == header_placed_in && "Order difference: stack free must follow LIFO rules.");
+            assert(ring->base <= (uint8_t *)ptr && (uint8_t *)ptr < end);
+            fz_Ring_Header *header = (fz_Ring_Header *)((uint8_t *)ptr - fz_RING_HEADER_SIZE);
+            assert(!(header->size & fz_RING_RELEASED_FLAG) && "double free on ring allocator.");
 
-            stack->current = stack->prev;
-            stack->prev = header->prev_offset;
-            stack->caps -= stack->current - stack->prev;
+            // Out of order frees are only marked; the memory comes back once everything before it is gone.
+            header->size |= fz_RING_RELEASED_FLAG;
+            fz__ring_advance_tail(ring, 0, 0);
         } break;
 
         case fz_MEMORY_OPER_REALLOCATE:
         {
-            assert(stack->base <= ptr && ptr <= (stack->base + stack->caps));
-            fz_Stack_Header *header = (fz_Stack_Header *)ptr - 1;
-            size_t header_placed_in = ((size_t)header - header->padding - (size_t)stack->base);
-            assert(stack->prev == header_placed_in && "Order difference: stack free must follow LIFO rules.");
-
-            size_t allocation_size = stack->prev - stack->current;
-            if (allocation_size < size) {
-                stack->current += size - allocation_size;
+            assert(ring->base <= (uint8_t *)ptr && (uint8_t *)ptr < end);
+            fz_Ring_Header *header = (fz_Ring_Header *)((uint8_t *)ptr - fz_RING_HEADER_SIZE);
+            size_t block_size = header->size;
+            size_t new_block  = fz_align_to_power_of_two(fz_RING_HEADER_SIZE + size, fz_PUSH_ALIGNMENT);
+
+            if (new_block <= block_size) return ptr;
+
+            // ptr is the latest allocation and can be extended in place.
+            uint8_t *block_end = (uint8_t *)header + block_size;
+            if (block_end == ring->alloc) {
+                uint8_t *limit = (ring->free <= (uint8_t *)header) ? end : ring->free;
+                if ((uint8_t *)header + new_block <= limit) {
+                    ring->used  += new_block - block_size;
+                    header->size = new_block;
+                    ring->alloc  = (uint8_t *)header + new_block;
+                    if (ring->alloc == end) ring->alloc = ring->base;
+                    return ptr;
+                }
             }
 
-            return ptr;
+            void *new_memory = fz_ring_operation(fz_MEMORY_OPER_ALLOCATE, 0, 0, size, user_data);
+            if (new_memory) {
+                size_t copying = block_size - fz_RING_HEADER_SIZE;
+                if (old_size && old_size < copying) copying = old_size;
+
+                memmove(new_memory, ptr, copying);
+                fz_ring_operation(fz_MEMORY_OPER_FREE, ptr, 0, 0, user_data);
+            }
+            return new_memory;
         } break;
     }
 
@@ -812,210 +4205,550 @@ fz_OPER_FUNC(fz_stack_operation) {
 
 /*
  * ==================================================
- * Pool Allocator.
+ * Tracking Allocator.
  * ==================================================
  * */
 
-void fz_pool_init(fz_Pool *pool, void *backing_memory, size_t memory_size, size_t element_size) {
-    assert(memory_size  > sizeof(fz_SLL_Header));
-    assert(element_size > sizeof(fz_SLL_Header));
+#define fz_TRACKER_HEADER_SIZE (fz_align_to_power_of_two(sizeof(fz_Tracker_Header), fz_PUSH_ALIGNMENT))
 
-    uint8_t *backing = (uint8_t *)backing_memory;
-    size_t available_count = memory_size / element_size; // any fractions will get rounded down to 0.
-    memset(backing, 0, memory_size);
+void fz_tracker_init(fz_Tracker *tracker, fz_Allocator backing, const char *name) {
+    memset(tracker, 0, sizeof(*tracker));
+    tracker->backing     = backing;
+    tracker->name        = name;
+    // room for every site up front: tracking must never allocate after init, or it trips the allocation guard it feeds.
+    tracker->site_lookup = fz_Map_CreateEx(int, fz_TRACKER_MAX_SITES, fz_heap_allocator());
 
-    // NOTE:
-    // available_count - 1 means that the last one of the sll header
-    // will be left resetted to zero from the memset above;
-    // effectively leaving the next member variable to NULL
-    for (int i = 0; i < available_count - 1; ++i) {
-        size_t memory_position = i * element_size;
-        fz_SLL_Header *current = (fz_SLL_Header *)(backing + memory_position);
-        current->next = (fz_SLL_Header *)(backing + memory_position + element_size);
-    }
+    tracker->sites[0].site = "(unknown:0)";
+    tracker->site_count    = 1;
+    fz_alloc_site = 0;
+}
 
-    pool->base         = backing;
-    pool->element_size = element_size;
-    pool->memory_caps  = memory_size;
-    pool->free         = (fz_SLL_Header *)backing;
+void fz_tracker_release(fz_Tracker *tracker) {
+    fz_Map_Release(tracker->site_lookup);
+    tracker->site_lookup = NULL;
 }
 
-fz_Allocator fz_pool_allocator(fz_Pool *pool) {
+fz_Allocator fz_tracker_allocator(fz_Tracker *tracker) {
     fz_Allocator allocator;
-    allocator.user_data = pool;
-    allocator.oper_func = fz_pool_operation;
-
+    allocator.user_data = tracker;
+    allocator.oper_func = fz_tracker_operation;
     return allocator;
 }
 
-fz_OPER_FUNC(fz_pool_operation) {
+void fz_tracker_next_frame(fz_Tracker *tracker) {
+    tracker->last_frame_alloc_count = tracker->frame_alloc_count;
+    tracker->last_frame_bytes       = tracker->frame_bytes;
+    tracker->frame_alloc_count      = 0;
+    tracker->frame_bytes            = 0;
+
+    for (int i = 0; i < tracker->site_count; ++i) {
+        tracker->sites[i].frame_alloc_count = 0;
+    }
+}
+
+void fz_tracker_reset_in_use(fz_Tracker *tracker) {
+    tracker->bytes_in_use = 0;
+    for (int i = 0; i < tracker->site_count; ++i) {
+        tracker->sites[i].bytes_in_use = 0;
+        tracker->sites[i].live_count   = 0;
+    }
+}
+
+int fz_tracker_top_sites(fz_Tracker *tracker, fz_Tracker_Site **out, int count) {
+    int written = 0;
+    for (int i = 0; i < tracker->site_count; ++i) {
+        fz_Tracker_Site *site = &tracker->sites[i];
+        if (!site->bytes_in_use) continue;
+
+        // insertion into a tiny sorted array.
+        int at = (written < count) ? written++ : count;
+        while (at > 0 && out[at - 1]->bytes_in_use < site->bytes_in_use) {
+            if (at < count) out[at] = out[at - 1];
+            at--;
+        }
+        if (at < count) out[at] = site;
+    }
+    return written;
+}
+
+static size_t fz__tracker_site_index(fz_Tracker *tracker, const char *site) {
+    if (!site) return 0;
+
+    uint64_t key = (uint64_t)(uintptr_t)site;
+    ptrdiff_t found = fz_Map_Find(tracker->site_lookup, key);
+    if (found >= 0) return (size_t)tracker->site_lookup[found];
+
+    if (tracker->site_count == fz_TRACKER_MAX_SITES) return 0;
+
+    int index = tracker->site_count++;
+    memset(&tracker->sites[index], 0, sizeof(fz_Tracker_Site));
+    tracker->sites[index].site = site;
+    // not fz_Map_Put: the table never grows (see fz_tracker_init), and fz_MARK_SITE would overwrite the caller's site.
+    tracker->site_lookup[fz__map_insert(fz_Map_Header(tracker->site_lookup), key)] = index;
+
+    return (size_t)index;
+}
+
+static void fz__tracker_count_alloc(fz_Tracker *tracker, size_t site_index, size_t size) {
+    fz_Tracker_Site *site = &tracker->sites[site_index];
+    site->bytes_in_use += size;
+    site->live_count   += 1;
+    site->total_bytes  += size;
+    site->alloc_count  += 1;
+    site->frame_alloc_count += 1;
+
+    tracker->bytes_in_use += size;
+    tracker->alloc_count  += 1;
+    tracker->frame_alloc_count += 1;
+    tracker->frame_bytes  += size;
+    if (tracker->bytes_in_use > tracker->high_water) tracker->high_water = tracker->bytes_in_use;
+}
+
+static void fz__tracker_count_free(fz_Tracker *tracker, size_t site_index, size_t size) {
+    fz_Tracker_Site *site = &tracker->sites[site_index];
+
+    // after fz_tracker_reset_in_use these may already be gone.
+    site->bytes_in_use    -= (size <= site->bytes_in_use) ? size : site->bytes_in_use;
+    site->live_count      -= (site->live_count > 0);
+    tracker->bytes_in_use -= (size <= tracker->bytes_in_use) ? size : tracker->bytes_in_use;
+    tracker->free_count   += 1;
+}
+
+fz_OPER_FUNC(fz_tracker_operation) {
     fz_UNUSED(old_size);
-    fz_Pool *pool = (fz_Pool *)user_data;
+    fz_Tracker *tracker = (fz_Tracker *)user_data;
 
+    // NOTE(fuzzy): fz_alloc_site is left alone until the backing allocator returns,
+    // so whatever sits below (e.g. the allocation guard) can still see it.
+    const char *site = fz_alloc_site;
+
+    void *result = NULL;
     switch(op) {
         case fz_MEMORY_OPER_ALLOCATE:
         {
-            assert(size == pool->element_size);
-            fz_SLL_Header *available_chunk = pool->free;
+            uint8_t *memory = (uint8_t *)fz_alloc_ex(tracker->backing, fz_TRACKER_HEADER_SIZE + size);
+            if (!memory) break;
 
-            if (pool->free)
-                pool->free = pool->free->next;
+            fz_Tracker_Header *header = (fz_Tracker_Header *)memory;
+            header->size       = size;
+            header->site_index = fz__tracker_site_index(tracker, site);
+            fz__tracker_count_alloc(tracker, header->site_index, size);
 
-            memset(available_chunk, 0, size);
-            return (void *)available_chunk;
-        };
+            result = memory + fz_TRACKER_HEADER_SIZE;
+        } break;
 
         case fz_MEMORY_OPER_FREE:
         {
-            assert(pool->base <= ptr && ptr < (pool->base + pool->memory_caps));
-            memset(ptr, 0, pool->element_size);
+            fz_Tracker_Header *header = (fz_Tracker_Header *)((uint8_t *)ptr - fz_TRACKER_HEADER_SIZE);
+            fz__tracker_count_free(tracker, header->site_index, header->size);
+            fz_free_ex(tracker->backing, header);
+        } break;
 
-            fz_SLL_Header freed;
-            freed.next = pool->free;
+        case fz_MEMORY_OPER_REALLOCATE:
+        {
+            fz_Tracker_Header *header = (fz_Tracker_Header *)((uint8_t *)ptr - fz_TRACKER_HEADER_SIZE);
+            size_t previous_size = header->size;
+            size_t previous_site = header->site_index;
 
-            *(fz_SLL_Header *)ptr = freed;
-            pool->free = (fz_SLL_Header *)ptr;
+            uint8_t *memory = (uint8_t *)fz_realloc_ex(tracker->backing, header,
+                                                       fz_TRACKER_HEADER_SIZE + previous_size,
+                                                       fz_TRACKER_HEADER_SIZE + size);
+            if (!memory) break;
+
+            header = (fz_Tracker_Header *)memory;
+            header->size       = size;
+            header->site_index = site ? fz__tracker_site_index(tracker, site) : previous_site;
 
+            fz__tracker_count_free(tracker, previous_site, previous_size);
+            tracker->free_count -= 1; // it's one allocation moving, not a free.
+            fz__tracker_count_alloc(tracker, header->site_index, size);
+
+            result = memory + fz_TRACKER_HEADER_SIZE;
         } break;
+    }
 
-        case fz_MEMORY_OPER_REALLOCATE:
-        {
-            fz_UNREACHABLE_PATH;
-        };
+    // whatever the bookkeeping above marked does not belong to the next allocation.
+    fz_alloc_site = 0;
+    return result;
+}
+
+/*
+ * pprof's profile.proto, written by hand. only the fields pprof needs:
+ *   Profile  { 1: sample_type, 2: sample, 4: location, 5: function, 6: string_table }
+ *   Sample   { 1: location_id (packed), 2: value (packed) }
+ *   Location { 1: id, 4: line { 1: function_id, 2: line } }
+ *   Function { 1: id, 2: name, 3: system_name, 4: filename }
+ * */
+
+static void fz__pb_varint(fz_Vec(uint8_t) *out, uint64_t value) {
+    while (value >= 0x80) {
+        fz_Vec_Push(*out, (uint8_t)(value | 0x80));
+        value >>= 7;
     }
+    fz_Vec_Push(*out, (uint8_t)value);
+}
 
-    return NULL;
+static void fz__pb_uint(fz_Vec(uint8_t) *out, int field, uint64_t value) {
+    fz__pb_varint(out, (uint64_t)(field << 3) | 0);
+    fz__pb_varint(out, value);
+}
+
+static void fz__pb_bytes(fz_Vec(uint8_t) *out, int field, const void *data, size_t size) {
+    fz__pb_varint(out, (uint64_t)(field << 3) | 2);
+    fz__pb_varint(out, size);
+    for (size_t i = 0; i < size; ++i) fz_Vec_Push(*out, ((const uint8_t *)data)[i]);
+}
+
+// moves the content of message into out as field, and clears message for reuse.
+static void fz__pb_message(fz_Vec(uint8_t) *out, int field, fz_Vec(uint8_t) *message) {
+    fz__pb_bytes(out, field, *message, fz_Vec_Length(*message));
+    fz_Vec_Clear(*message);
+}
+
+int fz_tracker_dump_pprof(fz_Tracker *tracker, const char *path) {
+    FILE *file = fopen(path, "wb");
+    if (!file) return 0;
+
+    fz_Allocator heap = fz_heap_allocator();
+    fz_Vec(uint8_t) out = fz_Vec_CreateEx(uint8_t, 4096, heap);
+    fz_Vec(uint8_t) msg = fz_Vec_CreateEx(uint8_t, 256,  heap);
+    fz_Vec(uint8_t) sub = fz_Vec_CreateEx(uint8_t, 256,  heap);
+
+    // string table: 0 is always "". 1..8 are sample types; 9 onwards, 2 strings per site (name, filename).
+    const char *fixed_strings[] = {
+        "", "alloc_objects", "count", "alloc_space", "bytes", "inuse_objects", "count", "inuse_space", "bytes",
+    };
+    const int site_string_base = (int)fz_COUNTOF(fixed_strings);
+
+    for (int i = 0; i < 4; ++i) {
+        fz__pb_uint(&msg, 1, (uint64_t)(1 + i * 2));
+        fz__pb_uint(&msg, 2, (uint64_t)(2 + i * 2));
+        fz__pb_message(&out, 1, &msg);
+    }
+
+    for (int i = 0; i < tracker->site_count; ++i) {
+        fz_Tracker_Site *site = &tracker->sites[i];
+        if (!site->alloc_count) continue;
+
+        uint64_t values[4] = { site->alloc_count, site->total_bytes, site->live_count, site->bytes_in_use };
+        fz__pb_varint(&sub, (uint64_t)(i + 1));
+        fz__pb_message(&msg, 1, &sub);
+        for (int v = 0; v < 4; ++v) fz__pb_varint(&sub, values[v]);
+        fz__pb_message(&msg, 2, &sub);
+        fz__pb_message(&out, 2, &msg);
+    }
+
+    for (int i = 0; i < tracker->site_count; ++i) {
+        if (!tracker->sites[i].alloc_count) continue;
+
+        // "(file:line)" -> line number for the location.
+        const char *site  = tracker->sites[i].site;
+        const char *colon = strrchr(site, ':');
+        uint64_t line = colon ? (uint64_t)strtoull(colon + 1, 0, 10) : 0;
+
+        fz__pb_uint(&sub, 1, (uint64_t)(i + 1));
+        fz__pb_uint(&sub, 2, line);
+
+        fz__pb_uint(&msg, 1, (uint64_t)(i + 1));
+        fz__pb_message(&msg, 4, &sub);
+        fz__pb_message(&out, 4, &msg);
+
+        fz__pb_uint(&msg, 1, (uint64_t)(i + 1));
+        fz__pb_uint(&msg, 2, (uint64_t)(site_string_base + i * 2));
+        fz__pb_uint(&msg, 3, (uint64_t)(site_string_base + i * 2));
+        fz__pb_uint(&msg, 4, (uint64_t)(site_string_base + i * 2 + 1));
+        fz__pb_message(&out, 5, &msg);
+    }
+
+    for (int i = 0; i < site_string_base; ++i) {
+        fz__pb_bytes(&out, 6, fixed_strings[i], strlen(fixed_strings[i]));
+    }
+
+    for (int i = 0; i < tracker->site_count; ++i) {
+        const char *site = tracker->sites[i].site;
+        const char *colon = strrchr(site, ':');
+        const char *begin = (site[0] == '(') ? site + 1 : site;
+        size_t filename_length = colon ? (size_t)(colon - begin) : strlen(begin);
+
+        fz__pb_bytes(&out, 6, site, strlen(site));
+        fz__pb_bytes(&out, 6, begin, filename_length);
+    }
+
+    size_t written = fwrite(out, 1, fz_Vec_Length(out), file);
+    int ok = (written == (size_t)fz_Vec_Length(out));
+    fclose(file);
+
+    fz_Vec_Release(out);
+    fz_Vec_Release(msg);
+    fz_Vec_Release(sub);
+    fz_alloc_site = 0;
+    return ok;
 }
 
 /*
  * ==================================================
- * Freelist Allocator.
+ * Job System.
  * ==================================================
  * */
 
-void fz_freelist_init(fz_Freelist *freelist, void *backing_memory, size_t memory_size) {
-    freelist->base = backing_memory;
-    freelist->memory_caps = memory_size;
+fz_STATIC_ASSERT(sizeof(fz_Job) == fz_CACHE_LINE_SIZE);
+fz_STATIC_ASSERT((fz_JOB_CAPACITY & (fz_JOB_CAPACITY - 1)) == 0);
 
-    uintptr_t rounded_up = fz_align_to_power_of_two((uintptr_t)backing_memory, 16);
-    fz_ListNode *node = (fz_ListNode*) rounded_up;
-    node->size = memory_size - (ptrdiff_t)(rounded_up - (uintptr_t)backing_memory) - sizeof(fz_SizeHeader);
+static fz_THREAD_LOCAL fz_Job_Worker *fz__job_worker;
 
-    freelist->sentinel.size = 0;
-    freelist->sentinel.next = node;
-    freelist->sentinel.prev = node;
+// owner only.
+static void fz__job_deque_push(fz_Job_Deque *deque, fz_Job *job) {
+    uint64_t bottom = deque->bottom;
+    uint64_t top    = fz_atomic_load64(&deque->top);
+    assert(bottom - top < fz_JOB_CAPACITY && "Job deque is full; raise fz_JOB_CAPACITY.");
+    fz_UNUSED(top);
 
-    node->next = &freelist->sentinel;
-    node->prev = &freelist->sentinel;
+    fz_atomic_store64(&deque->jobs[bottom & (fz_JOB_CAPACITY - 1)], (uint64_t)(uintptr_t)job);
+    fz_atomic_store64(&deque->bottom, bottom + 1);
 }
 
-fz_Allocator fz_freelist_allocator(fz_Freelist *freelist) {
-    fz_Allocator allocator;
-    allocator.user_data = freelist;
-    allocator.oper_func = fz_freelist_operation;
-    return allocator;
+// owner only.
+static fz_Job *fz__job_deque_pop(fz_Job_Deque *deque) {
+    uint64_t bottom = deque->bottom - 1;
+    // seq_cst: thieves must see the new bottom before we look at top.
+    fz_atomic_exchange64(&deque->bottom, bottom);
+    uint64_t top = fz_atomic_load64(&deque->top);
+
+    if ((int64_t)(bottom - top) < 0) {
+        fz_atomic_store64(&deque->bottom, top);
+        return NULL;
+    }
+
+    fz_Job *job = (fz_Job *)(uintptr_t)fz_atomic_load64(&deque->jobs[bottom & (fz_JOB_CAPACITY - 1)]);
+    if (bottom != top) return job;
+
+    // last job: race the thieves for it.
+    if (fz_atomic_cas64(&deque->top, top, top + 1) != top) job = NULL;
+    fz_atomic_store64(&deque->bottom, top + 1);
+    return job;
 }
 
-fz_OPER_FUNC(fz_freelist_operation) {
-    fz_Freelist *list = (fz_Freelist *)user_data;
-    size_t size_pow2 = fz_align_to_power_of_two(size, 16);
+// any thread.
+static fz_Job *fz__job_deque_steal(fz_Job_Deque *deque) {
+    uint64_t top = fz_atomic_load64(&deque->top);
+    fz_atomic_fence();
+    uint64_t bottom = fz_atomic_load64(&deque->bottom);
 
-    switch(op) {
-        case fz_MEMORY_OPER_ALLOCATE:
-        {
-            fz_ListNode *current  = list->sentinel.next;
-            fz_ListNode *best_fit = list->sentinel.next;
+    if ((int64_t)(bottom - top) <= 0) return NULL;
 
-            while(current != &list->sentinel) {
-                if (size_pow2 == current->size) {
-                    best_fit = current;
-                    break;
-                }
+    fz_Job *job = (fz_Job *)(uintptr_t)fz_atomic_load64(&deque->jobs[top & (fz_JOB_CAPACITY - 1)]);
+    if (fz_atomic_cas64(&deque->top, top, top + 1) != top) return NULL; // somebody else got it.
+    return job;
+}
 
-                if (size_pow2 <= current->size && current->size < best_fit->size) {
-                    best_fit = current;
-                }
-                current = current->next;
-            }
-            // Too big. fail.
-            if (best_fit->size <= size_pow2) {
-                return NULL;
-            }
+static fz_Job *fz__job_find(fz_Job_Worker *worker) {
+    fz_Job *job = fz__job_deque_pop(&worker->deque);
+    if (job) return job;
 
-            if (best_fit->size >= (size_pow2 * 2)) {
-                // Cut size.
-                size_t fit_oldsize = best_fit->size;
-                best_fit->size = size_pow2;
-                fz_ListNode *remain_node = (fz_ListNode *)((char *)best_fit + sizeof(fz_SizeHeader) + size_pow2);
+    fz_Job_System *system = worker->system;
+    if (system->worker_count < 2) return NULL;
 
-                remain_node->size = fit_oldsize - size_pow2 - sizeof(fz_SizeHeader);
-                remain_node->next = best_fit->next;
-                remain_node->prev = best_fit->prev;
+    // start at a random victim, then try everyone once.
+    worker->random ^= worker->random << 13;
+    worker->random ^= worker->random >> 17;
+    worker->random ^= worker->random << 5;
+    int start = (int)(worker->random % (uint32_t)system->worker_count);
+    for (int i = 0; i < system->worker_count; ++i) {
+        int victim = (start + i) % system->worker_count;
+        if (victim == worker->index) continue;
 
-                best_fit->next->prev = remain_node;
-                best_fit->prev->next = remain_node;
-            } else {
-                best_fit->next->prev = best_fit->prev;
-                best_fit->prev->next = best_fit->next;
-            }
+        job = fz__job_deque_steal(&system->workers[victim].deque);
+        if (job) return job;
+    }
+    return NULL;
+}
 
-            fz_SizeHeader *header = (fz_SizeHeader *)best_fit;
-            header->size = best_fit->size;
-            return (void *)(header + 1);
-        } break;
+static void fz__job_finish(fz_Job *job) {
+    while (job) {
+        fz_Job *parent = job->parent;
+        // parent is read first: the moment unfinished hits 0 the slot may be handed out again.
+        if (fz_atomic_add32(&job->unfinished, (uint32_t)-1) != 1) return;
+        job = parent;
+    }
+}
 
-        case fz_MEMORY_OPER_FREE:
-        {
-            assert(list->base <= ptr && ptr < ((char *)list->base + list->memory_caps));
+static void fz__job_execute(fz_Job *job) {
+    if (job->func) {
+        fz_Temp_Memory scratch = fz_get_scratch(0, 0);
+        fz_Allocator old_temp = fz_set_temp_allocator(fz_arena_allocator(scratch.arena));
 
-            fz_SizeHeader *header = ((fz_SizeHeader*)ptr - 1);
-            size_t block_size = header->size;
+        job->func(job, job->user_data);
 
-            // Coalesce
-            fz_ListNode *node = list->sentinel.next;
-            fz_ListNode *coalesce = NULL;
+        fz_set_temp_allocator(old_temp);
+        fz_release_scratch(scratch);
+    }
+    fz__job_finish(job);
+}
 
-            while(node != &list->sentinel) {
-                if (node == (fz_ListNode *)((char *)ptr + block_size)) {
-                    coalesce = node;
-                    break;
-                }
-                node = node->next;
-            }
+static void fz__job_worker_main(void *user_data) {
+    fz_Job_Worker *worker = (fz_Job_Worker *)user_data;
+    fz_Job_System *system = worker->system;
+    fz__job_worker = worker;
+
+    int idle = 0;
+    while (fz_atomic_load32(&system->running)) {
+        fz_Job *job = fz__job_find(worker);
+        if (job) {
+            fz__job_execute(job);
+            idle = 0;
+            continue;
+        }
+
+        if (++idle < 64) {
+            fz_atomic_spin_pause();
+            continue;
+        }
+
+        // park. check once more after announcing it, fz_job_run looks at sleeping after its push.
+        fz_atomic_add32(&system->sleeping, 1);
+        job = fz__job_find(worker);
+        if (!job && fz_atomic_load32(&system->running)) fz_semaphore_wait(&system->wake);
+        fz_atomic_add32(&system->sleeping, (uint32_t)-1);
+        if (job) fz__job_execute(job);
+        idle = 0;
+    }
 
-            fz_ListNode *pushing = (fz_ListNode *)header;
-            if (coalesce) {
-                pushing->next = coalesce->next;
-                pushing->prev = coalesce->prev;
-                coalesce->next->prev = pushing;
-                coalesce->prev->next = pushing;
-                pushing->size = block_size + coalesce->size + sizeof(fz_SizeHeader);
-            } else {
-                pushing->size = block_size;
-                pushing->next = list->sentinel.next;
-                pushing->prev = list->sentinel.next->prev;
-                list->sentinel.next = pushing;
-            }
-        } break;
+    fz__job_worker = NULL;
+    fz_scratch_thread_release();
+}
 
-        case fz_MEMORY_OPER_REALLOCATE:
-        {
-            size_t block_size = ((fz_SizeHeader*)ptr - 1)->size;
-            assert(size > block_size);
+void fz_jobs_init(fz_Job_System *system, int thread_count, fz_Allocator allocator) {
+    memset(system, 0, sizeof(*system));
+    if (thread_count < 0)  thread_count = fz_thread_hardware_count() - 1;
+    if (thread_count < 0)  thread_count = 0;
+    if (thread_count > fz_JOB_MAX_WORKERS - 1) thread_count = fz_JOB_MAX_WORKERS - 1;
+
+    system->allocator    = allocator;
+    system->worker_count = thread_count + 1;
+    system->running      = 1;
+    fz_semaphore_init(&system->wake, 0);
+
+    system->workers = (fz_Job_Worker *)fz_alloc_ex(allocator, sizeof(fz_Job_Worker) * system->worker_count);
+    for (int i = 0; i < system->worker_count; ++i) {
+        fz_Job_Worker *worker = &system->workers[i];
+        memset(worker, 0, sizeof(*worker));
+        worker->system = system;
+        worker->index  = i;
+        worker->random = 0x9E3779B9u * (uint32_t)(i + 1);
+        worker->jobs   = (fz_Job *)fz_alloc_ex(allocator, sizeof(fz_Job) * fz_JOB_CAPACITY);
+        memset(worker->jobs, 0, sizeof(fz_Job) * fz_JOB_CAPACITY);
+    }
 
-            void *new_memory = fz_freelist_operation(fz_MEMORY_OPER_ALLOCATE, 0, 0, size, user_data);
+    fz__job_worker = &system->workers[0];
+    for (int i = 1; i < system->worker_count; ++i) {
+        system->threads[i] = fz_thread_create(fz__job_worker_main, &system->workers[i]);
+    }
+}
 
-            if (new_memory) {
-                memmove(new_memory, ptr, block_size);
-                fz_freelist_operation(fz_MEMORY_OPER_FREE, ptr, 0, 0, user_data);
-                return new_memory;
-            }
+void fz_jobs_shutdown(fz_Job_System *system) {
+    assert(fz__job_worker == &system->workers[0] && "Shut the job system down from the thread that started it.");
 
-            return NULL;
-        } break;
+    fz_atomic_store32(&system->running, 0);
+    fz_semaphore_signal(&system->wake, (uint32_t)system->worker_count);
+    for (int i = 1; i < system->worker_count; ++i) {
+        fz_thread_join(system->threads[i]);
     }
+    fz_semaphore_release(&system->wake);
 
-    return NULL;
+    for (int i = 0; i < system->worker_count; ++i) {
+        fz_free_ex(system->allocator, system->workers[i].jobs);
+    }
+    fz_free_ex(system->allocator, system->workers);
+    system->workers = NULL;
+    fz__job_worker  = NULL;
+}
+
+int fz_jobs_worker_index(void) {
+    return fz__job_worker ? fz__job_worker->index : -1;
+}
+
+fz_Job *fz_job_create(fz_Job_Func func, void *user_data, fz_Job *parent) {
+    fz_Job_Worker *worker = fz__job_worker;
+    assert(worker && "Jobs are created from worker threads only.");
+
+    fz_Job *job = &worker->jobs[worker->job_next++ & (fz_JOB_CAPACITY - 1)];
+    assert(fz_atomic_load32(&job->unfinished) == 0 && "Too many jobs in flight; raise fz_JOB_CAPACITY.");
+
+    if (parent) fz_atomic_add32(&parent->unfinished, 1);
+
+    job->func       = func;
+    job->user_data  = user_data;
+    job->parent     = parent;
+    job->worker     = (uint32_t)worker->index;
+    fz_atomic_store32(&job->unfinished, 1);
+    return job;
+}
+
+fz_Job *fz_job_create_copy(fz_Job_Func func, const void *data, size_t size, fz_Job *parent) {
+    assert(size <= fz_JOB_PAYLOAD_SIZE && "Job payload too big; pass a pointer instead.");
+    fz_Job *job = fz_job_create(func, 0, parent);
+    memcpy(job->payload, data, size);
+    job->user_data = job->payload;
+    return job;
+}
+
+void fz_job_run(fz_Job *job) {
+    fz_Job_Worker *worker = fz__job_worker;
+    assert(worker && "Jobs are run from worker threads only.");
+
+    fz__job_deque_push(&worker->deque, job);
+
+    // pairs with the sleeping check in fz__job_worker_main.
+    fz_atomic_fence();
+    if (fz_atomic_load32(&worker->system->sleeping)) fz_semaphore_signal(&worker->system->wake, 1);
+}
+
+int fz_job_finished(fz_Job *job) {
+    return fz_atomic_load32(&job->unfinished) == 0;
+}
+
+void fz_job_wait(fz_Job *job) {
+    fz_Job_Worker *worker = fz__job_worker;
+    assert(worker && "Only worker threads can wait on jobs.");
+
+    while (!fz_job_finished(job)) {
+        fz_Job *other = fz__job_find(worker);
+        if (other) {
+            fz__job_execute(other);
+        } else {
+            fz_thread_yield();
+        }
+    }
+}
+
+struct fz__Job_Range {
+    fz_Job_Range_Func func;
+    void             *user_data;
+    int               begin;
+    int               end;
+};
+
+static void fz__job_range(fz_Job *job, void *user_data) {
+    fz_UNUSED(job);
+    fz__Job_Range *range = (fz__Job_Range *)user_data;
+    range->func(range->user_data, range->begin, range->end);
+}
+
+void fz_jobs_parallel_for(int count, int batch_size, fz_Job_Range_Func func, void *user_data) {
+    if (count <= 0) return;
+    if (batch_size < 1) batch_size = 1;
+
+    fz_Job *root = fz_job_create(0, 0, 0);
+    for (int begin = 0; begin < count; begin += batch_size) {
+        fz__Job_Range range;
+        range.func      = func;
+        range.user_data = user_data;
+        range.begin     = begin;
+        range.end       = (count - begin > batch_size) ? begin + batch_size : count;
+        fz_job_run(fz_job_create_copy(fz__job_range, &range, sizeof(range), root));
+    }
+    fz_job_run(root);
+    fz_job_wait(root);
 }
 
 #else  // if !defined(fz_MINIMAL_FOOTPRINT) {...above block...} else
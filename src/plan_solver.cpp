@@ -0,0 +1,437 @@
+/*
+ * Plan solver: plays every way the player can plan stage one, on all cores, and reports the ones that clear it:
+ * how many, the fastest and the ones that keep the most health. every plan that can win goes to out_file, one per line.
+ * build: see build.sh / build.bat (dist/plan_solver).
+ * usage: plan_solver [out_file] [threads] [player_health]
+ *        threads: default one per core, 0 runs on this thread only. player_health: default what the stage sets.
+ *
+ * the game stops for planning at the start and after every enemy that dies: update()'s COMBAT_STATE_ENEMY_DIED and
+ * GOING_NEXT_PHASE go back to PLAYER_PLANNING. what's locked in stays, new actions get appended up to ACTION_CAPACITY
+ * and the buffer keeps playing from where it was. a schedule is the actions added at each stop, e.g. "SE|P||T":
+ * SE to begin with, P after the first kill, nothing after the second, T after the third. stops after the last
+ * added action are left off.
+ *
+ * NOTE(fuzzy): the reset button (clears the whole buffer, 3 per stage) isn't searched.
+ */
+
+#define FUZZY_MY_H_IMPL
+#include "my.h"
+
+#define FUZZY_COMBAT_H_IMPL
+#include "combat.h"
+
+#if defined(fz_OS_WINDOWS)
+#if !defined(fz_NO_WINDOWS_H)
+#include <windows.h>
+#endif
+#else
+#include <time.h>
+#endif
+
+static uint64_t time_now_ns() {
+#if defined(fz_OS_WINDOWS)
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (uint64_t)((double)counter.QuadPart * 1e9 / (double)frequency.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+#define PLAN_CHOICES    (ACTION_COUNT - ACTION_SLASH) /* ACTION_NONE is never planned. */
+#define REPORT_LIMIT    10                            /* plans printed per category. */
+#define SCHEDULE_LENGTH 64                            /* actions and '|'s; a stop comes after a kill. */
+
+/* stops with short plans have the most ways to go on: they're split up before the search starts. adding up to
+ * SPLIT_PLAN_COUNT actions is played right away, the rest goes to jobs RANGE_EXTENSIONS ways at a time. */
+#define SPLIT_PLAN_COUNT 4
+#define RANGE_EXTENSIONS 1024
+#define MAX_JOBS         1024 /* for fz_jobs_parallel_for, well under fz_JOB_CAPACITY. */
+
+/* a planning stop. enemies from chain_index / enemy_index on are as the stage has them. */
+struct Solver_Stop {
+    uint32_t plan;         /* combat_pack_plan layout. */
+    int32_t  turns;        /* fought before this stop. */
+    int16_t  health;
+    int8_t   plan_count;
+    int8_t   action_index;
+    int8_t   chain_index;
+    int8_t   enemy_index;
+    int8_t   replanned;    /* added actions after the first stop. */
+};
+
+struct Solver_Worker {
+    Combat   scratch;      /* own copy of the stage's enemies. */
+    uint64_t stops;        /* lock-ins played. */
+    uint64_t won;
+    uint64_t won_fixed;    /* without replanning. */
+    uint8_t  padding[fz_CACHE_LINE_SIZE];
+};
+
+/* extensions [begin, end) of stop, see solver_extensions. */
+struct Solver_Range {
+    Solver_Stop stop;
+    int         begin;
+    int         end;
+};
+
+struct Solver {
+    Combat stage;
+    int    first_index[ACTION_CAPACITY + 2]; /* index of the first plan with n actions; [ACTION_CAPACITY + 1] is the total. */
+
+    /* per plan, over every schedule that clears the stage with exactly that buffer. */
+    volatile uint64_t *schedules_won;
+    volatile uint32_t *fastest;    /* turns. UINT32_MAX: never won. */
+    volatile uint32_t *healthiest; /* health left. 0: never won. */
+
+    Solver_Worker    *workers;
+    Vec(Solver_Range) ranges;
+};
+
+
+/* plans are numbered by length, then as base PLAN_CHOICES numbers: action i is digit i. */
+static void solver_plan_for(Solver *solver, int index, uint32_t *plan, int32_t *count) {
+    int n = 1;
+    while (index >= solver->first_index[n + 1]) n++;
+
+    int digits = index - solver->first_index[n];
+    uint32_t packed = 0;
+    for (int i = 0; i < n; ++i) {
+        packed |= (uint32_t)(ACTION_SLASH + digits % PLAN_CHOICES) << (i * COMBAT_PLAN_BITS);
+        digits /= PLAN_CHOICES;
+    }
+    *plan  = packed;
+    *count = n;
+}
+
+static int solver_index_of(Solver *solver, uint32_t plan, int count) {
+    int digits = 0;
+    for (int i = count - 1; i >= 0; --i) {
+        digits = digits * PLAN_CHOICES + (int)((plan >> (i * COMBAT_PLAN_BITS)) & ((1 << COMBAT_PLAN_BITS) - 1)) - ACTION_SLASH;
+    }
+    return solver->first_index[count] + digits;
+}
+
+/* ways to go on from stop: 0 is adding nothing (not at the first stop), index i + 1 appends plan i. */
+static int solver_extensions(Solver *solver, Solver_Stop *stop) {
+    return 1 + solver->first_index[ACTION_CAPACITY - stop->plan_count + 1];
+}
+
+/* locks stop in and fights until the next planning stop, where stop is left.
+ * returns COMBAT_ONGOING there, or how the stage ended: COMBAT_STAGE_COMPLETE, COMBAT_PLAYER_DEAD or COMBAT_FORCEQUIT. */
+static Combat_Status solver_play(Solver *solver, Combat *combat, Solver_Stop *stop) {
+    for (int i = 0; i < stop->plan_count; ++i) {
+        combat->player.actions[i].type = (int)((stop->plan >> (i * COMBAT_PLAN_BITS)) & ((1 << COMBAT_PLAN_BITS) - 1));
+    }
+    combat->player.action_count   = stop->plan_count;
+    combat->player.action_index   = stop->action_index;
+    combat->player.health         = stop->health;
+    combat->chain_index           = stop->chain_index;
+    combat->enemy_index           = stop->enemy_index;
+    combat->infinite_loop_counter = 0; /* PLAYER_PLANNING clears it. */
+
+    /* the only enemy fought before the next stop; earlier searches left it dead. */
+    if (stop->chain_index < VecLen(combat->enemies) && stop->enemy_index < combat->enemies[stop->chain_index].enemy_count) {
+        combat->enemies[stop->chain_index].enemies[stop->enemy_index] = solver->stage.enemies[stop->chain_index].enemies[stop->enemy_index];
+    }
+
+    uint64_t turns = 0;
+    Combat_Status status;
+    for (;;) {
+        status = combat_status(combat);
+        if (status == COMBAT_ONGOING) {
+            turns += combat_resolve_enemy(combat);
+            continue;
+        }
+
+        if (status == COMBAT_ENEMY_DEAD) {
+            /* same as COMBAT_STATE_ENEMY_DIED: the last enemy of a chain goes through GOING_NEXT_PHASE. */
+            Enemy_Chain *chain = &combat->enemies[combat->chain_index];
+            if ((combat->enemy_index + 1) < chain->enemy_count) combat_next_enemy(combat);
+            else                                                 combat_next_chain(combat);
+        } else if (status == COMBAT_CHAIN_COMPLETE) {
+            combat_next_chain(combat);
+        }
+
+        if (status == COMBAT_ENEMY_DEAD || status == COMBAT_CHAIN_COMPLETE) {
+            status = combat_status(combat) == COMBAT_STAGE_COMPLETE ? COMBAT_STAGE_COMPLETE : COMBAT_ONGOING;
+        }
+        break;
+    }
+
+    stop->turns       += (int32_t)turns;
+    stop->health       = (int16_t)combat->player.health;
+    stop->action_index = (int8_t)combat->player.action_index;
+    stop->chain_index  = (int8_t)combat->chain_index;
+    stop->enemy_index  = (int8_t)combat->enemy_index;
+    return status;
+}
+
+/* stop with extension i of solver_extensions applied. 0 when there's nothing to lock in. */
+static int solver_extend(Solver *solver, Solver_Stop *stop, int extension) {
+    if (extension == 0) return stop->plan_count > 0;
+
+    uint32_t added;
+    int32_t  added_count;
+    solver_plan_for(solver, extension - 1, &added, &added_count);
+
+    if (stop->plan_count > 0) stop->replanned = 1;
+    stop->plan       |= added << (stop->plan_count * COMBAT_PLAN_BITS);
+    stop->plan_count += (int8_t)added_count;
+    return 1;
+}
+
+static void solver_won(Solver *solver, Solver_Worker *worker, Solver_Stop *stop) {
+    int index = solver_index_of(solver, stop->plan, stop->plan_count);
+    fz_atomic_add64(&solver->schedules_won[index], 1);
+
+    uint32_t turns = (uint32_t)stop->turns;
+    uint32_t seen  = fz_atomic_load32(&solver->fastest[index]);
+    while (turns < seen) seen = fz_atomic_cas32(&solver->fastest[index], seen, turns) == seen ? turns : fz_atomic_load32(&solver->fastest[index]);
+
+    uint32_t health = (uint32_t)stop->health;
+    seen = fz_atomic_load32(&solver->healthiest[index]);
+    while (health > seen) seen = fz_atomic_cas32(&solver->healthiest[index], seen, health) == seen ? health : fz_atomic_load32(&solver->healthiest[index]);
+
+    worker->won++;
+    if (!stop->replanned) worker->won_fixed++;
+}
+
+/* extensions [begin, end) of stop, each locked in and searched from the stop after. */
+static void solver_search(Solver *solver, Solver_Worker *worker, Solver_Stop *stop, int begin, int end) {
+    for (int i = begin; i < end; ++i) {
+        Solver_Stop next = *stop;
+        if (!solver_extend(solver, &next, i)) continue;
+
+        worker->stops++;
+        switch (solver_play(solver, &worker->scratch, &next)) {
+            case COMBAT_ONGOING:        solver_search(solver, worker, &next, 0, solver_extensions(solver, &next)); break;
+            case COMBAT_STAGE_COMPLETE: solver_won(solver, worker, &next); break;
+            default: break;
+        }
+    }
+}
+
+static void solver_ranges(void *user_data, int begin, int end) {
+    Solver *solver = (Solver *)user_data;
+    Solver_Worker *worker = &solver->workers[fz_jobs_worker_index()];
+    for (int i = begin; i < end; ++i) {
+        Solver_Range *range = &solver->ranges[i];
+        solver_search(solver, worker, &range->stop, range->begin, range->end);
+    }
+}
+
+/* on this thread, before the jobs: plays the extensions that keep stop's plan at SPLIT_PLAN_COUNT or less
+ * (splitting the stops they get to as well) and queues the rest as ranges. */
+static void solver_split(Solver *solver, Solver_Worker *worker, Solver_Stop *stop) {
+    assert(stop->plan_count <= SPLIT_PLAN_COUNT);
+    int count     = solver_extensions(solver, stop);
+    int split_end = 1 + solver->first_index[SPLIT_PLAN_COUNT - stop->plan_count + 1];
+
+    for (int i = 0; i < split_end; ++i) {
+        Solver_Stop next = *stop;
+        if (!solver_extend(solver, &next, i)) continue;
+
+        worker->stops++;
+        switch (solver_play(solver, &worker->scratch, &next)) {
+            case COMBAT_ONGOING:        solver_split(solver, worker, &next); break;
+            case COMBAT_STAGE_COMPLETE: solver_won(solver, worker, &next);   break;
+            default: break;
+        }
+    }
+
+    for (int begin = split_end; begin < count; begin += RANGE_EXTENSIONS) {
+        Solver_Range range;
+        range.stop  = *stop;
+        range.begin = begin;
+        range.end   = (count - begin > RANGE_EXTENSIONS) ? begin + RANGE_EXTENSIONS : count;
+        VecPush(solver->ranges, range);
+    }
+}
+
+static Solver_Stop solver_first_stop(Solver *solver) {
+    Solver_Stop stop = {};
+    stop.health       = (int16_t)solver->stage.player.health;
+    stop.chain_index  = (int8_t)solver->stage.chain_index;
+    stop.enemy_index  = (int8_t)solver->stage.enemy_index;
+    return stop;
+}
+
+static const char action_letter[ACTION_COUNT] = { '-', 'S', 'E', 'P', 'T' };
+
+static const char *plan_to_text(uint32_t plan, int count, char (*text)[ACTION_CAPACITY + 1]) {
+    for (int i = 0; i < count; ++i) {
+        (*text)[i] = action_letter[(plan >> (i * COMBAT_PLAN_BITS)) & ((1 << COMBAT_PLAN_BITS) - 1)];
+    }
+    (*text)[count] = 0;
+    return *text;
+}
+
+/* writes a schedule into text that clears the stage with exactly plan in turns turns (or with health left when
+ * turns < 0), and where it ends into end. text_at: where this stop's actions go. 0 when there is none. */
+static int solver_find_schedule(Solver *solver, Combat *combat, Solver_Stop *stop, uint32_t plan, int count,
+                                int turns, int health, char *text, int text_at, Solver_Stop *end)
+{
+    for (int added = stop->plan_count ? 0 : 1; stop->plan_count + added <= count; ++added) {
+        Solver_Stop next = *stop;
+        for (int i = next.plan_count; i < next.plan_count + added; ++i) {
+            int action = (int)((plan >> (i * COMBAT_PLAN_BITS)) & ((1 << COMBAT_PLAN_BITS) - 1));
+            next.plan |= (uint32_t)action << (i * COMBAT_PLAN_BITS);
+            text[text_at + i - stop->plan_count] = action_letter[action];
+        }
+        next.plan_count += (int8_t)added;
+
+        int at = text_at + added;
+        assert(at + 1 < SCHEDULE_LENGTH);
+
+        Combat_Status status = solver_play(solver, combat, &next);
+        if (status == COMBAT_STAGE_COMPLETE && next.plan_count == count &&
+            (turns >= 0 ? next.turns == turns : next.health == health))
+        {
+            /* leave off the stops that added nothing. */
+            while (at > 0 && text[at - 1] == '|') at--;
+            text[at] = 0;
+            *end = next;
+            return 1;
+        }
+        if (status == COMBAT_ONGOING) {
+            text[at] = '|';
+            if (solver_find_schedule(solver, combat, &next, plan, count, turns, health, text, at + 1, end)) return 1;
+        }
+    }
+    return 0;
+}
+
+/* winnable plans with fastest == turns (or healthiest == health when turns < 0), shortest plans first. */
+static void solver_report(Solver *solver, Combat *scratch, int turns, int health) {
+    int shown = 0, matching = 0;
+    char text[SCHEDULE_LENGTH];
+    char buffer[ACTION_CAPACITY + 1];
+    for (int n = 1; n <= ACTION_CAPACITY; ++n) {
+        for (int i = solver->first_index[n]; i < solver->first_index[n + 1]; ++i) {
+            if (!solver->schedules_won[i]) continue;
+            if (turns >= 0 ? (int)solver->fastest[i] != turns : (int)solver->healthiest[i] != health) continue;
+
+            matching++;
+            if (shown++ < REPORT_LIMIT) {
+                uint32_t plan;
+                int32_t  count;
+                solver_plan_for(solver, i, &plan, &count);
+
+                Solver_Stop first = solver_first_stop(solver), end = {};
+                int found = solver_find_schedule(solver, scratch, &first, plan, count, turns, health, text, 0, &end);
+                assert(found && "A plan that won has a schedule to show for it.");
+                fz_UNUSED(found);
+
+                printf("    %-*s %4d turns, %d health (%llu schedules win with %s)\n", ACTION_CAPACITY * 2, text,
+                       end.turns, end.health, (unsigned long long)solver->schedules_won[i], plan_to_text(plan, count, &buffer));
+            }
+        }
+    }
+    if (matching > REPORT_LIMIT) printf("    ... %d more\n", matching - REPORT_LIMIT);
+}
+
+int main(int argc, char **argv) {
+    const char *out_path = argc > 1 ? argv[1] : "winning_plans.txt";
+    int threads          = argc > 2 ? atoi(argv[2]) : -1;
+
+    Solver solver = {};
+    combat_load_stage_one(&solver.stage);
+    if (argc > 3) solver.stage.player.health = atoi(argv[3]);
+    assert(solver.stage.player.health <= INT16_MAX);
+
+    int plans_of_length = 1;
+    for (int n = 1; n <= ACTION_CAPACITY; ++n) {
+        plans_of_length *= PLAN_CHOICES;
+        solver.first_index[n + 1] = solver.first_index[n] + plans_of_length;
+    }
+    int count = solver.first_index[ACTION_CAPACITY + 1];
+
+    solver.schedules_won = (uint64_t *)fz_alloc(sizeof(uint64_t) * (size_t)count);
+    solver.fastest       = (uint32_t *)fz_alloc(sizeof(uint32_t) * (size_t)count);
+    solver.healthiest    = (uint32_t *)fz_alloc(sizeof(uint32_t) * (size_t)count);
+    for (int i = 0; i < count; ++i) {
+        solver.schedules_won[i] = 0;
+        solver.fastest[i]       = UINT32_MAX;
+        solver.healthiest[i]    = 0;
+    }
+
+    fz_Job_System jobs;
+    fz_jobs_init(&jobs, threads, fz_heap_allocator());
+
+    solver.workers = (Solver_Worker *)fz_alloc(sizeof(Solver_Worker) * (size_t)jobs.worker_count);
+    for (int w = 0; w < jobs.worker_count; ++w) {
+        Solver_Worker *worker = &solver.workers[w];
+        *worker = {};
+        worker->scratch = solver.stage;
+        worker->scratch.enemies = VecCreate(Enemy_Chain, VecLen(solver.stage.enemies));
+        for (int i = 0; i < VecLen(solver.stage.enemies); ++i) VecPush(worker->scratch.enemies, solver.stage.enemies[i]);
+    }
+
+    uint64_t start = time_now_ns();
+    {
+        solver.ranges = VecCreate(Solver_Range, 1024);
+        Solver_Stop first = solver_first_stop(&solver);
+        solver_split(&solver, &solver.workers[0], &first);
+
+        int ranges = (int)VecLen(solver.ranges);
+        fz_jobs_parallel_for(ranges, ranges / MAX_JOBS + 1, solver_ranges, &solver);
+    }
+    uint64_t elapsed = time_now_ns() - start;
+
+    fz_jobs_shutdown(&jobs);
+
+    uint64_t stops = 0, won = 0, won_fixed = 0;
+    for (int w = 0; w < jobs.worker_count; ++w) {
+        stops     += solver.workers[w].stops;
+        won       += solver.workers[w].won;
+        won_fixed += solver.workers[w].won_fixed;
+    }
+
+    int winnable = 0;
+    int best_turns = INT32_MAX, best_health = 0;
+
+    char text[ACTION_CAPACITY + 1];
+    FILE *out = fopen(out_path, "w");
+    if (!out) printf("Couldn't open %s, winning plans won't be written.\n", out_path);
+
+    for (int i = 0; i < count; ++i) {
+        if (!solver.schedules_won[i]) continue;
+
+        winnable++;
+        best_turns  = (int)solver.fastest[i]    < best_turns  ? (int)solver.fastest[i]    : best_turns;
+        best_health = (int)solver.healthiest[i] > best_health ? (int)solver.healthiest[i] : best_health;
+
+        uint32_t plan;
+        int32_t  plan_count;
+        solver_plan_for(&solver, i, &plan, &plan_count);
+        if (out) fprintf(out, "%s %llu %u %u\n", plan_to_text(plan, plan_count, &text),
+                         (unsigned long long)solver.schedules_won[i], solver.fastest[i], solver.healthiest[i]);
+    }
+    if (out) fclose(out);
+
+    printf("%llu lock-ins over %d possible buffers, %d workers: %.3f s, %.1f M lock-ins/s\n", (unsigned long long)stops,
+           count, jobs.worker_count, (double)elapsed / 1e9, (double)stops / ((double)elapsed / 1e9) / 1e6);
+    printf("  starting at %d health: %llu winning schedules (%llu never replan), ending on %d different buffers\n",
+           solver.stage.player.health, (unsigned long long)won, (unsigned long long)won_fixed, winnable);
+
+    if (winnable) {
+        printf("  buffers that can win written to %s (buffer, winning schedules, fastest turns, most health left)\n", out_path);
+        printf("  fastest, %d turns:\n", best_turns);
+        solver_report(&solver, &solver.workers[0].scratch, best_turns, 0);
+        printf("  most health left, %d:\n", best_health);
+        solver_report(&solver, &solver.workers[0].scratch, -1, best_health);
+    }
+
+    for (int w = 0; w < jobs.worker_count; ++w) VecRelease(solver.workers[w].scratch.enemies);
+    fz_free(solver.workers);
+    VecRelease(solver.ranges);
+    fz_free((void *)solver.schedules_won);
+    fz_free((void *)solver.fastest);
+    fz_free((void *)solver.healthiest);
+    VecRelease(solver.stage.enemies);
+    return 0;
+}